@@ -32,52 +32,357 @@
 
 #include "fadbad.h"
 
-#include <stack>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace fadbad
 {
+// Per-thread instance of T, created on first use. When the thread ends the
+// instance is handed to T::retire(), which releases it at once or, if it is
+// still in use by objects that outlive the thread, once they let it go.
+template <typename T>
+class ThreadInstance
+{
+  struct Reaper
+  {
+    T*& m_instance;
+    Reaper(T*& instance) : m_instance(instance) {}
+    ~Reaper()
+    {
+      T* p       = m_instance;
+      m_instance = 0;
+      if (p != 0)
+        T::retire(p);
+    }
+  };
+  static T*& slot()
+  {
+    static thread_local T* instance = 0;
+    return instance;
+  }
+
+ public:
+  static T& get()
+  {
+    T*& instance(slot());
+    if (instance == 0)
+    {
+      instance = new T();
+      static thread_local Reaper reaper(instance);
+    }
+    return *instance;
+  }
+  // The instance of the calling thread, or 0 if it has none (any more).
+  static T* find() { return slot(); }
+};
+
+// Precision tag of the scalars stored in a recycled adjoint vector. The
+// RecycleBin keeps vectors of different precision apart, so that an mpreal
+// vector is only handed out again at the precision it was initialized with
+// and no MPFR number has to be re-initialized when it is reused.
 template <typename U>
-class Derivatives
+struct RecyclePrec
 {
+  static long current() { return 0; }
+  static long of(const U*) { return 0; }
+};
+
+template <>
+struct RecyclePrec<mpreal>
+{
+  static long current() { return (long)mpfr_get_default_prec(); }
+  static long of(const mpreal* elm) { return (long)elm[ 0 ].get_prec(); }
+};
+
+// Storage for the adjoint vectors of the reverse mode. Vectors are cut from
+// contiguous slabs and kept on a free list per (size, precision) after use,
+// so a repeated gradient evaluation reaches a steady state in which no
+// adjoint vector is allocated. One bin is kept alive per thread, see
+// RecycleBin::get().
+//
+// A vector goes back to the bin that handed it out, which the Derivatives
+// holding it remember. With FADBAD_THREADSAFE, the nodes of a shared graph
+// may be released by another thread; their vectors are then left in the
+// owner's m_returned under its lock, and taken back by the owner when it
+// runs short. A bin whose thread has ended is released by the thread that
+// returns its last vector.
+template <typename U>
+class RecycleBin
+{
+  struct Pool
+  {
+    unsigned int    m_size;
+    long            m_prec;
+    unsigned int    m_chunks;  // number of vectors in the next slab
+    std::vector<U*> m_slabs;
+    std::vector<U*> m_free;
+    Pool(const unsigned int size, const long prec)
+        : m_size(size), m_prec(prec), m_chunks(16)
+    {
+    }
+    void grow()
+    {
+      U* slab = new U[ m_size * m_chunks ];
+      m_slabs.push_back(slab);
+      for (unsigned int i = m_chunks; i > 0; --i)
+        m_free.push_back(slab + (i - 1) * m_size);
+      if (m_chunks < 4096)
+        m_chunks *= 2;
+    }
+    ~Pool()
+    {
+      for (unsigned int i = 0; i < m_slabs.size(); ++i)
+        delete[] m_slabs[ i ];
+    }
+  };
+  std::vector<Pool*> m_pools;
+  Pool*              m_last;         // most recently used pool
+  long               m_outstanding;  // vectors handed out and not returned
+#ifdef FADBAD_THREADSAFE
+  std::mutex                              m_mutex;
+  std::vector<std::pair<U*, unsigned int> > m_returned;  // by other threads
+  bool                                    m_retired;  // the owner has ended
+#endif
+  RecycleBin(const RecycleBin&) { /*illegal*/}
+  void operator=(const RecycleBin&) { /*illegal*/}
+  Pool& pool(const unsigned int n, const long prec)
+  {
+    if (m_last != 0 && m_last->m_size == n && m_last->m_prec == prec)
+      return *m_last;
+    for (unsigned int i = 0; i < m_pools.size(); ++i)
+      if (m_pools[ i ]->m_size == n && m_pools[ i ]->m_prec == prec)
+        return *(m_last = m_pools[ i ]);
+    m_pools.push_back(m_last = new Pool(n, prec));
+    return *m_last;
+  }
+  void putBack(U* elm, const unsigned int n)
+  {
+    pool(n, RecyclePrec<U>::of(elm)).m_free.push_back(elm);
+    --m_outstanding;
+  }
+#ifdef FADBAD_THREADSAFE
+  // Takes back the vectors returned by other threads. Called with m_mutex
+  // held.
+  void reclaim()
+  {
+    for (unsigned int i = 0; i < m_returned.size(); ++i)
+      putBack(m_returned[ i ].first, m_returned[ i ].second);
+    m_returned.clear();
+  }
+#endif
+
  public:
-  class RecycleBin
+#ifdef FADBAD_THREADSAFE
+  RecycleBin() : m_last(0), m_outstanding(0), m_retired(false) {}
+#else
+  RecycleBin() : m_last(0), m_outstanding(0) {}
+#endif
+  // Vectors still held by live nodes point into the slabs, so the bin of an
+  // ended thread is only released once all of them have been returned.
+  static void retire(RecycleBin* pBin)
   {
-    std::stack<std::vector<U>*> m_recycle;
-    RecycleBin(const RecycleBin&) { /*illegal*/}
-   public:
-    RecycleBin() {}
-    std::vector<U>* popRecycle(const unsigned int n)
+#ifdef FADBAD_THREADSAFE
+    bool idle;
     {
-      if (m_recycle.empty())
-        return new std::vector<U>(n);
-      std::vector<U>* elm = m_recycle.top();
-      m_recycle.pop();
-      USER_ASSERT(elm->size() == n, "Size mismatch " << elm->size() << "!=" << n)
-      return elm;
+      std::lock_guard<std::mutex> lock(pBin->m_mutex);
+      pBin->reclaim();
+      idle            = pBin->m_outstanding == 0;
+      pBin->m_retired = !idle;
     }
-    void pushRecycle(std::vector<U>* elm) { m_recycle.push(elm); }
-    ~RecycleBin()
+    if (idle)
+      delete pBin;
+#else
+    if (pBin->m_outstanding == 0)
+      delete pBin;
+#endif
+  }
+  // The persistent bin of the calling thread.
+  static RecycleBin& get() { return ThreadInstance<RecycleBin>::get(); }
+  U* popRecycle(const unsigned int n)
+  {
+    Pool& p = pool(n, RecyclePrec<U>::current());
+#ifdef FADBAD_THREADSAFE
+    if (p.m_free.empty())
     {
-      while (!m_recycle.empty())
+      std::lock_guard<std::mutex> lock(m_mutex);
+      reclaim();
+    }
+#endif
+    if (p.m_free.empty())
+      p.grow();
+    U* elm = p.m_free.back();
+    p.m_free.pop_back();
+    ++m_outstanding;
+    return elm;
+  }
+  void pushRecycle(U* elm, const unsigned int n)
+  {
+#ifdef FADBAD_THREADSAFE
+    if (ThreadInstance<RecycleBin>::find() != this)
+    {
+      bool last;
       {
-        delete m_recycle.top();
-        m_recycle.pop();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_retired)
+        {
+          m_returned.push_back(std::make_pair(elm, n));
+          return;
+        }
+        putBack(elm, n);  // the owner has ended, so this thread counts
+        last = m_outstanding == 0;
       }
+      if (last)
+        delete this;
+      return;
     }
-  };
+#endif
+    putBack(elm, n);
+  }
+  ~RecycleBin()
+  {
+    for (unsigned int i = 0; i < m_pools.size(); ++i)
+      delete m_pools[ i ];
+  }
+};
+
+// Element kernels of the adjoint updates in Derivatives. Specialize this
+// for types that have cheaper in-place forms than the generic expressions.
+template <typename U>
+struct AdjointOp
+{
+  static void zero(U& r) { r = Op<U>::myZero(); }
+  static void neg(U& r) { r = Op<U>::myNeg(r); }
+  static void add(U& r, const U& d) { Op<U>::myCadd(r, d); }
+  static void sub(U& r, const U& d) { Op<U>::myCsub(r, d); }
+  // r = a*d
+  template <typename V>
+  static void mul(U& r, const V& a, const U& d)
+  {
+    r = a * d;
+  }
+  // r = -a*d
+  template <typename V>
+  static void neg_mul(U& r, const V& a, const U& d)
+  {
+    r = Op<U>::myNeg(a * d);
+  }
+  // r += a*d
+  template <typename V>
+  static void add_mul(U& r, const V& a, const U& d)
+  {
+    Op<U>::myCadd(r, a * d);
+  }
+  // r -= a*d
+  template <typename V>
+  static void sub_mul(U& r, const V& a, const U& d)
+  {
+    Op<U>::myCsub(r, a * d);
+  }
+};
+
+template <>
+struct AdjointOp<mpreal>  // SPECIALIZED TEMPLATE FOR mpreal class:
+{
+  static void zero(mpreal& r) { r.setZero(); }
+  static void neg(mpreal& r) { Op<mpreal>::mpreal_neg(r, r); }
+  static void add(mpreal& r, const mpreal& d) { Op<mpreal>::mpreal_add(r, r, d); }
+  static void sub(mpreal& r, const mpreal& d) { Op<mpreal>::mpreal_sub(r, r, d); }
+  static void mul(mpreal& r, const mpreal& a, const mpreal& d) { Op<mpreal>::mpreal_mul(r, a, d); }
+  static void neg_mul(mpreal& r, const mpreal& a, const mpreal& d)
+  {
+    Op<mpreal>::mpreal_mul(r, a, d);
+    Op<mpreal>::mpreal_neg(r, r);
+  }
+  static void add_mul(mpreal& r, const mpreal& a, const mpreal& d)
+  {
+    Op<mpreal>::mpreal_fma(r, a, d, r);
+  }
+  static void sub_mul(mpreal& r, const mpreal& a, const mpreal& d)
+  {
+    Op<mpreal>::mpreal_fms(r, a, d, r);
+    Op<mpreal>::mpreal_neg(r, r);
+  }
+};
+
+// In-place value kernels used by the nodes to form their local partial
+// derivatives (BTypeNameHV::partials), and by the compact tape (btape.h).
+template <typename U>
+struct LocalOp
+{
+  static void neg(U& r) { r = Op<U>::myNeg(r); }
+  static void add(U& r, const U& a, const U& b) { r = a + b; }
+  static void sub(U& r, const U& a, const U& b) { r = a - b; }
+  static void mul(U& r, const U& a, const U& b) { r = a * b; }
+  static void div(U& r, const U& a, const U& b) { r = a / b; }
+  static void inv(U& r, const U& x) { r = Op<U>::myInv(x); }
+  static void sqr(U& r, const U& x) { r = Op<U>::mySqr(x); }
+  static void sqrt(U& r, const U& x) { r = Op<U>::mySqrt(x); }
+  static void log(U& r, const U& x) { r = Op<U>::myLog(x); }
+  static void sin(U& r, const U& x) { r = Op<U>::mySin(x); }
+  static void cos(U& r, const U& x) { r = Op<U>::myCos(x); }
+  static void tan(U& r, const U& x) { r = Op<U>::myTan(x); }
+  static void asin(U& r, const U& x) { r = Op<U>::myAsin(x); }
+  static void acos(U& r, const U& x) { r = Op<U>::myAcos(x); }
+  static void atan(U& r, const U& x) { r = Op<U>::myAtan(x); }
+  static void exp(U& r, const U& x) { r = Op<U>::myExp(x); }
+  static void pow(U& r, const U& x, const U& y) { r = Op<U>::myPow(x, y); }
+};
+
+template <>
+struct LocalOp<mpreal>  // SPECIALIZED TEMPLATE FOR mpreal class:
+{
+  static void neg(mpreal& r) { Op<mpreal>::mpreal_neg(r, r); }
+  static void add(mpreal& r, const mpreal& a, const mpreal& b) { Op<mpreal>::mpreal_add(r, a, b); }
+  static void sub(mpreal& r, const mpreal& a, const mpreal& b) { Op<mpreal>::mpreal_sub(r, a, b); }
+  static void mul(mpreal& r, const mpreal& a, const mpreal& b) { Op<mpreal>::mpreal_mul(r, a, b); }
+  static void div(mpreal& r, const mpreal& a, const mpreal& b) { Op<mpreal>::mpreal_div(r, a, b); }
+  static void inv(mpreal& r, const mpreal& x) { Op<mpreal>::mpreal_inv(r, x); }
+  static void sqr(mpreal& r, const mpreal& x) { Op<mpreal>::mpreal_sqr(r, x); }
+  static void sqrt(mpreal& r, const mpreal& x) { Op<mpreal>::mpreal_sqrt(r, x); }
+  static void log(mpreal& r, const mpreal& x) { Op<mpreal>::mpreal_log(r, x); }
+  static void sin(mpreal& r, const mpreal& x) { Op<mpreal>::mpreal_sin(r, x); }
+  static void cos(mpreal& r, const mpreal& x) { Op<mpreal>::mpreal_cos(r, x); }
+  static void tan(mpreal& r, const mpreal& x) { Op<mpreal>::mpreal_tan(r, x); }
+  static void asin(mpreal& r, const mpreal& x) { Op<mpreal>::mpreal_asin(r, x); }
+  static void acos(mpreal& r, const mpreal& x) { Op<mpreal>::mpreal_acos(r, x); }
+  static void atan(mpreal& r, const mpreal& x) { Op<mpreal>::mpreal_atan(r, x); }
+  static void exp(mpreal& r, const mpreal& x) { Op<mpreal>::mpreal_exp(r, x); }
+  static void pow(mpreal& r, const mpreal& x, const mpreal& y) { Op<mpreal>::mpreal_pow(r, x, y); }
+};
+
+template <typename U>
+class Derivatives
+{
+ public:
+  typedef fadbad::RecycleBin<U> RecycleBin;
 
  private:
-  std::vector<U>* m_values;
+  U*           m_values;
+  unsigned int m_size;
+  RecycleBin*  m_bin;  // that handed out m_values
+  // With a single dependent variable (diff(0,1)) the adjoint is constructed
+  // in place here instead of being taken from the RecycleBin.
+  typename std::aligned_storage<sizeof(U), alignof(U)>::type m_scalar;
 
-  unsigned int size() const { return (unsigned int)m_values->size(); }
+  unsigned int size() const { return m_size; }
+  void         take(RecycleBin& bin, const unsigned int n)
+  {
+    m_values = bin.popRecycle(n);
+    m_bin    = &bin;
+  }
  public:
-  Derivatives() : m_values(0) {}
-  void recycle(RecycleBin& bin)
+  Derivatives() : m_values(0), m_size(0), m_bin(0) {}
+  void recycle(RecycleBin&)
   {
     USER_ASSERT(m_values != 0, "Nothing to recycle")
-    bin.pushRecycle(m_values);
+    if (m_size == 1)
+      m_values->~U();
+    else
+      m_bin->pushRecycle(m_values, m_size);
     m_values = 0;
+    m_size   = 0;
   }
 
   bool haveValues() const { return m_values != 0; }
@@ -86,81 +391,133 @@ class Derivatives
     USER_ASSERT(i < n, "Index " << i << " out of range [0," << n << "]")
     if (m_values == 0)
     {
-      m_values = bin.popRecycle(n);
-      for (unsigned int j = 0; j < n; ++j)
-        (*m_values)[ j ]  = Op<U>::myZero();
+      if (n == 1)
+        m_values = new (&m_scalar) U(Op<U>::myZero());
+      else
+      {
+        take(bin, n);
+        for (unsigned int j = 0; j < n; ++j)
+          m_values[ j ]  = Op<U>::myZero();
+      }
+      m_size = n;
     }
-    USER_ASSERT(m_values->size() == n, "Size mismatch " << m_values->size() << "!=" << n)
-    return (*m_values)[ i ] = Op<U>::myOne();
+    USER_ASSERT(m_size == n, "Size mismatch " << m_size << "!=" << n)
+    return m_values[ i ] = Op<U>::myOne();
   }
   void add(RecycleBin& bin, const Derivatives<U>& d)
   {
     USER_ASSERT(d.size() > 0, "Propagating node with no derivatives")
-    if (m_values == 0)
+    if (d.m_size == 1)
     {
-      m_values = bin.popRecycle(d.size());
-      for (unsigned int i = 0; i < m_values->size(); ++i)
-        (*m_values)[ i ]  = (*d.m_values)[ i ];
+      if (m_values == 0)
+      {
+        m_values = new (&m_scalar) U(*d.m_values);
+        m_size   = 1;
+      }
+      else
+        AdjointOp<U>::add(*m_values, *d.m_values);
+    }
+    else if (m_values == 0)
+    {
+      take(bin, d.size());
+      m_size   = d.size();
+      for (unsigned int i = 0; i < m_size; ++i)
+        m_values[ i ]  = d.m_values[ i ];
     }
     else
     {
-      USER_ASSERT(m_values->size() == d.size(), "Size mismatch " << m_values->size()
-                                                                 << "!=" << d.size())
-      for (unsigned int i = 0; i < m_values->size(); ++i)
-        Op<U>::myCadd((*m_values)[ i ], (*d.m_values)[ i ]);
+      USER_ASSERT(m_size == d.size(), "Size mismatch " << m_size << "!=" << d.size())
+      for (unsigned int i = 0; i < m_size; ++i)
+        AdjointOp<U>::add(m_values[ i ], d.m_values[ i ]);
     }
   }
   void sub(RecycleBin& bin, const Derivatives<U>& d)
   {
     USER_ASSERT(d.size() > 0, "Propagating node with no derivatives")
-    if (m_values == 0)
+    if (d.m_size == 1)
+    {
+      if (m_values == 0)
+      {
+        m_values = new (&m_scalar) U(*d.m_values);
+        AdjointOp<U>::neg(*m_values);
+        m_size   = 1;
+      }
+      else
+        AdjointOp<U>::sub(*m_values, *d.m_values);
+    }
+    else if (m_values == 0)
     {
-      m_values = bin.popRecycle(d.size());
-      for (unsigned int i = 0; i < m_values->size(); ++i)
-        (*m_values)[ i ]  = Op<U>::myNeg((*d.m_values)[ i ]);
+      take(bin, d.size());
+      m_size   = d.size();
+      for (unsigned int i = 0; i < m_size; ++i)
+      {
+        m_values[ i ] = d.m_values[ i ];
+        AdjointOp<U>::neg(m_values[ i ]);
+      }
     }
     else
     {
-      USER_ASSERT(m_values->size() == d.size(), "Size mismatch " << m_values->size()
-                                                                 << "!=" << d.size())
-      for (unsigned int i = 0; i < m_values->size(); ++i)
-        Op<U>::myCsub((*m_values)[ i ], (*d.m_values)[ i ]);
+      USER_ASSERT(m_size == d.size(), "Size mismatch " << m_size << "!=" << d.size())
+      for (unsigned int i = 0; i < m_size; ++i)
+        AdjointOp<U>::sub(m_values[ i ], d.m_values[ i ]);
     }
   }
   template <typename V>
   void add(RecycleBin& bin, const V& a, const Derivatives<U>& d)
   {
     USER_ASSERT(d.size() > 0, "Propagating node with no derivatives")
-    if (m_values == 0)
+    if (d.m_size == 1)
     {
-      m_values = bin.popRecycle(d.size());
-      for (unsigned int i = 0; i < m_values->size(); ++i)
-        (*m_values)[ i ]  = a * (*d.m_values)[ i ];
+      if (m_values == 0)
+      {
+        m_values = new (&m_scalar) U();
+        AdjointOp<U>::mul(*m_values, a, *d.m_values);
+        m_size   = 1;
+      }
+      else
+        AdjointOp<U>::add_mul(*m_values, a, *d.m_values);
+    }
+    else if (m_values == 0)
+    {
+      take(bin, d.size());
+      m_size   = d.size();
+      for (unsigned int i = 0; i < m_size; ++i)
+        AdjointOp<U>::mul(m_values[ i ], a, d.m_values[ i ]);
     }
     else
     {
-      USER_ASSERT(m_values->size() == d.size(), "Size mismatch " << m_values->size()
-                                                                 << "!=" << d.size())
-      for (unsigned int i = 0; i < m_values->size(); ++i)
-        Op<U>::myCadd((*m_values)[ i ], a * (*d.m_values)[ i ]);
+      USER_ASSERT(m_size == d.size(), "Size mismatch " << m_size << "!=" << d.size())
+      for (unsigned int i = 0; i < m_size; ++i)
+        AdjointOp<U>::add_mul(m_values[ i ], a, d.m_values[ i ]);
     }
   }
   template <typename V>
   void sub(RecycleBin& bin, const V& a, const Derivatives<U>& d)
   {
     USER_ASSERT(d.size() > 0, "Propagating node with no derivatives")
-    if (m_values == 0)
+    if (d.m_size == 1)
     {
-      m_values = bin.popRecycle(d.size());
-      for (unsigned int i = 0; i < m_values->size(); ++i)
-        (*m_values)[ i ]  = Op<U>::myNeg(a * (*d.m_values)[ i ]);
+      if (m_values == 0)
+      {
+        m_values = new (&m_scalar) U();
+        AdjointOp<U>::neg_mul(*m_values, a, *d.m_values);
+        m_size   = 1;
+      }
+      else
+        AdjointOp<U>::sub_mul(*m_values, a, *d.m_values);
+    }
+    else if (m_values == 0)
+    {
+      take(bin, d.size());
+      m_size   = d.size();
+      for (unsigned int i = 0; i < m_size; ++i)
+        AdjointOp<U>::neg_mul(m_values[ i ], a, d.m_values[ i ]);
     }
     else
     {
-      USER_ASSERT(m_values->size() == d.size(), "Size mismatch " << m_values->size()
-                                                                 << "!=" << d.size())
-      for (unsigned int i = 0; i < m_values->size(); ++i)
-        Op<U>::myCsub((*m_values)[ i ], a * (*d.m_values)[ i ]);
+      USER_ASSERT(m_size == d.size(), "Size mismatch " << m_size << "!=" << d.size())
+      for (unsigned int i = 0; i < m_size; ++i)
+        AdjointOp<U>::sub_mul(m_values[ i ], a, d.m_values[ i ]);
     }
   }
 
@@ -168,13 +525,12 @@ class Derivatives
   {
     if (m_values != 0)
     {
-      USER_ASSERT(i < m_values->size(), "Index " << i << " out of bounds [0," << m_values->size()
-                                                 << "]")
-      return (*m_values)[ i ];
+      USER_ASSERT(i < m_size, "Index " << i << " out of bounds [0," << m_size << "]")
+      return m_values[ i ];
     }
     else
     {
-      static U zero;
+      static FADBAD_TLS U zero;
       zero = Op<U>::myZero();
       return zero;
     }
@@ -183,28 +539,214 @@ class Derivatives
   {
     if (m_values != 0)
     {
-      USER_ASSERT(i < m_values->size(), "Index " << i << " out of bounds [0," << m_values->size()
-                                                 << "]")
-      return (*m_values)[ i ];
+      USER_ASSERT(i < m_size, "Index " << i << " out of bounds [0," << m_size << "]")
+      return m_values[ i ];
     }
     else
     {
-      static U zero;
+      static FADBAD_TLS U zero;
       zero = Op<U>::myZero();
       return zero;
     }
   }
 };
 
+template <>
+class Derivatives<mpreal>  // SPECIALIZED TEMPLATE FOR mpreal class:
+{
+ public:
+  typedef fadbad::RecycleBin<mpreal> RecycleBin;
+
+ private:
+  mpreal*      m_values;
+  unsigned int m_size;
+  RecycleBin*  m_bin;  // that handed out m_values
+
+  unsigned int size() const { return m_size; }
+  void         take(RecycleBin& bin, const unsigned int n)
+  {
+    m_values = bin.popRecycle(n);
+    m_bin    = &bin;
+  }
+  // Partial derivatives that are not mpreal are lifted once per propagation
+  static const mpreal& lift(const mpreal& a) { return a; }
+  template <typename V>
+  static const mpreal& lift(const V& a)
+  {
+    static FADBAD_TLS mpreal scalar;
+    if (scalar.get_prec() != DEFAULT_PREC)
+      scalar.set_prec(DEFAULT_PREC, DEFAULT_RNDM);
+    scalar = a;
+    return scalar;
+  }
+ public:
+  Derivatives() : m_values(0), m_size(0), m_bin(0) {}
+  void recycle(RecycleBin&)
+  {
+    USER_ASSERT(m_values != 0, "Nothing to recycle")
+    m_bin->pushRecycle(m_values, m_size);
+    m_values = 0;
+    m_size   = 0;
+  }
+
+  bool haveValues() const { return m_values != 0; }
+  mpreal& diff(RecycleBin& bin, const unsigned int i, const unsigned int n)
+  {
+    USER_ASSERT(i < n, "Index " << i << " out of range [0," << n << "]")
+    if (m_values == 0)
+    {
+      take(bin, n);
+      m_size   = n;
+      for (unsigned int j = 0; j < n; ++j)
+        m_values[ j ] = 0.0;
+    }
+    USER_ASSERT(m_size == n, "Size mismatch " << m_size << "!=" << n)
+    return m_values[ i ] = 1.0;
+  }
+  void add(RecycleBin& bin, const Derivatives<mpreal>& d)
+  {
+    USER_ASSERT(d.size() > 0, "Propagating node with no derivatives")
+    if (m_values == 0)
+    {
+      take(bin, d.size());
+      m_size   = d.size();
+      for (unsigned int i = 0; i < m_size; ++i)
+        m_values[ i ] = d.m_values[ i ];
+    }
+    else
+    {
+      USER_ASSERT(m_size == d.size(), "Size mismatch " << m_size << "!=" << d.size())
+      for (unsigned int i = 0; i < m_size; ++i)
+        Op<mpreal>::mpreal_add(m_values[ i ], m_values[ i ], d.m_values[ i ]);
+    }
+  }
+  void sub(RecycleBin& bin, const Derivatives<mpreal>& d)
+  {
+    USER_ASSERT(d.size() > 0, "Propagating node with no derivatives")
+    if (m_values == 0)
+    {
+      take(bin, d.size());
+      m_size   = d.size();
+      for (unsigned int i = 0; i < m_size; ++i)
+        Op<mpreal>::mpreal_neg(m_values[ i ], d.m_values[ i ]);
+    }
+    else
+    {
+      USER_ASSERT(m_size == d.size(), "Size mismatch " << m_size << "!=" << d.size())
+      for (unsigned int i = 0; i < m_size; ++i)
+        Op<mpreal>::mpreal_sub(m_values[ i ], m_values[ i ], d.m_values[ i ]);
+    }
+  }
+  template <typename V>
+  void add(RecycleBin& bin, const V& a, const Derivatives<mpreal>& d)
+  {
+    USER_ASSERT(d.size() > 0, "Propagating node with no derivatives")
+    const mpreal& b(lift(a));
+    if (m_values == 0)
+    {
+      take(bin, d.size());
+      m_size   = d.size();
+      for (unsigned int i = 0; i < m_size; ++i)
+        AdjointOp<mpreal>::mul(m_values[ i ], b, d.m_values[ i ]);
+    }
+    else
+    {
+      USER_ASSERT(m_size == d.size(), "Size mismatch " << m_size << "!=" << d.size())
+      for (unsigned int i = 0; i < m_size; ++i)
+        AdjointOp<mpreal>::add_mul(m_values[ i ], b, d.m_values[ i ]);
+    }
+  }
+  template <typename V>
+  void sub(RecycleBin& bin, const V& a, const Derivatives<mpreal>& d)
+  {
+    USER_ASSERT(d.size() > 0, "Propagating node with no derivatives")
+    const mpreal& b(lift(a));
+    if (m_values == 0)
+    {
+      take(bin, d.size());
+      m_size   = d.size();
+      for (unsigned int i = 0; i < m_size; ++i)
+        AdjointOp<mpreal>::neg_mul(m_values[ i ], b, d.m_values[ i ]);
+    }
+    else
+    {
+      USER_ASSERT(m_size == d.size(), "Size mismatch " << m_size << "!=" << d.size())
+      for (unsigned int i = 0; i < m_size; ++i)
+        AdjointOp<mpreal>::sub_mul(m_values[ i ], b, d.m_values[ i ]);
+    }
+  }
+
+  mpreal& operator[](const unsigned int i)
+  {
+    if (m_values != 0)
+    {
+      USER_ASSERT(i < m_size, "Index " << i << " out of bounds [0," << m_size << "]")
+      return m_values[ i ];
+    }
+    else
+    {
+      static FADBAD_TLS mpreal zero;
+      zero = 0.0;
+      return zero;
+    }
+  }
+  const mpreal& operator[](const unsigned int i) const
+  {
+    if (m_values != 0)
+    {
+      USER_ASSERT(i < m_size, "Index " << i << " out of bounds [0," << m_size << "]")
+      return m_values[ i ];
+    }
+    else
+    {
+      static FADBAD_TLS mpreal zero;
+      zero = 0.0;
+      return zero;
+    }
+  }
+};
+
 template <typename U>
 class BTypeNameHV  // Heap Value
 {
-  U                    m_val;
-  mutable unsigned int m_rc;
+  U                  m_val;
+  mutable RefCounter m_rc;
 
  protected:
   mutable Derivatives<U> m_derivatives;
   virtual ~BTypeNameHV() {}
+
+ private:
+  struct Worklist
+  {
+    std::vector<BTypeNameHV<U>*> m_nodes;
+    bool                         m_active;
+    Worklist() : m_active(false) {}
+    static void retire(Worklist* pWl) { delete pWl; }
+  };
+  static void schedule(BTypeNameHV<U>* pBTypeNameHV)
+  {
+    Worklist& wl(ThreadInstance<Worklist>::get());
+    wl.m_nodes.push_back(pBTypeNameHV);
+    if (wl.m_active)
+      return;
+    wl.m_active = true;
+    typename Derivatives<U>::RecycleBin& bin(Derivatives<U>::RecycleBin::get());
+    while (!wl.m_nodes.empty())
+    {
+      BTypeNameHV<U>* pHV = wl.m_nodes.back();
+      wl.m_nodes.pop_back();
+      if (pHV->m_derivatives.haveValues())
+      {
+        pHV->propagate(bin);
+        pHV->m_derivatives.recycle(bin);
+        pHV->propagateChildren(bin);
+      }
+      delete pHV;  // remaining operands are scheduled by the destructor
+    }
+    wl.m_active = false;
+  }
+
  public:
   BTypeNameHV() : m_rc(0), m_derivatives() {}
   template <typename V>
@@ -213,36 +755,21 @@ class BTypeNameHV  // Heap Value
   }
   const U& val() const { return m_val; }
   U&       val() { return m_val; }
+  // Nodes whose counter drops to zero are not released recursively: they
+  // are pushed on a per-thread worklist which the outermost decRef drains.
+  // A node is only released once all its parents are released, so the
+  // order of the reverse sweep is unchanged, but the C++ stack depth no
+  // longer grows with the depth of the graph.
   void decRef(BTypeNameHV<U>*& pBTypeNameHV)
   {
     INTERNAL_ASSERT(m_rc > 0, "Resource counter negative");
     if (--m_rc == 0)
-    {
-      if (m_derivatives.haveValues())
-      {
-        typename Derivatives<U>::RecycleBin bin;
-        propagate(bin);
-        m_derivatives.recycle(bin);
-        propagateChildren(bin);
-      }
-      delete this;
-    }
+      schedule(this);
     pBTypeNameHV = 0;
   }
-  void decRef(typename Derivatives<U>::RecycleBin& bin, BTypeNameHV<U>*& pBTypeNameHV)
+  void decRef(typename Derivatives<U>::RecycleBin&, BTypeNameHV<U>*& pBTypeNameHV)
   {
-    INTERNAL_ASSERT(m_rc > 0, "Resource counter negative");
-    if (--m_rc == 0)
-    {
-      if (m_derivatives.haveValues())
-      {
-        propagate(bin);
-        m_derivatives.recycle(bin);
-        propagateChildren(bin);
-      }
-      delete this;
-    }
-    pBTypeNameHV = 0;
+    decRef(pBTypeNameHV);
   }
   void incRef() const { ++m_rc; }
   U& diff(typename Derivatives<U>::RecycleBin& bin, const unsigned int idx, const unsigned int size)
@@ -253,20 +780,52 @@ class BTypeNameHV  // Heap Value
   virtual void propagateChildren(typename Derivatives<U>::RecycleBin&) {}
   void add(typename Derivatives<U>::RecycleBin& bin, const Derivatives<U>& d)
   {
+    SHARED_GUARD(m_rc, this)
     m_derivatives.add(bin, d);
   }
   void sub(typename Derivatives<U>::RecycleBin& bin, const Derivatives<U>& d)
   {
+    SHARED_GUARD(m_rc, this)
     m_derivatives.sub(bin, d);
   }
   void add(typename Derivatives<U>::RecycleBin& bin, const U& a, const Derivatives<U>& d)
   {
+    SHARED_GUARD(m_rc, this)
     m_derivatives.add(bin, a, d);
   }
   void sub(typename Derivatives<U>::RecycleBin& bin, const U& a, const Derivatives<U>& d)
   {
+    SHARED_GUARD(m_rc, this)
     m_derivatives.sub(bin, a, d);
   }
+  // Operands of the node:
+  virtual unsigned int    arity() const { return 0; }
+  virtual BTypeNameHV<U>* operand(const unsigned int) const { return 0; }
+  // Local partial derivatives with respect to the operands, as used by
+  // hessian.h and crosscountry.h. d receives the arity() first order
+  // partials. Nonlinear nodes also fill dd with the second order partials
+  // (lower triangle, row by row) and return true. Nodes with recorded
+  // partials know only the first order ones (hasSecondOrder).
+  virtual bool partials(U*, U*) const { return false; }
+  virtual bool hasSecondOrder() const { return true; }
+  // Marks the node and the graph below it as shared, after which it may be
+  // referenced from graphs recorded on other threads (FADBAD_THREADSAFE).
+  void share()
+  {
+#ifdef FADBAD_THREADSAFE
+    std::vector<BTypeNameHV<U>*> stack(1, this);
+    while (!stack.empty())
+    {
+      BTypeNameHV<U>* pHV = stack.back();
+      stack.pop_back();
+      if (isShared(pHV->m_rc))
+        continue;
+      markShared(pHV->m_rc);
+      for (unsigned int i = 0; i < pHV->arity(); ++i)
+        stack.push_back(pHV->operand(i));
+    }
+#endif
+  }
   U& deriv(const unsigned int i)
   {
     USER_ASSERT(m_rc == 1, "Still non-propagated dependencies ("
@@ -303,9 +862,9 @@ class BTypeName
     U& deriv(const unsigned int i) { return m_pBTypeNameHV->deriv(i); }
     U& diff(const unsigned int idx, const unsigned int size)
     {
-      typename Derivatives<U>::RecycleBin bin;
-      U&                                  res(m_pBTypeNameHV->diff(bin, idx, size));
-      BTypeNameHV<U>*                     pHV = new BTypeNameHV<U>(this->val());
+      typename Derivatives<U>::RecycleBin& bin(Derivatives<U>::RecycleBin::get());
+      U&                                   res(m_pBTypeNameHV->diff(bin, idx, size));
+      BTypeNameHV<U>*                      pHV = new BTypeNameHV<U>(this->val());
       m_pBTypeNameHV->decRef(bin, m_pBTypeNameHV);
       m_pBTypeNameHV = pHV;
       m_pBTypeNameHV->incRef();
@@ -339,6 +898,7 @@ class BTypeName
   const U& deriv(const unsigned int i) const { return m_sv.deriv(i); }
   U& d(const unsigned int i) { return m_sv.deriv(i); }
   U& diff(const unsigned int idx, const unsigned int size) { return m_sv.diff(idx, size); }
+  void share() const { m_sv.getBTypeNameHV()->share(); }
   BTypeName<U>& operator+=(const BTypeName<U>& val);
   BTypeName<U>& operator-=(const BTypeName<U>& val);
   BTypeName<U>& operator*=(const BTypeName<U>& val);
@@ -473,6 +1033,8 @@ class BinBTypeNameHV : public BTypeNameHV<U>
   }
   BTypeNameHV<U>* op1() { return m_pOp1; }
   BTypeNameHV<U>* op2() { return m_pOp2; }
+  virtual unsigned int    arity() const { return 2; }
+  virtual BTypeNameHV<U>* operand(const unsigned int i) const { return i == 0 ? m_pOp1 : m_pOp2; }
 };
 
 // Unary operator base class:
@@ -485,18 +1047,139 @@ class UnBTypeNameHV : public BTypeNameHV<U>
  public:
   UnBTypeNameHV(const U& val, BTypeNameHV<U>* pOp) : BTypeNameHV<U>(val), m_pOp(pOp)
   {
-    m_pOp->incRef();
+    m_pOp->incRef();
+  }
+  virtual void propagateChildren(typename Derivatives<U>::RecycleBin& bin)
+  {
+    m_pOp->decRef(bin, m_pOp);
+  }
+  virtual ~UnBTypeNameHV()
+  {
+    if (m_pOp)
+      m_pOp->decRef(m_pOp);
+  }
+  BTypeNameHV<U>* op() { return m_pOp; }
+  virtual unsigned int    arity() const { return 1; }
+  virtual BTypeNameHV<U>* operand(const unsigned int) const { return m_pOp; }
+};
+
+// Recording option of the reverse mode. While a RecordPartials object is
+// alive, the elementary functions whose local partial derivatives need
+// divisions or transcendentals (/, pow, sqrt, log, sin, cos, tan, asin,
+// acos, atan) evaluate them during the forward pass and store them on the
+// node, so the reverse sweep only multiplies and accumulates. The option
+// is per thread and scopes nest.
+class RecordPartials
+{
+  bool m_prev;
+  static bool& flag()
+  {
+    static thread_local bool on = false;
+    return on;
+  }
+  RecordPartials(const RecordPartials&) { /*illegal*/}
+  void operator=(const RecordPartials&) { /*illegal*/}
+
+ public:
+  explicit RecordPartials(const bool on = true) : m_prev(flag()) { flag() = on; }
+  ~RecordPartials() { flag() = m_prev; }
+  static bool active() { return flag(); }
+};
+
+// Unary node with recorded partial derivative:
+
+template <typename U>
+struct BTypeNameLIN1 : public UnBTypeNameHV<U>
+{
+  U m_d;
+  BTypeNameLIN1(const U& val, BTypeNameHV<U>* pOp, const U& d) : UnBTypeNameHV<U>(val, pOp), m_d(d)
+  {
+  }
+  virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+  {
+    this->op()->add(bin, m_d, this->m_derivatives);
+  }
+  virtual bool partials(U* d, U*) const
+  {
+    d[ 0 ] = m_d;
+    return false;
+  }
+  virtual bool hasSecondOrder() const { return false; }
+
+ private:
+  void operator=(const BTypeNameLIN1<U>&) {}  // not allowed
+};
+
+// Binary node with recorded partial derivatives:
+
+template <typename U>
+struct BTypeNameLIN2 : public BinBTypeNameHV<U>
+{
+  U m_d1;
+  U m_d2;
+  BTypeNameLIN2(const U& val, BTypeNameHV<U>* pOp1, BTypeNameHV<U>* pOp2, const U& d1,
+                const U& d2)
+      : BinBTypeNameHV<U>(val, pOp1, pOp2), m_d1(d1), m_d2(d2)
+  {
+  }
+  virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+  {
+    this->op1()->add(bin, m_d1, this->m_derivatives);
+    this->op2()->add(bin, m_d2, this->m_derivatives);
+  }
+  virtual bool partials(U* d, U*) const
+  {
+    d[ 0 ] = m_d1;
+    d[ 1 ] = m_d2;
+    return false;
+  }
+  virtual bool hasSecondOrder() const { return false; }
+
+ private:
+  void operator=(const BTypeNameLIN2<U>&) {}  // not allowed
+};
+
+// Node with k recorded partial derivatives (see preacc.h):
+
+template <typename U>
+struct BTypeNameLINN : public BTypeNameHV<U>
+{
+  std::vector<BTypeNameHV<U>*> m_ops;
+  std::vector<U>               m_d;
+  BTypeNameLINN(const U& val, BTypeNameHV<U>* const* pOps, const unsigned int k)
+      : BTypeNameHV<U>(val), m_ops(pOps, pOps + k), m_d(k)
+  {
+    for (unsigned int i = 0; i < k; ++i)
+      m_ops[ i ]->incRef();
+  }
+  virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+  {
+    for (unsigned int i = 0; i < m_ops.size(); ++i)
+      m_ops[ i ]->add(bin, m_d[ i ], this->m_derivatives);
   }
   virtual void propagateChildren(typename Derivatives<U>::RecycleBin& bin)
   {
-    m_pOp->decRef(bin, m_pOp);
+    for (unsigned int i = 0; i < m_ops.size(); ++i)
+      m_ops[ i ]->decRef(bin, m_ops[ i ]);
   }
-  virtual ~UnBTypeNameHV()
+  virtual unsigned int    arity() const { return (unsigned int)m_ops.size(); }
+  virtual BTypeNameHV<U>* operand(const unsigned int i) const { return m_ops[ i ]; }
+  virtual ~BTypeNameLINN()
   {
-    if (m_pOp)
-      m_pOp->decRef(m_pOp);
+    for (unsigned int i = 0; i < m_ops.size(); ++i)
+      if (m_ops[ i ])
+        m_ops[ i ]->decRef(m_ops[ i ]);
   }
-  BTypeNameHV<U>* op() { return m_pOp; }
+  virtual bool partials(U* d, U*) const
+  {
+    for (unsigned int i = 0; i < m_d.size(); ++i)
+      d[ i ] = m_d[ i ];
+    return false;
+  }
+  virtual bool hasSecondOrder() const { return false; }
+
+ private:
+  void operator=(const BTypeNameLINN<U>&) {}  // not allowed
 };
 
 // ADDITION:
@@ -513,6 +1196,11 @@ struct BTypeNameADD : public BinBTypeNameHV<U>
     this->op1()->add(bin, this->m_derivatives);
     this->op2()->add(bin, this->m_derivatives);
   }
+  virtual bool partials(U* d, U*) const
+  {
+    d[ 0 ] = d[ 1 ] = Op<U>::myOne();
+    return false;
+  }
 
  private:
   void operator=(const BTypeNameADD<U>&) {}  // not allowed
@@ -529,6 +1217,11 @@ struct BTypeNameADD1 : public UnBTypeNameHV<U>
   {
     this->op()->add(bin, this->m_derivatives);
   }
+  virtual bool partials(U* d, U*) const
+  {
+    d[ 0 ] = Op<U>::myOne();
+    return false;
+  }
 
  private:
   void operator=(const BTypeNameADD1<U, V>&) {}  // not allowed
@@ -545,6 +1238,11 @@ struct BTypeNameADD2 : public UnBTypeNameHV<U>
   {
     this->op()->add(bin, this->m_derivatives);
   }
+  virtual bool partials(U* d, U*) const
+  {
+    d[ 0 ] = Op<U>::myOne();
+    return false;
+  }
 
  private:
   void operator=(const BTypeNameADD2<U, V>&) {}  // not allowed
@@ -600,6 +1298,30 @@ BTypeName<U> operator+(const BTypeName<U>& val1, const V& b)
       new BTypeNameADD2<U, V>(val1.val() + b, val1.getBTypeNameHV(), b)));
 }
 
+// reloaded for mpreal
+inline BTypeName<mpreal> operator+(const BTypeName<mpreal>& val1, const BTypeName<mpreal>& val2)
+{
+  Op<mpreal>::mpreal_add(TEMP_RESULT, val1.val(), val2.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameADD<mpreal>(TEMP_RESULT, val1.getBTypeNameHV(), val2.getBTypeNameHV())));
+}
+// reloaded for mpreal
+template <typename V>
+BTypeName<mpreal> operator+(const V& a, const BTypeName<mpreal>& val2)
+{
+  Op<mpreal>::mpreal_add(TEMP_RESULT, a, val2.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameADD1<mpreal, V>(TEMP_RESULT, a, val2.getBTypeNameHV())));
+}
+// reloaded for mpreal
+template <typename V>
+BTypeName<mpreal> operator+(const BTypeName<mpreal>& val1, const V& b)
+{
+  Op<mpreal>::mpreal_add(TEMP_RESULT, val1.val(), b);
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameADD2<mpreal, V>(TEMP_RESULT, val1.getBTypeNameHV(), b)));
+}
+
 // SUBTRACTION:
 
 template <typename U>
@@ -614,6 +1336,13 @@ struct BTypeNameSUB : public BinBTypeNameHV<U>
     this->op1()->add(bin, this->m_derivatives);
     this->op2()->sub(bin, this->m_derivatives);
   }
+  virtual bool partials(U* d, U*) const
+  {
+    d[ 0 ] = Op<U>::myOne();
+    d[ 1 ] = Op<U>::myOne();
+    LocalOp<U>::neg(d[ 1 ]);
+    return false;
+  }
 
  private:
   void operator=(const BTypeNameSUB<U>&) {}  // not allowed
@@ -630,6 +1359,12 @@ struct BTypeNameSUB1 : public UnBTypeNameHV<U>
   {
     this->op()->sub(bin, this->m_derivatives);
   }
+  virtual bool partials(U* d, U*) const
+  {
+    d[ 0 ] = Op<U>::myOne();
+    LocalOp<U>::neg(d[ 0 ]);
+    return false;
+  }
 
  private:
   void operator=(const BTypeNameSUB1<U, V>&) {}  // not allowed
@@ -646,6 +1381,11 @@ struct BTypeNameSUB2 : public UnBTypeNameHV<U>
   {
     this->op()->add(bin, this->m_derivatives);
   }
+  virtual bool partials(U* d, U*) const
+  {
+    d[ 0 ] = Op<U>::myOne();
+    return false;
+  }
 
  private:
   void operator=(const BTypeNameSUB2<U, V>&) {}  // not allowed
@@ -701,6 +1441,30 @@ BTypeName<U> operator-(const BTypeName<U>& val1, const V& b)
       new BTypeNameSUB2<U, V>(val1.val() - b, val1.getBTypeNameHV(), b)));
 }
 
+// reloaded for mpreal
+inline BTypeName<mpreal> operator-(const BTypeName<mpreal>& val1, const BTypeName<mpreal>& val2)
+{
+  Op<mpreal>::mpreal_sub(TEMP_RESULT, val1.val(), val2.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameSUB<mpreal>(TEMP_RESULT, val1.getBTypeNameHV(), val2.getBTypeNameHV())));
+}
+// reloaded for mpreal
+template <typename V>
+BTypeName<mpreal> operator-(const V& a, const BTypeName<mpreal>& val2)
+{
+  Op<mpreal>::mpreal_sub(TEMP_RESULT, a, val2.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameSUB1<mpreal, V>(TEMP_RESULT, a, val2.getBTypeNameHV())));
+}
+// reloaded for mpreal
+template <typename V>
+BTypeName<mpreal> operator-(const BTypeName<mpreal>& val1, const V& b)
+{
+  Op<mpreal>::mpreal_sub(TEMP_RESULT, val1.val(), b);
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameSUB2<mpreal, V>(TEMP_RESULT, val1.getBTypeNameHV(), b)));
+}
+
 // MULTIPLICATION:
 
 template <typename U>
@@ -715,6 +1479,14 @@ struct BTypeNameMUL : public BinBTypeNameHV<U>
     this->op1()->add(bin, this->op2()->val(), this->m_derivatives);
     this->op2()->add(bin, this->op1()->val(), this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    d[ 0 ] = this->operand(1)->val();
+    d[ 1 ] = this->operand(0)->val();
+    dd[ 0 ] = dd[ 2 ] = Op<U>::myZero();
+    dd[ 1 ] = Op<U>::myOne();
+    return true;
+  }
 
  private:
   void operator=(const BTypeNameMUL<U>&) {}  // not allowed
@@ -731,6 +1503,11 @@ struct BTypeNameMUL1 : public UnBTypeNameHV<U>
   {
     this->op()->add(bin, m_a, this->m_derivatives);
   }
+  virtual bool partials(U* d, U*) const
+  {
+    d[ 0 ] = m_a;
+    return false;
+  }
 
  private:
   void operator=(const BTypeNameMUL1<U, V>&) {}  // not allowed
@@ -747,6 +1524,11 @@ struct BTypeNameMUL2 : public UnBTypeNameHV<U>
   {
     this->op()->add(bin, m_b, this->m_derivatives);
   }
+  virtual bool partials(U* d, U*) const
+  {
+    d[ 0 ] = m_b;
+    return false;
+  }
 
  private:
   void operator=(const BTypeNameMUL2<U, V>&) {}  // not allowed
@@ -802,6 +1584,30 @@ BTypeName<U> operator*(const BTypeName<U>& val1, const V& b)
       new BTypeNameMUL2<U, V>(val1.val() * b, val1.getBTypeNameHV(), b)));
 }
 
+// reloaded for mpreal
+inline BTypeName<mpreal> operator*(const BTypeName<mpreal>& val1, const BTypeName<mpreal>& val2)
+{
+  Op<mpreal>::mpreal_mul(TEMP_RESULT, val1.val(), val2.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameMUL<mpreal>(TEMP_RESULT, val1.getBTypeNameHV(), val2.getBTypeNameHV())));
+}
+// reloaded for mpreal
+template <typename V>
+BTypeName<mpreal> operator*(const V& a, const BTypeName<mpreal>& val2)
+{
+  Op<mpreal>::mpreal_mul(TEMP_RESULT, a, val2.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameMUL1<mpreal, V>(TEMP_RESULT, a, val2.getBTypeNameHV())));
+}
+// reloaded for mpreal
+template <typename V>
+BTypeName<mpreal> operator*(const BTypeName<mpreal>& val1, const V& b)
+{
+  Op<mpreal>::mpreal_mul(TEMP_RESULT, val1.val(), b);
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameMUL2<mpreal, V>(TEMP_RESULT, val1.getBTypeNameHV(), b)));
+}
+
 // DIVISION:
 
 template <typename U>
@@ -817,6 +1623,19 @@ struct BTypeNameDIV : public BinBTypeNameHV<U>
     this->op1()->add(bin, tmp, this->m_derivatives);
     this->op2()->sub(bin, tmp * this->val(), this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    LocalOp<U>::inv(d[ 0 ], this->operand(1)->val());
+    LocalOp<U>::mul(d[ 1 ], d[ 0 ], this->val());
+    LocalOp<U>::neg(d[ 1 ]);
+    dd[ 0 ] = Op<U>::myZero();
+    LocalOp<U>::sqr(dd[ 1 ], d[ 0 ]);
+    LocalOp<U>::neg(dd[ 1 ]);
+    LocalOp<U>::mul(dd[ 2 ], d[ 0 ], d[ 1 ]);
+    LocalOp<U>::add(dd[ 2 ], dd[ 2 ], dd[ 2 ]);
+    LocalOp<U>::neg(dd[ 2 ]);
+    return true;
+  }
 
  private:
   void operator=(const BTypeNameDIV<U>&) {}  // not allowed
@@ -833,6 +1652,16 @@ struct BTypeNameDIV1 : public UnBTypeNameHV<U>
   {
     this->op()->sub(bin, Op<U>::myInv(this->op()->val()) * this->val(), this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    const U& x(this->operand(0)->val());
+    LocalOp<U>::div(d[ 0 ], this->val(), x);
+    LocalOp<U>::neg(d[ 0 ]);
+    LocalOp<U>::div(dd[ 0 ], d[ 0 ], x);
+    LocalOp<U>::add(dd[ 0 ], dd[ 0 ], dd[ 0 ]);
+    LocalOp<U>::neg(dd[ 0 ]);
+    return true;
+  }
 
  private:
   void operator=(const BTypeNameDIV1<U, V>&) {}  // not allowed
@@ -849,6 +1678,12 @@ struct BTypeNameDIV2 : public UnBTypeNameHV<U>
   {
     this->op()->add(bin, Op<V>::myInv(m_b), this->m_derivatives);
   }
+  virtual bool partials(U* d, U*) const
+  {
+    d[ 0 ] = m_b;
+    LocalOp<U>::inv(d[ 0 ], d[ 0 ]);
+    return false;
+  }
 
  private:
   void operator=(const BTypeNameDIV2<U, V>&) {}  // not allowed
@@ -856,6 +1691,13 @@ struct BTypeNameDIV2 : public UnBTypeNameHV<U>
 template <typename U>
 BTypeName<U> operator/(const BTypeName<U>& val1, const BTypeName<U>& val2)
 {
+  if (RecordPartials::active())
+  {
+    U v(val1.val() / val2.val());
+    U d1(Op<U>::myInv(val2.val()));
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameLIN2<U>(
+        v, val1.getBTypeNameHV(), val2.getBTypeNameHV(), d1, Op<U>::myNeg(d1 * v))));
+  }
   return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
       new BTypeNameDIV<U>(val1.val() / val2.val(), val1.getBTypeNameHV(), val2.getBTypeNameHV())));
 }
@@ -894,6 +1736,12 @@ BTypeName<U> operator/(const BTypeName<U>& val1, const typename Op<U>::Base& b)
 template <typename U, typename V>
 BTypeName<U> operator/(const V& a, const BTypeName<U>& val2)
 {
+  if (RecordPartials::active())
+  {
+    U v(a / val2.val());
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
+        new BTypeNameLIN1<U>(v, val2.getBTypeNameHV(), Op<U>::myNeg(v / val2.val()))));
+  }
   return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
       new BTypeNameDIV1<U, V>(a / val2.val(), a, val2.getBTypeNameHV())));
 }
@@ -904,6 +1752,110 @@ BTypeName<U> operator/(const BTypeName<U>& val1, const V& b)
       new BTypeNameDIV2<U, V>(val1.val() / b, val1.getBTypeNameHV(), b)));
 }
 
+// SPECIALIZED DIV
+template <>
+inline void BTypeNameDIV<mpreal>::propagate(Derivatives<mpreal>::RecycleBin& bin)
+{
+  Op<mpreal>::mpreal_inv(TEMP_RESULT, this->op2()->val());
+  this->op1()->add(bin, TEMP_RESULT, this->m_derivatives);
+  Op<mpreal>::mpreal_mul(TEMP_RESULT, TEMP_RESULT, this->val());
+  this->op2()->sub(bin, TEMP_RESULT, this->m_derivatives);
+}
+// SPECIALIZED DIV1
+template <typename V>
+struct BTypeNameDIV1<mpreal, V> : public UnBTypeNameHV<mpreal>
+{
+  const V m_a;
+  BTypeNameDIV1(const mpreal& val, const V& a, BTypeNameHV<mpreal>* pOp2)
+      : UnBTypeNameHV<mpreal>(val, pOp2), m_a(a)
+  {
+  }
+  virtual void propagate(Derivatives<mpreal>::RecycleBin& bin)
+  {
+    Op<mpreal>::mpreal_div(TEMP_RESULT, this->val(), this->op()->val());
+    this->op()->sub(bin, TEMP_RESULT, this->m_derivatives);
+  }
+  virtual bool partials(mpreal* d, mpreal* dd) const
+  {
+    const mpreal& x(this->operand(0)->val());
+    LocalOp<mpreal>::div(d[ 0 ], this->val(), x);
+    LocalOp<mpreal>::neg(d[ 0 ]);
+    LocalOp<mpreal>::div(dd[ 0 ], d[ 0 ], x);
+    LocalOp<mpreal>::add(dd[ 0 ], dd[ 0 ], dd[ 0 ]);
+    LocalOp<mpreal>::neg(dd[ 0 ]);
+    return true;
+  }
+
+ private:
+  void operator=(const BTypeNameDIV1<mpreal, V>&) {}  // not allowed
+};
+// SPECIALIZED DIV2
+template <typename V>
+struct BTypeNameDIV2<mpreal, V> : public UnBTypeNameHV<mpreal>
+{
+  const V m_b;
+  BTypeNameDIV2(const mpreal& val, BTypeNameHV<mpreal>* pOp1, const V& b)
+      : UnBTypeNameHV<mpreal>(val, pOp1), m_b(b)
+  {
+  }
+  virtual void propagate(Derivatives<mpreal>::RecycleBin& bin)
+  {
+    TEMP_RESULT = m_b;
+    Op<mpreal>::mpreal_inv(TEMP_RESULT, TEMP_RESULT);
+    this->op()->add(bin, TEMP_RESULT, this->m_derivatives);
+  }
+  virtual bool partials(mpreal* d, mpreal*) const
+  {
+    d[ 0 ] = m_b;
+    LocalOp<mpreal>::inv(d[ 0 ], d[ 0 ]);
+    return false;
+  }
+
+ private:
+  void operator=(const BTypeNameDIV2<mpreal, V>&) {}  // not allowed
+};
+// reloaded for mpreal
+inline BTypeName<mpreal> operator/(const BTypeName<mpreal>& val1, const BTypeName<mpreal>& val2)
+{
+  if (RecordPartials::active())
+  {
+    Op<mpreal>::mpreal_div(TEMP_RESULT, val1.val(), val2.val());
+    Op<mpreal>::mpreal_inv(TEMP_RESULT1, val2.val());
+    BTypeNameLIN2<mpreal>* pHV = new BTypeNameLIN2<mpreal>(
+        TEMP_RESULT, val1.getBTypeNameHV(), val2.getBTypeNameHV(), TEMP_RESULT1, TEMP_RESULT1);
+    Op<mpreal>::mpreal_mul(pHV->m_d2, TEMP_RESULT1, TEMP_RESULT);
+    Op<mpreal>::mpreal_neg(pHV->m_d2, pHV->m_d2);
+    return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(pHV));
+  }
+  Op<mpreal>::mpreal_div(TEMP_RESULT, val1.val(), val2.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameDIV<mpreal>(TEMP_RESULT, val1.getBTypeNameHV(), val2.getBTypeNameHV())));
+}
+// reloaded for mpreal
+template <typename V>
+BTypeName<mpreal> operator/(const V& a, const BTypeName<mpreal>& val2)
+{
+  if (RecordPartials::active())
+  {
+    Op<mpreal>::mpreal_div(TEMP_RESULT, a, val2.val());
+    Op<mpreal>::mpreal_div(TEMP_RESULT1, TEMP_RESULT, val2.val());
+    Op<mpreal>::mpreal_neg(TEMP_RESULT1, TEMP_RESULT1);
+    return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+        new BTypeNameLIN1<mpreal>(TEMP_RESULT, val2.getBTypeNameHV(), TEMP_RESULT1)));
+  }
+  Op<mpreal>::mpreal_div(TEMP_RESULT, a, val2.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameDIV1<mpreal, V>(TEMP_RESULT, a, val2.getBTypeNameHV())));
+}
+// reloaded for mpreal
+template <typename V>
+BTypeName<mpreal> operator/(const BTypeName<mpreal>& val1, const V& b)
+{
+  Op<mpreal>::mpreal_div(TEMP_RESULT, val1.val(), b);
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameDIV2<mpreal, V>(TEMP_RESULT, val1.getBTypeNameHV(), b)));
+}
+
 // COMPOUND ASSIGNMENTS:
 
 template <typename U>
@@ -961,6 +1913,12 @@ struct BTypeNameUMINUS : public UnBTypeNameHV<U>
   {
     this->op()->sub(bin, this->m_derivatives);
   }
+  virtual bool partials(U* d, U*) const
+  {
+    d[ 0 ] = Op<U>::myOne();
+    LocalOp<U>::neg(d[ 0 ]);
+    return false;
+  }
 
  private:
   void operator=(const BTypeNameUMINUS<U>&) {}  // not allowed
@@ -973,6 +1931,14 @@ BTypeName<U> operator-(const BTypeName<U>& val)
       new BTypeNameUMINUS<U>(Op<U>::myNeg(val.val()), val.getBTypeNameHV())));
 }
 
+// reloaded for mpreal
+inline BTypeName<mpreal> operator-(const BTypeName<mpreal>& val)
+{
+  Op<mpreal>::mpreal_neg(TEMP_RESULT, val.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameUMINUS<mpreal>(TEMP_RESULT, val.getBTypeNameHV())));
+}
+
 // UNARY PLUS
 
 template <typename U>
@@ -983,6 +1949,11 @@ struct BTypeNameUPLUS : public UnBTypeNameHV<U>
   {
     this->op()->add(bin, this->m_derivatives);
   }
+  virtual bool partials(U* d, U*) const
+  {
+    d[ 0 ] = Op<U>::myOne();
+    return false;
+  }
 
  private:
   void operator=(const BTypeNameUPLUS<U>&) {}  // not allowed
@@ -995,6 +1966,13 @@ BTypeName<U> operator+(const BTypeName<U>& val)
       new BTypeNameUPLUS<U>(Op<U>::myPos(val.val()), val.getBTypeNameHV())));
 }
 
+// reloaded for mpreal
+inline BTypeName<mpreal> operator+(const BTypeName<mpreal>& val)
+{
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameUPLUS<mpreal>(val.val(), val.getBTypeNameHV())));
+}
+
 // POWER
 
 template <typename U>
@@ -1012,6 +1990,25 @@ struct BTypeNamePOW : public BinBTypeNameHV<U>
     this->op1()->add(bin, tmp1, this->m_derivatives);
     this->op2()->add(bin, tmp2, this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    const U& x(this->operand(0)->val());
+    const U& y(this->operand(1)->val());
+    U one(Op<U>::myOne()), e, lx;
+    LocalOp<U>::sub(e, y, one);
+    LocalOp<U>::pow(dd[ 1 ], x, e);  // x^(y-1)
+    LocalOp<U>::mul(d[ 0 ], y, dd[ 1 ]);
+    LocalOp<U>::log(lx, x);
+    LocalOp<U>::mul(d[ 1 ], this->val(), lx);
+    LocalOp<U>::mul(dd[ 2 ], d[ 1 ], lx);
+    LocalOp<U>::sub(one, e, one);
+    LocalOp<U>::pow(dd[ 0 ], x, one);  // x^(y-2)
+    LocalOp<U>::mul(dd[ 0 ], dd[ 0 ], e);
+    LocalOp<U>::mul(dd[ 0 ], dd[ 0 ], y);
+    LocalOp<U>::mul(lx, lx, d[ 0 ]);
+    LocalOp<U>::add(dd[ 1 ], dd[ 1 ], lx);
+    return true;
+  }
 
  private:
   void operator=(const BTypeNamePOW<U>&) {}  // not allowed
@@ -1029,6 +2026,14 @@ struct BTypeNamePOW1 : public UnBTypeNameHV<U>
     U tmp2(this->val() * Op<V>::myLog(m_a));
     this->op()->add(bin, tmp2, this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    d[ 0 ] = m_a;
+    LocalOp<U>::log(dd[ 0 ], d[ 0 ]);
+    LocalOp<U>::mul(d[ 0 ], this->val(), dd[ 0 ]);
+    LocalOp<U>::mul(dd[ 0 ], dd[ 0 ], d[ 0 ]);
+    return true;
+  }
 
  private:
   void operator=(const BTypeNamePOW1<U, V>&) {}  // not allowed
@@ -1046,6 +2051,22 @@ struct BTypeNamePOW2 : public UnBTypeNameHV<U>
     U tmp1(m_b * Op<U>::myPow(this->op()->val(), m_b - Op<V>::myOne()));
     this->op()->add(bin, tmp1, this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    const U& x(this->operand(0)->val());
+    U b(m_b), e(m_b);
+    d[ 0 ] = Op<U>::myOne();
+    LocalOp<U>::sub(e, e, d[ 0 ]);
+    LocalOp<U>::pow(d[ 0 ], x, e);  // x^(b-1)
+    LocalOp<U>::mul(d[ 0 ], d[ 0 ], b);
+    b = Op<U>::myOne();
+    LocalOp<U>::sub(b, e, b);
+    LocalOp<U>::pow(dd[ 0 ], x, b);  // x^(b-2)
+    LocalOp<U>::mul(dd[ 0 ], dd[ 0 ], e);
+    b = m_b;
+    LocalOp<U>::mul(dd[ 0 ], dd[ 0 ], b);
+    return true;
+  }
 
  private:
   void operator=(const BTypeNamePOW2<U, V>&) {}  // not allowed
@@ -1053,6 +2074,13 @@ struct BTypeNamePOW2 : public UnBTypeNameHV<U>
 template <typename U>
 BTypeName<U> pow(const BTypeName<U>& val1, const BTypeName<U>& val2)
 {
+  if (RecordPartials::active())
+  {
+    U v(Op<U>::myPow(val1.val(), val2.val()));
+    U d1(val2.val() * Op<U>::myPow(val1.val(), val2.val() - Op<U>::myOne()));
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameLIN2<U>(
+        v, val1.getBTypeNameHV(), val2.getBTypeNameHV(), d1, v * Op<U>::myLog(val1.val()))));
+  }
   return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNamePOW<U>(
       Op<U>::myPow(val1.val(), val2.val()), val1.getBTypeNameHV(), val2.getBTypeNameHV())));
 }
@@ -1093,16 +2121,158 @@ val1.getBTypeNameHV(), b)
 template <typename U, typename V>
 BTypeName<U> pow(const V& a, const BTypeName<U>& val2)
 {
+  if (RecordPartials::active())
+  {
+    U v(Op<U>::myPow(a, val2.val()));
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
+        new BTypeNameLIN1<U>(v, val2.getBTypeNameHV(), v * Op<V>::myLog(a))));
+  }
   return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
       new BTypeNamePOW1<U, V>(Op<U>::myPow(a, val2.val()), a, val2.getBTypeNameHV())));
 }
 template <typename U, typename V>
 BTypeName<U> pow(const BTypeName<U>& val1, const V& b)
 {
+  if (RecordPartials::active())
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameLIN1<U>(
+        Op<U>::myPow(val1.val(), b), val1.getBTypeNameHV(),
+        b * Op<U>::myPow(val1.val(), b - Op<V>::myOne()))));
   return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
       new BTypeNamePOW2<U, V>(Op<U>::myPow(val1.val(), b), val1.getBTypeNameHV(), b)));
 }
 
+// SPECIALIZED POW
+template <>
+inline void BTypeNamePOW<mpreal>::propagate(Derivatives<mpreal>::RecycleBin& bin)
+{
+  Op<mpreal>::mpreal_sub(TEMP_RESULT, this->op2()->val(), 1.0);
+  Op<mpreal>::mpreal_pow(TEMP_RESULT, this->op1()->val(), TEMP_RESULT);
+  Op<mpreal>::mpreal_mul(TEMP_RESULT, TEMP_RESULT, this->op2()->val());
+  this->op1()->add(bin, TEMP_RESULT, this->m_derivatives);
+  Op<mpreal>::mpreal_log(TEMP_RESULT, this->op1()->val());
+  Op<mpreal>::mpreal_mul(TEMP_RESULT, TEMP_RESULT, this->val());
+  this->op2()->add(bin, TEMP_RESULT, this->m_derivatives);
+}
+// SPECIALIZED POW1
+template <typename V>
+struct BTypeNamePOW1<mpreal, V> : public UnBTypeNameHV<mpreal>
+{
+  const V m_a;
+  BTypeNamePOW1(const mpreal& val, const V& a, BTypeNameHV<mpreal>* pOp2)
+      : UnBTypeNameHV<mpreal>(val, pOp2), m_a(a)
+  {
+  }
+  virtual void propagate(Derivatives<mpreal>::RecycleBin& bin)
+  {
+    TEMP_RESULT = m_a;
+    Op<mpreal>::mpreal_log(TEMP_RESULT, TEMP_RESULT);
+    Op<mpreal>::mpreal_mul(TEMP_RESULT, TEMP_RESULT, this->val());
+    this->op()->add(bin, TEMP_RESULT, this->m_derivatives);
+  }
+  virtual bool partials(mpreal* d, mpreal* dd) const
+  {
+    d[ 0 ] = m_a;
+    LocalOp<mpreal>::log(dd[ 0 ], d[ 0 ]);
+    LocalOp<mpreal>::mul(d[ 0 ], this->val(), dd[ 0 ]);
+    LocalOp<mpreal>::mul(dd[ 0 ], dd[ 0 ], d[ 0 ]);
+    return true;
+  }
+
+ private:
+  void operator=(const BTypeNamePOW1<mpreal, V>&) {}  // not allowed
+};
+// SPECIALIZED POW2
+template <typename V>
+struct BTypeNamePOW2<mpreal, V> : public UnBTypeNameHV<mpreal>
+{
+  const V m_b;
+  BTypeNamePOW2(const mpreal& val, BTypeNameHV<mpreal>* pOp1, const V& b)
+      : UnBTypeNameHV<mpreal>(val, pOp1), m_b(b)
+  {
+  }
+  virtual void propagate(Derivatives<mpreal>::RecycleBin& bin)
+  {
+    TEMP_RESULT1 = m_b;
+    Op<mpreal>::mpreal_sub(TEMP_RESULT, TEMP_RESULT1, 1.0);
+    Op<mpreal>::mpreal_pow(TEMP_RESULT, this->op()->val(), TEMP_RESULT);
+    Op<mpreal>::mpreal_mul(TEMP_RESULT, TEMP_RESULT, TEMP_RESULT1);
+    this->op()->add(bin, TEMP_RESULT, this->m_derivatives);
+  }
+  virtual bool partials(mpreal* d, mpreal* dd) const
+  {
+    const mpreal& x(this->operand(0)->val());
+    mpreal b(m_b), e(m_b);
+    d[ 0 ] = Op<mpreal>::myOne();
+    LocalOp<mpreal>::sub(e, e, d[ 0 ]);
+    LocalOp<mpreal>::pow(d[ 0 ], x, e);  // x^(b-1)
+    LocalOp<mpreal>::mul(d[ 0 ], d[ 0 ], b);
+    b = Op<mpreal>::myOne();
+    LocalOp<mpreal>::sub(b, e, b);
+    LocalOp<mpreal>::pow(dd[ 0 ], x, b);  // x^(b-2)
+    LocalOp<mpreal>::mul(dd[ 0 ], dd[ 0 ], e);
+    b = m_b;
+    LocalOp<mpreal>::mul(dd[ 0 ], dd[ 0 ], b);
+    return true;
+  }
+
+ private:
+  void operator=(const BTypeNamePOW2<mpreal, V>&) {}  // not allowed
+};
+// reloaded pow for mpreal
+inline BTypeName<mpreal> pow(const BTypeName<mpreal>& val1, const BTypeName<mpreal>& val2)
+{
+  if (RecordPartials::active())
+  {
+    Op<mpreal>::mpreal_pow(TEMP_RESULT, val1.val(), val2.val());
+    Op<mpreal>::mpreal_log(TEMP_RESULT1, val1.val());
+    Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT1, TEMP_RESULT);
+    BTypeNameLIN2<mpreal>* pHV = new BTypeNameLIN2<mpreal>(
+        TEMP_RESULT, val1.getBTypeNameHV(), val2.getBTypeNameHV(), TEMP_RESULT1, TEMP_RESULT1);
+    Op<mpreal>::mpreal_sub(pHV->m_d1, val2.val(), 1.0);
+    Op<mpreal>::mpreal_pow(pHV->m_d1, val1.val(), pHV->m_d1);
+    Op<mpreal>::mpreal_mul(pHV->m_d1, pHV->m_d1, val2.val());
+    return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(pHV));
+  }
+  Op<mpreal>::mpreal_pow(TEMP_RESULT, val1.val(), val2.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNamePOW<mpreal>(TEMP_RESULT, val1.getBTypeNameHV(), val2.getBTypeNameHV())));
+}
+// reloaded pow for mpreal
+template <typename V>
+BTypeName<mpreal> pow(const V& a, const BTypeName<mpreal>& val2)
+{
+  if (RecordPartials::active())
+  {
+    Op<mpreal>::mpreal_pow(TEMP_RESULT, a, val2.val());
+    TEMP_RESULT1 = a;
+    Op<mpreal>::mpreal_log(TEMP_RESULT1, TEMP_RESULT1);
+    Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT1, TEMP_RESULT);
+    return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+        new BTypeNameLIN1<mpreal>(TEMP_RESULT, val2.getBTypeNameHV(), TEMP_RESULT1)));
+  }
+  Op<mpreal>::mpreal_pow(TEMP_RESULT, a, val2.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNamePOW1<mpreal, V>(TEMP_RESULT, a, val2.getBTypeNameHV())));
+}
+// reloaded pow for mpreal
+template <typename V>
+BTypeName<mpreal> pow(const BTypeName<mpreal>& val1, const V& b)
+{
+  if (RecordPartials::active())
+  {
+    Op<mpreal>::mpreal_pow(TEMP_RESULT, val1.val(), b);
+    TEMP_RESULT1 = b;
+    Op<mpreal>::mpreal_sub(TEMP_RESULT1, TEMP_RESULT1, 1.0);
+    Op<mpreal>::mpreal_pow(TEMP_RESULT1, val1.val(), TEMP_RESULT1);
+    Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT1, b);
+    return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+        new BTypeNameLIN1<mpreal>(TEMP_RESULT, val1.getBTypeNameHV(), TEMP_RESULT1)));
+  }
+  Op<mpreal>::mpreal_pow(TEMP_RESULT, val1.val(), b);
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNamePOW2<mpreal, V>(TEMP_RESULT, val1.getBTypeNameHV(), b)));
+}
+
 // SQR
 
 template <typename U>
@@ -1114,6 +2284,13 @@ struct BTypeNameSQR : public UnBTypeNameHV<U>
     U tmp(Op<U>::myTwo() * this->op()->val());
     this->op()->add(bin, tmp, this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    const U& x(this->operand(0)->val());
+    LocalOp<U>::add(d[ 0 ], x, x);
+    dd[ 0 ] = Op<U>::myTwo();
+    return true;
+  }
 
  private:
   void operator=(const BTypeNameSQR<U>&) {}  // not allowed
@@ -1125,6 +2302,21 @@ BTypeName<U> sqr(const BTypeName<U>& val)
       new BTypeNameSQR<U>(Op<U>::mySqr(val.val()), val.getBTypeNameHV())));
 }
 
+// SPECIALIZED SQR
+template <>
+inline void BTypeNameSQR<mpreal>::propagate(Derivatives<mpreal>::RecycleBin& bin)
+{
+  Op<mpreal>::mpreal_mul(TEMP_RESULT, this->op()->val(), 2.0);
+  this->op()->add(bin, TEMP_RESULT, this->m_derivatives);
+}
+// reloaded sqr for mpreal
+inline BTypeName<mpreal> sqr(const BTypeName<mpreal>& val)
+{
+  Op<mpreal>::mpreal_sqr(TEMP_RESULT, val.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameSQR<mpreal>(TEMP_RESULT, val.getBTypeNameHV())));
+}
+
 // SQRT
 
 template <typename U>
@@ -1136,6 +2328,15 @@ struct BTypeNameSQRT : public UnBTypeNameHV<U>
     U tmp(Op<U>::myInv(this->val() * Op<U>::myTwo()));
     this->op()->add(bin, tmp, this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    LocalOp<U>::add(d[ 0 ], this->val(), this->val());
+    LocalOp<U>::inv(d[ 0 ], d[ 0 ]);
+    LocalOp<U>::sqr(dd[ 0 ], d[ 0 ]);
+    LocalOp<U>::div(dd[ 0 ], dd[ 0 ], this->val());
+    LocalOp<U>::neg(dd[ 0 ]);
+    return true;
+  }
 
  private:
   void operator=(const BTypeNameSQRT<U>&) {}  // not allowed
@@ -1143,10 +2344,40 @@ struct BTypeNameSQRT : public UnBTypeNameHV<U>
 template <typename U>
 BTypeName<U> sqrt(const BTypeName<U>& val)
 {
+  if (RecordPartials::active())
+  {
+    U v(Op<U>::mySqrt(val.val()));
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
+        new BTypeNameLIN1<U>(v, val.getBTypeNameHV(), Op<U>::myInv(v * Op<U>::myTwo()))));
+  }
   return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
       new BTypeNameSQRT<U>(Op<U>::mySqrt(val.val()), val.getBTypeNameHV())));
 }
 
+// SPECIALIZED SQRT
+template <>
+inline void BTypeNameSQRT<mpreal>::propagate(Derivatives<mpreal>::RecycleBin& bin)
+{
+  Op<mpreal>::mpreal_mul(TEMP_RESULT, this->val(), 2.0);
+  Op<mpreal>::mpreal_inv(TEMP_RESULT, TEMP_RESULT);
+  this->op()->add(bin, TEMP_RESULT, this->m_derivatives);
+}
+// reloaded sqrt for mpreal
+inline BTypeName<mpreal> sqrt(const BTypeName<mpreal>& val)
+{
+  if (RecordPartials::active())
+  {
+    Op<mpreal>::mpreal_sqrt(TEMP_RESULT, val.val());
+    Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT, 2.0);
+    Op<mpreal>::mpreal_inv(TEMP_RESULT1, TEMP_RESULT1);
+    return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+        new BTypeNameLIN1<mpreal>(TEMP_RESULT, val.getBTypeNameHV(), TEMP_RESULT1)));
+  }
+  Op<mpreal>::mpreal_sqrt(TEMP_RESULT, val.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameSQRT<mpreal>(TEMP_RESULT, val.getBTypeNameHV())));
+}
+
 // EXP
 
 template <typename U>
@@ -1157,6 +2388,11 @@ struct BTypeNameEXP : public UnBTypeNameHV<U>
   {
     this->op()->add(bin, this->val(), this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    d[ 0 ] = dd[ 0 ] = this->val();
+    return true;
+  }
 
  private:
   void operator=(const BTypeNameEXP<U>&) {}  // not allowed
@@ -1168,6 +2404,14 @@ BTypeName<U> exp(const BTypeName<U>& val)
       new BTypeNameEXP<U>(Op<U>::myExp(val.val()), val.getBTypeNameHV())));
 }
 
+// reloaded exp for mpreal
+inline BTypeName<mpreal> exp(const BTypeName<mpreal>& val)
+{
+  Op<mpreal>::mpreal_exp(TEMP_RESULT, val.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameEXP<mpreal>(TEMP_RESULT, val.getBTypeNameHV())));
+}
+
 // LOG
 
 template <typename U>
@@ -1178,6 +2422,13 @@ struct BTypeNameLOG : public UnBTypeNameHV<U>
   {
     this->op()->add(bin, Op<U>::myInv(this->op()->val()), this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    LocalOp<U>::inv(d[ 0 ], this->operand(0)->val());
+    LocalOp<U>::sqr(dd[ 0 ], d[ 0 ]);
+    LocalOp<U>::neg(dd[ 0 ]);
+    return true;
+  }
 
  private:
   void operator=(const BTypeNameLOG<U>&) {}  // not allowed
@@ -1185,20 +2436,55 @@ struct BTypeNameLOG : public UnBTypeNameHV<U>
 template <typename U>
 BTypeName<U> log(const BTypeName<U>& val)
 {
+  if (RecordPartials::active())
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameLIN1<U>(
+        Op<U>::myLog(val.val()), val.getBTypeNameHV(), Op<U>::myInv(val.val()))));
   return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
       new BTypeNameLOG<U>(Op<U>::myLog(val.val()), val.getBTypeNameHV())));
 }
 
+// SPECIALIZED LOG
+template <>
+inline void BTypeNameLOG<mpreal>::propagate(Derivatives<mpreal>::RecycleBin& bin)
+{
+  Op<mpreal>::mpreal_inv(TEMP_RESULT, this->op()->val());
+  this->op()->add(bin, TEMP_RESULT, this->m_derivatives);
+}
+// reloaded log for mpreal
+inline BTypeName<mpreal> log(const BTypeName<mpreal>& val)
+{
+  if (RecordPartials::active())
+  {
+    Op<mpreal>::mpreal_log(TEMP_RESULT, val.val());
+    Op<mpreal>::mpreal_inv(TEMP_RESULT1, val.val());
+    return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+        new BTypeNameLIN1<mpreal>(TEMP_RESULT, val.getBTypeNameHV(), TEMP_RESULT1)));
+  }
+  Op<mpreal>::mpreal_log(TEMP_RESULT, val.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameLOG<mpreal>(TEMP_RESULT, val.getBTypeNameHV())));
+}
+
 // SIN
 
 template <typename U>
 struct BTypeNameSIN : public UnBTypeNameHV<U>
 {
-  BTypeNameSIN(const U& val, BTypeNameHV<U>* pOp) : UnBTypeNameHV<U>(val, pOp) {}
+  U m_cos;  // computed together with the value
+  BTypeNameSIN(const U& val, BTypeNameHV<U>* pOp, const U& cosVal)
+      : UnBTypeNameHV<U>(val, pOp), m_cos(cosVal)
+  {
+  }
   virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
   {
-    U tmp(Op<U>::myCos(this->op()->val()));
-    this->op()->add(bin, tmp, this->m_derivatives);
+    this->op()->add(bin, m_cos, this->m_derivatives);
+  }
+  virtual bool partials(U* d, U* dd) const
+  {
+    d[ 0 ]  = m_cos;
+    dd[ 0 ] = this->val();
+    LocalOp<U>::neg(dd[ 0 ]);
+    return true;
   }
 
  private:
@@ -1207,8 +2493,22 @@ struct BTypeNameSIN : public UnBTypeNameHV<U>
 template <typename U>
 BTypeName<U> sin(const BTypeName<U>& val)
 {
+  const U c(Op<U>::myCos(val.val()));
+  if (RecordPartials::active())
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
+        new BTypeNameLIN1<U>(Op<U>::mySin(val.val()), val.getBTypeNameHV(), c)));
   return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-      new BTypeNameSIN<U>(Op<U>::mySin(val.val()), val.getBTypeNameHV())));
+      new BTypeNameSIN<U>(Op<U>::mySin(val.val()), val.getBTypeNameHV(), c)));
+}
+// reloaded sin for mpreal
+inline BTypeName<mpreal> sin(const BTypeName<mpreal>& val)
+{
+  Op<mpreal>::mpreal_sin_cos(TEMP_RESULT, TEMP_RESULT1, val.val());
+  if (RecordPartials::active())
+    return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+        new BTypeNameLIN1<mpreal>(TEMP_RESULT, val.getBTypeNameHV(), TEMP_RESULT1)));
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameSIN<mpreal>(TEMP_RESULT, val.getBTypeNameHV(), TEMP_RESULT1)));
 }
 
 // COS
@@ -1216,11 +2516,22 @@ BTypeName<U> sin(const BTypeName<U>& val)
 template <typename U>
 struct BTypeNameCOS : public UnBTypeNameHV<U>
 {
-  BTypeNameCOS(const U& val, BTypeNameHV<U>* pOp) : UnBTypeNameHV<U>(val, pOp) {}
+  U m_sin;  // computed together with the value
+  BTypeNameCOS(const U& val, BTypeNameHV<U>* pOp, const U& sinVal)
+      : UnBTypeNameHV<U>(val, pOp), m_sin(sinVal)
+  {
+  }
   virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
   {
-    U tmp(Op<U>::mySin(this->op()->val()));
-    this->op()->sub(bin, tmp, this->m_derivatives);
+    this->op()->sub(bin, m_sin, this->m_derivatives);
+  }
+  virtual bool partials(U* d, U* dd) const
+  {
+    d[ 0 ] = m_sin;
+    LocalOp<U>::neg(d[ 0 ]);
+    dd[ 0 ] = this->val();
+    LocalOp<U>::neg(dd[ 0 ]);
+    return true;
   }
 
  private:
@@ -1229,8 +2540,25 @@ struct BTypeNameCOS : public UnBTypeNameHV<U>
 template <typename U>
 BTypeName<U> cos(const BTypeName<U>& val)
 {
+  const U s(Op<U>::mySin(val.val()));
+  if (RecordPartials::active())
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
+        new BTypeNameLIN1<U>(Op<U>::myCos(val.val()), val.getBTypeNameHV(), Op<U>::myNeg(s))));
   return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-      new BTypeNameCOS<U>(Op<U>::myCos(val.val()), val.getBTypeNameHV())));
+      new BTypeNameCOS<U>(Op<U>::myCos(val.val()), val.getBTypeNameHV(), s)));
+}
+// reloaded cos for mpreal
+inline BTypeName<mpreal> cos(const BTypeName<mpreal>& val)
+{
+  Op<mpreal>::mpreal_sin_cos(TEMP_RESULT1, TEMP_RESULT, val.val());
+  if (RecordPartials::active())
+  {
+    Op<mpreal>::mpreal_neg(TEMP_RESULT1, TEMP_RESULT1);
+    return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+        new BTypeNameLIN1<mpreal>(TEMP_RESULT, val.getBTypeNameHV(), TEMP_RESULT1)));
+  }
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameCOS<mpreal>(TEMP_RESULT, val.getBTypeNameHV(), TEMP_RESULT1)));
 }
 
 // TAN
@@ -1244,6 +2572,15 @@ struct BTypeNameTAN : public UnBTypeNameHV<U>
     U tmp(Op<U>::mySqr(this->val()) + Op<U>::myOne());
     this->op()->add(bin, tmp, this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    LocalOp<U>::sqr(d[ 0 ], this->val());
+    dd[ 0 ] = Op<U>::myOne();
+    LocalOp<U>::add(d[ 0 ], d[ 0 ], dd[ 0 ]);
+    LocalOp<U>::mul(dd[ 0 ], this->val(), d[ 0 ]);
+    LocalOp<U>::add(dd[ 0 ], dd[ 0 ], dd[ 0 ]);
+    return true;
+  }
 
  private:
   void operator=(const BTypeNameTAN<U>&) {}  // not allowed
@@ -1251,10 +2588,40 @@ struct BTypeNameTAN : public UnBTypeNameHV<U>
 template <typename U>
 BTypeName<U> tan(const BTypeName<U>& val)
 {
+  if (RecordPartials::active())
+  {
+    U v(Op<U>::myTan(val.val()));
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
+        new BTypeNameLIN1<U>(v, val.getBTypeNameHV(), Op<U>::mySqr(v) + Op<U>::myOne())));
+  }
   return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
       new BTypeNameTAN<U>(Op<U>::myTan(val.val()), val.getBTypeNameHV())));
 }
 
+// SPECIALIZED TAN
+template <>
+inline void BTypeNameTAN<mpreal>::propagate(Derivatives<mpreal>::RecycleBin& bin)
+{
+  Op<mpreal>::mpreal_sqr(TEMP_RESULT, this->val());
+  Op<mpreal>::mpreal_add(TEMP_RESULT, TEMP_RESULT, 1.0);
+  this->op()->add(bin, TEMP_RESULT, this->m_derivatives);
+}
+// reloaded tan for mpreal
+inline BTypeName<mpreal> tan(const BTypeName<mpreal>& val)
+{
+  if (RecordPartials::active())
+  {
+    Op<mpreal>::mpreal_tan(TEMP_RESULT, val.val());
+    Op<mpreal>::mpreal_sqr(TEMP_RESULT1, TEMP_RESULT);
+    Op<mpreal>::mpreal_add(TEMP_RESULT1, TEMP_RESULT1, 1.0);
+    return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+        new BTypeNameLIN1<mpreal>(TEMP_RESULT, val.getBTypeNameHV(), TEMP_RESULT1)));
+  }
+  Op<mpreal>::mpreal_tan(TEMP_RESULT, val.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameTAN<mpreal>(TEMP_RESULT, val.getBTypeNameHV())));
+}
+
 // ASIN
 
 template <typename U>
@@ -1266,6 +2633,19 @@ struct BTypeNameASIN : public UnBTypeNameHV<U>
     U tmp(Op<U>::myInv(Op<U>::mySqrt(Op<U>::myOne() - Op<U>::mySqr(this->op()->val()))));
     this->op()->add(bin, tmp, this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    const U& x(this->operand(0)->val());
+    LocalOp<U>::sqr(dd[ 0 ], x);
+    d[ 0 ] = Op<U>::myOne();
+    LocalOp<U>::sub(d[ 0 ], d[ 0 ], dd[ 0 ]);
+    LocalOp<U>::sqrt(d[ 0 ], d[ 0 ]);
+    LocalOp<U>::inv(d[ 0 ], d[ 0 ]);
+    LocalOp<U>::sqr(dd[ 0 ], d[ 0 ]);
+    LocalOp<U>::mul(dd[ 0 ], dd[ 0 ], d[ 0 ]);
+    LocalOp<U>::mul(dd[ 0 ], dd[ 0 ], x);
+    return true;
+  }
 
  private:
   void operator=(const BTypeNameASIN<U>&) {}  // not allowed
@@ -1273,10 +2653,44 @@ struct BTypeNameASIN : public UnBTypeNameHV<U>
 template <typename U>
 BTypeName<U> asin(const BTypeName<U>& val)
 {
+  if (RecordPartials::active())
+  {
+    const U d(Op<U>::myInv(Op<U>::mySqrt(Op<U>::myOne() - Op<U>::mySqr(val.val()))));
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
+        new BTypeNameLIN1<U>(Op<U>::myAsin(val.val()), val.getBTypeNameHV(), d)));
+  }
   return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
       new BTypeNameASIN<U>(Op<U>::myAsin(val.val()), val.getBTypeNameHV())));
 }
 
+// SPECIALIZED ASIN
+template <>
+inline void BTypeNameASIN<mpreal>::propagate(Derivatives<mpreal>::RecycleBin& bin)
+{
+  Op<mpreal>::mpreal_sqr(TEMP_RESULT, this->op()->val());
+  Op<mpreal>::mpreal_sub(TEMP_RESULT, 1.0, TEMP_RESULT);
+  Op<mpreal>::mpreal_sqrt(TEMP_RESULT, TEMP_RESULT);
+  Op<mpreal>::mpreal_inv(TEMP_RESULT, TEMP_RESULT);
+  this->op()->add(bin, TEMP_RESULT, this->m_derivatives);
+}
+// reloaded asin for mpreal
+inline BTypeName<mpreal> asin(const BTypeName<mpreal>& val)
+{
+  if (RecordPartials::active())
+  {
+    Op<mpreal>::mpreal_asin(TEMP_RESULT, val.val());
+    Op<mpreal>::mpreal_sqr(TEMP_RESULT1, val.val());
+    Op<mpreal>::mpreal_sub(TEMP_RESULT1, 1.0, TEMP_RESULT1);
+    Op<mpreal>::mpreal_sqrt(TEMP_RESULT1, TEMP_RESULT1);
+    Op<mpreal>::mpreal_inv(TEMP_RESULT1, TEMP_RESULT1);
+    return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+        new BTypeNameLIN1<mpreal>(TEMP_RESULT, val.getBTypeNameHV(), TEMP_RESULT1)));
+  }
+  Op<mpreal>::mpreal_asin(TEMP_RESULT, val.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameASIN<mpreal>(TEMP_RESULT, val.getBTypeNameHV())));
+}
+
 // ACOS
 
 template <typename U>
@@ -1288,6 +2702,21 @@ struct BTypeNameACOS : public UnBTypeNameHV<U>
     U tmp(Op<U>::myInv(Op<U>::mySqrt(Op<U>::myOne() - Op<U>::mySqr(this->op()->val()))));
     this->op()->sub(bin, tmp, this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    const U& x(this->operand(0)->val());
+    LocalOp<U>::sqr(dd[ 0 ], x);
+    d[ 0 ] = Op<U>::myOne();
+    LocalOp<U>::sub(d[ 0 ], d[ 0 ], dd[ 0 ]);
+    LocalOp<U>::sqrt(d[ 0 ], d[ 0 ]);
+    LocalOp<U>::inv(d[ 0 ], d[ 0 ]);
+    LocalOp<U>::sqr(dd[ 0 ], d[ 0 ]);
+    LocalOp<U>::mul(dd[ 0 ], dd[ 0 ], d[ 0 ]);
+    LocalOp<U>::mul(dd[ 0 ], dd[ 0 ], x);
+    LocalOp<U>::neg(d[ 0 ]);
+    LocalOp<U>::neg(dd[ 0 ]);
+    return true;
+  }
 
  private:
   void operator=(const BTypeNameACOS<U>&) {}  // not allowed
@@ -1295,10 +2724,45 @@ struct BTypeNameACOS : public UnBTypeNameHV<U>
 template <typename U>
 BTypeName<U> acos(const BTypeName<U>& val)
 {
+  if (RecordPartials::active())
+  {
+    const U d(Op<U>::myNeg(Op<U>::myInv(Op<U>::mySqrt(Op<U>::myOne() - Op<U>::mySqr(val.val())))));
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
+        new BTypeNameLIN1<U>(Op<U>::myAcos(val.val()), val.getBTypeNameHV(), d)));
+  }
   return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
       new BTypeNameACOS<U>(Op<U>::myAcos(val.val()), val.getBTypeNameHV())));
 }
 
+// SPECIALIZED ACOS
+template <>
+inline void BTypeNameACOS<mpreal>::propagate(Derivatives<mpreal>::RecycleBin& bin)
+{
+  Op<mpreal>::mpreal_sqr(TEMP_RESULT, this->op()->val());
+  Op<mpreal>::mpreal_sub(TEMP_RESULT, 1.0, TEMP_RESULT);
+  Op<mpreal>::mpreal_sqrt(TEMP_RESULT, TEMP_RESULT);
+  Op<mpreal>::mpreal_inv(TEMP_RESULT, TEMP_RESULT);
+  this->op()->sub(bin, TEMP_RESULT, this->m_derivatives);
+}
+// reloaded acos for mpreal
+inline BTypeName<mpreal> acos(const BTypeName<mpreal>& val)
+{
+  if (RecordPartials::active())
+  {
+    Op<mpreal>::mpreal_acos(TEMP_RESULT, val.val());
+    Op<mpreal>::mpreal_sqr(TEMP_RESULT1, val.val());
+    Op<mpreal>::mpreal_sub(TEMP_RESULT1, 1.0, TEMP_RESULT1);
+    Op<mpreal>::mpreal_sqrt(TEMP_RESULT1, TEMP_RESULT1);
+    Op<mpreal>::mpreal_inv(TEMP_RESULT1, TEMP_RESULT1);
+    Op<mpreal>::mpreal_neg(TEMP_RESULT1, TEMP_RESULT1);
+    return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+        new BTypeNameLIN1<mpreal>(TEMP_RESULT, val.getBTypeNameHV(), TEMP_RESULT1)));
+  }
+  Op<mpreal>::mpreal_acos(TEMP_RESULT, val.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameACOS<mpreal>(TEMP_RESULT, val.getBTypeNameHV())));
+}
+
 // ATAN
 
 template <typename U>
@@ -1310,6 +2774,19 @@ struct BTypeNameATAN : public UnBTypeNameHV<U>
     U tmp(Op<U>::myInv(Op<U>::mySqr(this->op()->val()) + Op<U>::myOne()));
     this->op()->add(bin, tmp, this->m_derivatives);
   }
+  virtual bool partials(U* d, U* dd) const
+  {
+    const U& x(this->operand(0)->val());
+    LocalOp<U>::sqr(d[ 0 ], x);
+    dd[ 0 ] = Op<U>::myOne();
+    LocalOp<U>::add(d[ 0 ], d[ 0 ], dd[ 0 ]);
+    LocalOp<U>::inv(d[ 0 ], d[ 0 ]);
+    LocalOp<U>::sqr(dd[ 0 ], d[ 0 ]);
+    LocalOp<U>::mul(dd[ 0 ], dd[ 0 ], x);
+    LocalOp<U>::add(dd[ 0 ], dd[ 0 ], dd[ 0 ]);
+    LocalOp<U>::neg(dd[ 0 ]);
+    return true;
+  }
 
  private:
   void operator=(const BTypeNameATAN<U>&) {}  // not allowed
@@ -1317,10 +2794,42 @@ struct BTypeNameATAN : public UnBTypeNameHV<U>
 template <typename U>
 BTypeName<U> atan(const BTypeName<U>& val)
 {
+  if (RecordPartials::active())
+  {
+    const U d(Op<U>::myInv(Op<U>::mySqr(val.val()) + Op<U>::myOne()));
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
+        new BTypeNameLIN1<U>(Op<U>::myAtan(val.val()), val.getBTypeNameHV(), d)));
+  }
   return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
       new BTypeNameATAN<U>(Op<U>::myAtan(val.val()), val.getBTypeNameHV())));
 }
 
+// SPECIALIZED ATAN
+template <>
+inline void BTypeNameATAN<mpreal>::propagate(Derivatives<mpreal>::RecycleBin& bin)
+{
+  Op<mpreal>::mpreal_sqr(TEMP_RESULT, this->op()->val());
+  Op<mpreal>::mpreal_add(TEMP_RESULT, TEMP_RESULT, 1.0);
+  Op<mpreal>::mpreal_inv(TEMP_RESULT, TEMP_RESULT);
+  this->op()->add(bin, TEMP_RESULT, this->m_derivatives);
+}
+// reloaded atan for mpreal
+inline BTypeName<mpreal> atan(const BTypeName<mpreal>& val)
+{
+  if (RecordPartials::active())
+  {
+    Op<mpreal>::mpreal_atan(TEMP_RESULT, val.val());
+    Op<mpreal>::mpreal_sqr(TEMP_RESULT1, val.val());
+    Op<mpreal>::mpreal_add(TEMP_RESULT1, TEMP_RESULT1, 1.0);
+    Op<mpreal>::mpreal_inv(TEMP_RESULT1, TEMP_RESULT1);
+    return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+        new BTypeNameLIN1<mpreal>(TEMP_RESULT, val.getBTypeNameHV(), TEMP_RESULT1)));
+  }
+  Op<mpreal>::mpreal_atan(TEMP_RESULT, val.val());
+  return BTypeName<mpreal>(static_cast<BTypeNameHV<mpreal>*>(
+      new BTypeNameATAN<mpreal>(TEMP_RESULT, val.getBTypeNameHV())));
+}
+
 template <typename U>
 struct Op<BTypeName<U>>
 {
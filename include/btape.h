@@ -0,0 +1,917 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _BTAPE_H
+#define _BTAPE_H
+
+#include <cstdio>
+#include <deque>
+#include <new>
+#include <vector>
+
+#include "badiff.h"
+
+namespace fadbad
+{
+// Reading and writing of the values of a tape (tapespill.h), and their
+// size. The generic version copies the bytes and is meant for plain types
+// such as double; mpreal uses the portable format of mpfr_fpif_export,
+// which keeps the precision of every value.
+template <typename U>
+struct TapeIO
+{
+  static bool write(std::FILE* f, const U& x) { return std::fwrite(&x, sizeof(U), 1, f) == 1; }
+  static bool read(std::FILE* f, U& x) { return std::fread(&x, sizeof(U), 1, f) == 1; }
+  // Bytes that write() may take for x, whatever its value:
+  static std::size_t bound(const U&) { return sizeof(U); }
+  // Bytes held by x outside of its sizeof(U):
+  static std::size_t heap(const U&) { return 0; }
+};
+
+template <>
+struct TapeIO<mpreal>  // SPECIALIZED TEMPLATE FOR mpreal class:
+{
+  static bool write(std::FILE* f, const mpreal& x)
+  {
+    return mpfr_fpif_export(f, const_cast<mpfr_ptr>(x.mpfr_srcptr())) == 0;
+  }
+  static bool read(std::FILE* f, mpreal& x) { return mpfr_fpif_import(x.mpfr_ptr(), f) == 0; }
+  // The precision and the exponent take at most one byte more than their
+  // types, and the significand one byte per 8 bits of precision:
+  static std::size_t bound(const mpreal& x)
+  {
+    return 2 + sizeof(mpfr_prec_t) + sizeof(mpfr_exp_t) + (x.get_prec() + 7) / 8;
+  }
+  // MPFR allocates the significand with one limb more, for its size:
+  static std::size_t heap(const mpreal& x)
+  {
+    return mpfr_custom_get_size(x.get_prec()) + sizeof(mp_limb_t);
+  }
+};
+
+template <typename U, typename A>
+class TapeStore;
+
+// Conversion of a local partial derivative to the adjoint type of the
+// tape. It is done once per partial, so the sweep runs in the adjoint type.
+template <typename A, typename U>
+struct AdjointCast
+{
+  static A cast(const U& x) { return static_cast<A>(x); }
+};
+
+template <typename U>
+struct AdjointCast<U, U>
+{
+  static const U& cast(const U& x) { return x; }
+};
+
+// Updates of the adjoints by the sweep. For mpreal they are rounded to the
+// precision of the adjoint, set by the tape, instead of the default one.
+template <typename A>
+struct TapeAdjointOp : public AdjointOp<A>
+{
+};
+
+template <>
+struct TapeAdjointOp<mpreal>  // SPECIALIZED TEMPLATE FOR mpreal class:
+{
+  static void zero(mpreal& r) { r.setZero(); }
+  static void add(mpreal& r, const mpreal& d)
+  {
+    mpfr_add(r.mpfr_ptr(), r.mpfr_srcptr(), d.mpfr_srcptr(), DEFAULT_RNDM);
+  }
+  static void sub(mpreal& r, const mpreal& d)
+  {
+    mpfr_sub(r.mpfr_ptr(), r.mpfr_srcptr(), d.mpfr_srcptr(), DEFAULT_RNDM);
+  }
+  static void add_mul(mpreal& r, const mpreal& a, const mpreal& d)
+  {
+    mpfr_fma(r.mpfr_ptr(), a.mpfr_srcptr(), d.mpfr_srcptr(), r.mpfr_srcptr(), DEFAULT_RNDM);
+  }
+  static void sub_mul(mpreal& r, const mpreal& a, const mpreal& d)
+  {
+    mpfr_fms(r.mpfr_ptr(), a.mpfr_srcptr(), d.mpfr_srcptr(), r.mpfr_srcptr(), DEFAULT_RNDM);
+    mpfr_neg(r.mpfr_ptr(), r.mpfr_srcptr(), DEFAULT_RNDM);
+  }
+};
+
+// Compact tape of the reverse mode. Instead of a heap allocated,
+// reference counted node with a vtable per operation (B), every operation
+// appends a plain record holding an opcode, two 32-bit operand indices and
+// inline value and adjoint slots. Records live in fixed size segments, so
+// they are never moved, and constants are kept in a side pool. The reverse
+// sweep is a single loop over the records with a switch on the opcode.
+//
+// Local partial derivatives that take a function evaluation, those of sin,
+// cos, asin, acos, pow(x, c) and pow(c, x), are formed while recording and
+// kept in the pool like B keeps them in the node: at m_b for the unary
+// records and after the constant, at m_b + 1, for the others. The sweep
+// forms the remaining ones from the recorded values with at most a
+// division; pow(x, y) of two variables is the exception and forms its two
+// partials again.
+//
+// ExampleBAD4 measures BC against B. For double a record takes half the
+// memory of a node of B, and with optimization both the recording and the
+// sweep are faster.
+// For mpreal every record holds two MPFR numbers, the value and the
+// adjoint, where a node of B holds one and gets its adjoint in the sweep:
+// BC then takes about 30% more memory and is slower to record, and only its
+// sweep is faster. Use it for mpreal when a tape is swept many times, or
+// with a double adjoint, Tape<mpreal, double>.
+//
+// The tape records for the thread that created it, for as long as it is
+// alive (scopes nest). It is not consumed by a sweep: clearAdjoints() and
+// another diff() give the adjoints of a different dependent variable.
+//
+// The adjoints may have a cheaper type A than the values, e.g.
+// Tape<mpreal, double>, recorded with BC<mpreal, double>. The local
+// partial derivatives are formed in U and converted before they enter
+// the adjoints. With A = mpreal the adjoints take the precision of the
+// zero given to the constructor, Tape<mpreal> tape(mpreal(0, 128)), and
+// every update of an adjoint is rounded to it.
+template <typename U, typename A = U>
+class Tape
+{
+ public:
+  static const unsigned int SEGMENT = 4096;  // records per segment
+  struct Node
+  {
+    unsigned int m_op;
+    unsigned int m_a;  // operand or constant index
+    unsigned int m_b;  // operand or constant index
+    U            m_val;
+    A            m_adj;
+  };
+
+ private:
+  std::vector<Node*> m_segments;  // 0 while a segment is held by m_store
+  unsigned int       m_size;
+  std::deque<U>      m_constants;
+  Tape<U, A>*        m_prev;
+  TapeStore<U, A>*   m_store;
+  bool               m_swept;
+  A                  m_zero, m_one;  // prototypes of the adjoints
+  U                  m_t1, m_t2;     // scratch of the sweep
+
+  friend class TapeStore<U, A>;
+
+  static Tape<U, A>*& current()
+  {
+    static thread_local Tape<U, A>* tape = 0;
+    return tape;
+  }
+  Tape(const Tape<U, A>&) { /*illegal*/}
+  void operator=(const Tape<U, A>&) { /*illegal*/}
+
+ public:
+  Tape()
+      : m_size(0),
+        m_prev(current()),
+        m_store(0),
+        m_swept(false),
+        m_zero(Op<A>::myZero()),
+        m_one(Op<A>::myOne())
+  {
+    current() = this;
+  }
+  explicit Tape(const A& zero)
+      : m_size(0), m_prev(current()), m_store(0), m_swept(false), m_zero(zero), m_one(zero)
+  {
+    TapeAdjointOp<A>::zero(m_zero);
+    TapeAdjointOp<A>::add(m_one, Op<A>::myOne());
+    current() = this;
+  }
+  ~Tape()
+  {
+    clear();
+    for (unsigned int s = 0; s < m_segments.size(); ++s)
+      ::operator delete(m_segments[ s ]);
+    current() = m_prev;
+  }
+  static Tape<U, A>& active()
+  {
+    USER_ASSERT(current() != 0, "No active tape")
+    return *current();
+  }
+  unsigned int size() const { return m_size; }
+  unsigned int constants() const { return (unsigned int)m_constants.size(); }
+  bool         swept() const { return m_swept; }
+  // Bytes held in memory by the records and the pool, with the
+  // significands of mpreal values:
+  std::size_t memory() const
+  {
+    std::size_t n = 0;
+    for (unsigned int s = 0; s < m_segments.size(); ++s)
+      if (m_segments[ s ] != 0)
+      {
+        n += SEGMENT * sizeof(Node);
+        for (unsigned int i = 0; i < SEGMENT && s * SEGMENT + i < m_size; ++i)
+          n += TapeIO<U>::heap(m_segments[ s ][ i ].m_val) +
+               TapeIO<A>::heap(m_segments[ s ][ i ].m_adj);
+      }
+    for (unsigned int k = 0; k < m_constants.size(); ++k)
+      n += sizeof(U) + TapeIO<U>::heap(m_constants[ k ]);
+    return n;
+  }
+  // Segments may be handed to a backing store (tapespill.h), which brings
+  // them back on access.
+  void  attach(TapeStore<U, A>* store) { m_store = store; }
+  Node& operator[](const unsigned int i)
+  {
+    Node* seg = m_store == 0 ? m_segments[ i / SEGMENT ] : m_store->touch(i / SEGMENT);
+    return seg[ i % SEGMENT ];
+  }
+  const Node& operator[](const unsigned int i) const
+  {
+    Node* seg = m_store == 0 ? m_segments[ i / SEGMENT ] : m_store->touch(i / SEGMENT);
+    return seg[ i % SEGMENT ];
+  }
+  const U& constant(const unsigned int k) const { return m_constants[ k ]; }
+  template <typename V>
+  unsigned int pushConstant(const V& c)
+  {
+    m_constants.push_back(U(c));
+    return (unsigned int)m_constants.size() - 1;
+  }
+  // Whether the records of op keep their local partial derivative in the
+  // pool, and where:
+  static bool keepsPartial(const unsigned int op)
+  {
+    return op == TAPE_SIN || op == TAPE_COS || op == TAPE_ASIN || op == TAPE_ACOS ||
+           op == TAPE_POW_C || op == TAPE_C_POW;
+  }
+  static unsigned int partialIndex(const Node& n)
+  {
+    return n.m_op == TAPE_POW_C || n.m_op == TAPE_C_POW ? n.m_b + 1 : n.m_b;
+  }
+  // Appends a record with a zero value and adjoint and returns its index.
+  unsigned int push(const unsigned int op, const unsigned int a, const unsigned int b)
+  {
+    if (m_size % SEGMENT == 0)
+    {
+      const unsigned int s = m_size / SEGMENT;
+      if (s == m_segments.size())
+        m_segments.push_back(0);
+      if (m_segments[ s ] == 0)
+        m_segments[ s ] = static_cast<Node*>(::operator new(SEGMENT * sizeof(Node)));
+      if (m_store != 0 && s > 0)
+        m_store->sealed(s - 1);
+    }
+    Node* p = new (&(*this)[ m_size ]) Node();
+    p->m_op = op;
+    p->m_a  = a;
+    p->m_b  = b;
+    AdjointOp<U>::zero(p->m_val);
+    p->m_adj = m_zero;
+    return m_size++;
+  }
+  void clear()
+  {
+    if (m_store != 0)
+      m_store->clear();
+    for (unsigned int s = 0; s * SEGMENT < m_size; ++s)
+      if (m_segments[ s ] != 0)
+        for (unsigned int i = 0; i < SEGMENT && s * SEGMENT + i < m_size; ++i)
+          m_segments[ s ][ i ].~Node();
+    m_size  = 0;
+    m_swept = false;
+    m_constants.clear();
+  }
+  // Forms the local partial derivative of record i, once its value is set,
+  // and appends it to the pool if the record keeps it.
+  void keepPartial(const unsigned int i)
+  {
+    Node& n((*this)[ i ]);
+    if (!keepsPartial(n.m_op))
+      return;
+    m_constants.push_back(U());
+    if (n.m_op != TAPE_POW_C && n.m_op != TAPE_C_POW)
+      n.m_b = (unsigned int)m_constants.size() - 1;
+    INTERNAL_ASSERT(partialIndex(n) == m_constants.size() - 1, "Pool out of order")
+    formPartial(n, m_constants.back());
+  }
+  void clearAdjoints()
+  {
+    for (unsigned int i = 0; i < m_size; ++i)
+      TapeAdjointOp<A>::zero((*this)[ i ].m_adj);
+    m_swept = false;
+  }
+  // Seeds record i with 1 and propagates the adjoints down to record 0.
+  void reverse(const unsigned int i)
+  {
+    USER_ASSERT(i < m_size, "Index " << i << " out of range [0," << m_size << "]")
+    (*this)[ i ].m_adj = m_one;
+    m_swept            = true;
+    for (unsigned int j = i + 1; j-- > 0;)
+    {
+      if (m_store != 0 && (j == i || j % SEGMENT == SEGMENT - 1))
+        m_store->sweeping(j / SEGMENT);
+      propagate((*this)[ j ]);
+    }
+  }
+  // Recomputes the values of the records from the values of the leaves,
+  // e.g. after new inputs have been set in a loaded tape (graphio.h). The
+  // branches taken while recording are kept.
+  void replay()
+  {
+    for (unsigned int i = 0; i < m_size; ++i)
+    {
+      Node& n((*this)[ i ]);
+      evaluate(n);
+      if (keepsPartial(n.m_op))
+        formPartial(n, m_constants[ partialIndex(n) ]);
+    }
+  }
+
+ private:
+  void evaluate(Node& n)
+  {
+    U& r(n.m_val);
+    switch (n.m_op)
+    {
+      case TAPE_LEAF:
+        break;
+      case TAPE_ADD:
+        LocalOp<U>::add(r, (*this)[ n.m_a ].m_val, (*this)[ n.m_b ].m_val);
+        break;
+      case TAPE_SUB:
+        LocalOp<U>::sub(r, (*this)[ n.m_a ].m_val, (*this)[ n.m_b ].m_val);
+        break;
+      case TAPE_MUL:
+        LocalOp<U>::mul(r, (*this)[ n.m_a ].m_val, (*this)[ n.m_b ].m_val);
+        break;
+      case TAPE_DIV:
+        LocalOp<U>::div(r, (*this)[ n.m_a ].m_val, (*this)[ n.m_b ].m_val);
+        break;
+      case TAPE_POW:
+        LocalOp<U>::pow(r, (*this)[ n.m_a ].m_val, (*this)[ n.m_b ].m_val);
+        break;
+      case TAPE_ADD_C:
+        LocalOp<U>::add(r, (*this)[ n.m_a ].m_val, m_constants[ n.m_b ]);
+        break;
+      case TAPE_SUB_C:
+        LocalOp<U>::sub(r, (*this)[ n.m_a ].m_val, m_constants[ n.m_b ]);
+        break;
+      case TAPE_C_SUB:
+        LocalOp<U>::sub(r, m_constants[ n.m_b ], (*this)[ n.m_a ].m_val);
+        break;
+      case TAPE_MUL_C:
+        LocalOp<U>::mul(r, (*this)[ n.m_a ].m_val, m_constants[ n.m_b ]);
+        break;
+      case TAPE_DIV_C:
+        LocalOp<U>::div(r, (*this)[ n.m_a ].m_val, m_constants[ n.m_b ]);
+        break;
+      case TAPE_C_DIV:
+        LocalOp<U>::div(r, m_constants[ n.m_b ], (*this)[ n.m_a ].m_val);
+        break;
+      case TAPE_POW_C:
+        LocalOp<U>::pow(r, (*this)[ n.m_a ].m_val, m_constants[ n.m_b ]);
+        break;
+      case TAPE_C_POW:
+        LocalOp<U>::pow(r, m_constants[ n.m_b ], (*this)[ n.m_a ].m_val);
+        break;
+      case TAPE_NEG:
+        r = (*this)[ n.m_a ].m_val;
+        LocalOp<U>::neg(r);
+        break;
+      case TAPE_POS:
+        r = (*this)[ n.m_a ].m_val;
+        break;
+      case TAPE_SQR:
+        LocalOp<U>::sqr(r, (*this)[ n.m_a ].m_val);
+        break;
+      case TAPE_SQRT:
+        LocalOp<U>::sqrt(r, (*this)[ n.m_a ].m_val);
+        break;
+      case TAPE_EXP:
+        LocalOp<U>::exp(r, (*this)[ n.m_a ].m_val);
+        break;
+      case TAPE_LOG:
+        LocalOp<U>::log(r, (*this)[ n.m_a ].m_val);
+        break;
+      case TAPE_SIN:
+        LocalOp<U>::sin(r, (*this)[ n.m_a ].m_val);
+        break;
+      case TAPE_COS:
+        LocalOp<U>::cos(r, (*this)[ n.m_a ].m_val);
+        break;
+      case TAPE_TAN:
+        LocalOp<U>::tan(r, (*this)[ n.m_a ].m_val);
+        break;
+      case TAPE_ASIN:
+        LocalOp<U>::asin(r, (*this)[ n.m_a ].m_val);
+        break;
+      case TAPE_ACOS:
+        LocalOp<U>::acos(r, (*this)[ n.m_a ].m_val);
+        break;
+      case TAPE_ATAN:
+        LocalOp<U>::atan(r, (*this)[ n.m_a ].m_val);
+        break;
+      default:
+        INTERNAL_ASSERT(false, "Unknown opcode " << n.m_op)
+        break;
+    }
+  }
+  // The partial derivatives kept in the pool; cos and acos keep the
+  // negated ones, sin(x) and 1/sqrt(1-x^2):
+  void formPartial(const Node& n, U& p)
+  {
+    const U& x((*this)[ n.m_a ].m_val);
+    switch (n.m_op)
+    {
+      case TAPE_SIN:
+        LocalOp<U>::cos(p, x);
+        break;
+      case TAPE_COS:
+        LocalOp<U>::sin(p, x);
+        break;
+      case TAPE_ASIN:
+      case TAPE_ACOS:
+        LocalOp<U>::sqr(p, x);
+        m_t2 = Op<U>::myOne();
+        LocalOp<U>::sub(p, m_t2, p);
+        LocalOp<U>::sqrt(p, p);
+        LocalOp<U>::inv(p, p);
+        break;
+      case TAPE_POW_C:
+      {
+        const U& c(m_constants[ n.m_b ]);
+        p = Op<U>::myOne();
+        LocalOp<U>::sub(p, c, p);
+        LocalOp<U>::pow(p, x, p);
+        LocalOp<U>::mul(p, p, c);
+        break;
+      }
+      case TAPE_C_POW:
+        LocalOp<U>::log(p, m_constants[ n.m_b ]);
+        LocalOp<U>::mul(p, p, n.m_val);
+        break;
+      default:
+        INTERNAL_ASSERT(false, "No partial kept for opcode " << n.m_op)
+        break;
+    }
+  }
+  // r += p*w and r -= p*w for a partial p:
+  static void addPartial(A& r, const U& p, const A& w)
+  {
+    TapeAdjointOp<A>::add_mul(r, AdjointCast<A, U>::cast(p), w);
+  }
+  static void subPartial(A& r, const U& p, const A& w)
+  {
+    TapeAdjointOp<A>::sub_mul(r, AdjointCast<A, U>::cast(p), w);
+  }
+  void propagate(const Node& n)
+  {
+    const A& w(n.m_adj);
+    switch (n.m_op)
+    {
+      case TAPE_LEAF:
+        break;
+      case TAPE_ADD:
+        TapeAdjointOp<A>::add((*this)[ n.m_a ].m_adj, w);
+        TapeAdjointOp<A>::add((*this)[ n.m_b ].m_adj, w);
+        break;
+      case TAPE_SUB:
+        TapeAdjointOp<A>::add((*this)[ n.m_a ].m_adj, w);
+        TapeAdjointOp<A>::sub((*this)[ n.m_b ].m_adj, w);
+        break;
+      case TAPE_MUL:
+        addPartial((*this)[ n.m_a ].m_adj, (*this)[ n.m_b ].m_val, w);
+        addPartial((*this)[ n.m_b ].m_adj, (*this)[ n.m_a ].m_val, w);
+        break;
+      case TAPE_DIV:
+        LocalOp<U>::inv(m_t1, (*this)[ n.m_b ].m_val);
+        addPartial((*this)[ n.m_a ].m_adj, m_t1, w);
+        LocalOp<U>::mul(m_t1, m_t1, n.m_val);
+        subPartial((*this)[ n.m_b ].m_adj, m_t1, w);
+        break;
+      case TAPE_POW:
+      {
+        const U& x((*this)[ n.m_a ].m_val);
+        const U& y((*this)[ n.m_b ].m_val);
+        m_t1 = Op<U>::myOne();
+        LocalOp<U>::sub(m_t1, y, m_t1);
+        LocalOp<U>::pow(m_t1, x, m_t1);
+        LocalOp<U>::mul(m_t1, m_t1, y);
+        addPartial((*this)[ n.m_a ].m_adj, m_t1, w);
+        LocalOp<U>::log(m_t1, x);
+        LocalOp<U>::mul(m_t1, m_t1, n.m_val);
+        addPartial((*this)[ n.m_b ].m_adj, m_t1, w);
+        break;
+      }
+      case TAPE_ADD_C:
+      case TAPE_SUB_C:
+      case TAPE_POS:
+        TapeAdjointOp<A>::add((*this)[ n.m_a ].m_adj, w);
+        break;
+      case TAPE_C_SUB:
+      case TAPE_NEG:
+        TapeAdjointOp<A>::sub((*this)[ n.m_a ].m_adj, w);
+        break;
+      case TAPE_MUL_C:
+        addPartial((*this)[ n.m_a ].m_adj, m_constants[ n.m_b ], w);
+        break;
+      case TAPE_DIV_C:
+        LocalOp<U>::inv(m_t1, m_constants[ n.m_b ]);
+        addPartial((*this)[ n.m_a ].m_adj, m_t1, w);
+        break;
+      case TAPE_C_DIV:
+        LocalOp<U>::div(m_t1, n.m_val, (*this)[ n.m_a ].m_val);
+        subPartial((*this)[ n.m_a ].m_adj, m_t1, w);
+        break;
+      case TAPE_POW_C:
+      case TAPE_C_POW:
+      case TAPE_SIN:
+      case TAPE_ASIN:
+        addPartial((*this)[ n.m_a ].m_adj, m_constants[ partialIndex(n) ], w);
+        break;
+      case TAPE_COS:
+      case TAPE_ACOS:
+        subPartial((*this)[ n.m_a ].m_adj, m_constants[ partialIndex(n) ], w);
+        break;
+      case TAPE_SQR:
+        LocalOp<U>::add(m_t1, (*this)[ n.m_a ].m_val, (*this)[ n.m_a ].m_val);
+        addPartial((*this)[ n.m_a ].m_adj, m_t1, w);
+        break;
+      case TAPE_SQRT:
+        LocalOp<U>::add(m_t1, n.m_val, n.m_val);
+        LocalOp<U>::inv(m_t1, m_t1);
+        addPartial((*this)[ n.m_a ].m_adj, m_t1, w);
+        break;
+      case TAPE_EXP:
+        addPartial((*this)[ n.m_a ].m_adj, n.m_val, w);
+        break;
+      case TAPE_LOG:
+        LocalOp<U>::inv(m_t1, (*this)[ n.m_a ].m_val);
+        addPartial((*this)[ n.m_a ].m_adj, m_t1, w);
+        break;
+      case TAPE_TAN:
+        LocalOp<U>::sqr(m_t1, n.m_val);
+        m_t2 = Op<U>::myOne();
+        LocalOp<U>::add(m_t1, m_t1, m_t2);
+        addPartial((*this)[ n.m_a ].m_adj, m_t1, w);
+        break;
+      case TAPE_ATAN:
+        LocalOp<U>::sqr(m_t1, (*this)[ n.m_a ].m_val);
+        m_t2 = Op<U>::myOne();
+        LocalOp<U>::add(m_t1, m_t1, m_t2);
+        LocalOp<U>::inv(m_t1, m_t1);
+        addPartial((*this)[ n.m_a ].m_adj, m_t1, w);
+        break;
+      default:
+        INTERNAL_ASSERT(false, "Unknown opcode " << n.m_op)
+        break;
+    }
+  }
+};
+
+// Backing store of the segments of a tape. touch() returns segment s and
+// brings it back into memory if it was handed out, sealed() tells that
+// segment s is complete and sweeping() that the reverse sweep has reached
+// segment s.
+template <typename U, typename A>
+class TapeStore
+{
+ public:
+  typedef typename Tape<U, A>::Node Node;
+  virtual ~TapeStore() {}
+  virtual Node* touch(const unsigned int s)    = 0;
+  virtual void  sealed(const unsigned int s)   = 0;
+  virtual void  sweeping(const unsigned int s) = 0;
+  virtual void  clear()                        = 0;
+
+ protected:
+  static std::vector<Node*>& segments(Tape<U, A>& tape) { return tape.m_segments; }
+};
+
+// Active variable of the compact tape: the index of its record on the
+// active tape of the thread. Used like B, with one dependent variable per
+// sweep (diff(0, 1)).
+template <typename U, typename A = U>
+class BCTypeName
+{
+  unsigned int m_idx;
+
+ public:
+  struct Index
+  {
+    unsigned int m_idx;
+    explicit Index(const unsigned int idx) : m_idx(idx) {}
+  };
+  typedef U UnderlyingType;
+  BCTypeName() : m_idx(Tape<U, A>::active().push(TAPE_LEAF, 0, 0)) {}
+  explicit BCTypeName(const Index& idx) : m_idx(idx.m_idx) {}
+  template <typename V> /*explicit*/ BCTypeName(const V& val)
+      : m_idx(Tape<U, A>::active().push(TAPE_LEAF, 0, 0))
+  {
+    Tape<U, A>::active()[ m_idx ].m_val = val;
+  }
+  BCTypeName<U, A>& operator=(const BCTypeName<U, A>& val)
+  {
+    m_idx = val.m_idx;
+    return *this;
+  }
+  template <typename V>
+  BCTypeName<U, A>& operator=(const V& val)
+  {
+    return *this = BCTypeName<U, A>(val);
+  }
+  unsigned int index() const { return m_idx; }
+  const U&     val() const { return Tape<U, A>::active()[ m_idx ].m_val; }
+  U&           x() { return Tape<U, A>::active()[ m_idx ].m_val; }
+  const A&     deriv(const unsigned int i) const
+  {
+    USER_ASSERT(i == 0, "Index " << i << " out of bounds [0,1]")
+    return Tape<U, A>::active()[ m_idx ].m_adj;
+  }
+  A& d(const unsigned int i)
+  {
+    USER_ASSERT(i == 0, "Index " << i << " out of bounds [0,1]")
+    return Tape<U, A>::active()[ m_idx ].m_adj;
+  }
+  A& diff(const unsigned int idx, const unsigned int size)
+  {
+    USER_ASSERT(idx == 0 && size == 1, "The compact tape sweeps one dependent variable at a time")
+    Tape<U, A>& tape(Tape<U, A>::active());
+    if (tape.swept())
+      tape.clearAdjoints();
+    tape.reverse(m_idx);
+    return tape[ m_idx ].m_adj;
+  }
+  BCTypeName<U, A>& operator+=(const BCTypeName<U, A>& val) { return *this = *this + val; }
+  BCTypeName<U, A>& operator-=(const BCTypeName<U, A>& val) { return *this = *this - val; }
+  BCTypeName<U, A>& operator*=(const BCTypeName<U, A>& val) { return *this = *this * val; }
+  BCTypeName<U, A>& operator/=(const BCTypeName<U, A>& val) { return *this = *this / val; }
+  template <typename V>
+  BCTypeName<U, A>& operator+=(const V& val)
+  {
+    return *this = *this + val;
+  }
+  template <typename V>
+  BCTypeName<U, A>& operator-=(const V& val)
+  {
+    return *this = *this - val;
+  }
+  template <typename V>
+  BCTypeName<U, A>& operator*=(const V& val)
+  {
+    return *this = *this * val;
+  }
+  template <typename V>
+  BCTypeName<U, A>& operator/=(const V& val)
+  {
+    return *this = *this / val;
+  }
+};
+
+// Recording helpers: append a record, set its value and keep its partial.
+
+template <typename U, typename A>
+BCTypeName<U, A> tapeBinary(const unsigned int op, const BCTypeName<U, A>& x,
+                            const BCTypeName<U, A>& y, void (*f)(U&, const U&, const U&))
+{
+  Tape<U, A>&        tape(Tape<U, A>::active());
+  const unsigned int r = tape.push(op, x.index(), y.index());
+  f(tape[ r ].m_val, tape[ x.index() ].m_val, tape[ y.index() ].m_val);
+  return BCTypeName<U, A>(typename BCTypeName<U, A>::Index(r));
+}
+template <typename U, typename A, typename V>
+BCTypeName<U, A> tapeBinary(const unsigned int op, const BCTypeName<U, A>& x, const V& c,
+                            void (*f)(U&, const U&, const U&))
+{
+  Tape<U, A>&        tape(Tape<U, A>::active());
+  const unsigned int k = tape.pushConstant(c);
+  const unsigned int r = tape.push(op, x.index(), k);
+  f(tape[ r ].m_val, tape[ x.index() ].m_val, tape.constant(k));
+  tape.keepPartial(r);
+  return BCTypeName<U, A>(typename BCTypeName<U, A>::Index(r));
+}
+template <typename U, typename A, typename V>
+BCTypeName<U, A> tapeBinary(const unsigned int op, const V& c, const BCTypeName<U, A>& x,
+                            void (*f)(U&, const U&, const U&))
+{
+  Tape<U, A>&        tape(Tape<U, A>::active());
+  const unsigned int k = tape.pushConstant(c);
+  const unsigned int r = tape.push(op, x.index(), k);
+  f(tape[ r ].m_val, tape.constant(k), tape[ x.index() ].m_val);
+  tape.keepPartial(r);
+  return BCTypeName<U, A>(typename BCTypeName<U, A>::Index(r));
+}
+template <typename U, typename A>
+BCTypeName<U, A> tapeUnary(const unsigned int op, const BCTypeName<U, A>& x,
+                           void (*f)(U&, const U&))
+{
+  Tape<U, A>&        tape(Tape<U, A>::active());
+  const unsigned int r = tape.push(op, x.index(), 0);
+  f(tape[ r ].m_val, tape[ x.index() ].m_val);
+  tape.keepPartial(r);
+  return BCTypeName<U, A>(typename BCTypeName<U, A>::Index(r));
+}
+
+// ARITHMETIC:
+
+template <typename U, typename A>
+BCTypeName<U, A> operator+(const BCTypeName<U, A>& x, const BCTypeName<U, A>& y)
+{
+  return tapeBinary(TAPE_ADD, x, y, &LocalOp<U>::add);
+}
+template <typename U, typename A, typename V>
+BCTypeName<U, A> operator+(const BCTypeName<U, A>& x, const V& c)
+{
+  return tapeBinary(TAPE_ADD_C, x, c, &LocalOp<U>::add);
+}
+template <typename U, typename A, typename V>
+BCTypeName<U, A> operator+(const V& c, const BCTypeName<U, A>& x)
+{
+  return tapeBinary(TAPE_ADD_C, c, x, &LocalOp<U>::add);
+}
+template <typename U, typename A>
+BCTypeName<U, A> operator-(const BCTypeName<U, A>& x, const BCTypeName<U, A>& y)
+{
+  return tapeBinary(TAPE_SUB, x, y, &LocalOp<U>::sub);
+}
+template <typename U, typename A, typename V>
+BCTypeName<U, A> operator-(const BCTypeName<U, A>& x, const V& c)
+{
+  return tapeBinary(TAPE_SUB_C, x, c, &LocalOp<U>::sub);
+}
+template <typename U, typename A, typename V>
+BCTypeName<U, A> operator-(const V& c, const BCTypeName<U, A>& x)
+{
+  return tapeBinary(TAPE_C_SUB, c, x, &LocalOp<U>::sub);
+}
+template <typename U, typename A>
+BCTypeName<U, A> operator*(const BCTypeName<U, A>& x, const BCTypeName<U, A>& y)
+{
+  return tapeBinary(TAPE_MUL, x, y, &LocalOp<U>::mul);
+}
+template <typename U, typename A, typename V>
+BCTypeName<U, A> operator*(const BCTypeName<U, A>& x, const V& c)
+{
+  return tapeBinary(TAPE_MUL_C, x, c, &LocalOp<U>::mul);
+}
+template <typename U, typename A, typename V>
+BCTypeName<U, A> operator*(const V& c, const BCTypeName<U, A>& x)
+{
+  return tapeBinary(TAPE_MUL_C, c, x, &LocalOp<U>::mul);
+}
+template <typename U, typename A>
+BCTypeName<U, A> operator/(const BCTypeName<U, A>& x, const BCTypeName<U, A>& y)
+{
+  return tapeBinary(TAPE_DIV, x, y, &LocalOp<U>::div);
+}
+template <typename U, typename A, typename V>
+BCTypeName<U, A> operator/(const BCTypeName<U, A>& x, const V& c)
+{
+  return tapeBinary(TAPE_DIV_C, x, c, &LocalOp<U>::div);
+}
+template <typename U, typename A, typename V>
+BCTypeName<U, A> operator/(const V& c, const BCTypeName<U, A>& x)
+{
+  return tapeBinary(TAPE_C_DIV, c, x, &LocalOp<U>::div);
+}
+template <typename U, typename A>
+BCTypeName<U, A> pow(const BCTypeName<U, A>& x, const BCTypeName<U, A>& y)
+{
+  return tapeBinary(TAPE_POW, x, y, &LocalOp<U>::pow);
+}
+template <typename U, typename A, typename V>
+BCTypeName<U, A> pow(const BCTypeName<U, A>& x, const V& c)
+{
+  return tapeBinary(TAPE_POW_C, x, c, &LocalOp<U>::pow);
+}
+template <typename U, typename A, typename V>
+BCTypeName<U, A> pow(const V& c, const BCTypeName<U, A>& x)
+{
+  return tapeBinary(TAPE_C_POW, c, x, &LocalOp<U>::pow);
+}
+
+// UNARY OPERATORS AND ELEMENTARY FUNCTIONS:
+
+template <typename U>
+struct TapeKernel  // value kernels of the unary records
+{
+  static void pos(U& r, const U& x) { r = x; }
+  static void neg(U& r, const U& x)
+  {
+    r = x;
+    LocalOp<U>::neg(r);
+  }
+};
+template <typename U, typename A>
+BCTypeName<U, A> operator+(const BCTypeName<U, A>& x)
+{
+  return tapeUnary(TAPE_POS, x, &TapeKernel<U>::pos);
+}
+template <typename U, typename A>
+BCTypeName<U, A> operator-(const BCTypeName<U, A>& x)
+{
+  return tapeUnary(TAPE_NEG, x, &TapeKernel<U>::neg);
+}
+template <typename U, typename A>
+BCTypeName<U, A> sqr(const BCTypeName<U, A>& x)
+{
+  return tapeUnary(TAPE_SQR, x, &LocalOp<U>::sqr);
+}
+template <typename U, typename A>
+BCTypeName<U, A> sqrt(const BCTypeName<U, A>& x)
+{
+  return tapeUnary(TAPE_SQRT, x, &LocalOp<U>::sqrt);
+}
+template <typename U, typename A>
+BCTypeName<U, A> exp(const BCTypeName<U, A>& x)
+{
+  return tapeUnary(TAPE_EXP, x, &LocalOp<U>::exp);
+}
+template <typename U, typename A>
+BCTypeName<U, A> log(const BCTypeName<U, A>& x)
+{
+  return tapeUnary(TAPE_LOG, x, &LocalOp<U>::log);
+}
+template <typename U, typename A>
+BCTypeName<U, A> sin(const BCTypeName<U, A>& x)
+{
+  return tapeUnary(TAPE_SIN, x, &LocalOp<U>::sin);
+}
+template <typename U, typename A>
+BCTypeName<U, A> cos(const BCTypeName<U, A>& x)
+{
+  return tapeUnary(TAPE_COS, x, &LocalOp<U>::cos);
+}
+template <typename U, typename A>
+BCTypeName<U, A> tan(const BCTypeName<U, A>& x)
+{
+  return tapeUnary(TAPE_TAN, x, &LocalOp<U>::tan);
+}
+template <typename U, typename A>
+BCTypeName<U, A> asin(const BCTypeName<U, A>& x)
+{
+  return tapeUnary(TAPE_ASIN, x, &LocalOp<U>::asin);
+}
+template <typename U, typename A>
+BCTypeName<U, A> acos(const BCTypeName<U, A>& x)
+{
+  return tapeUnary(TAPE_ACOS, x, &LocalOp<U>::acos);
+}
+template <typename U, typename A>
+BCTypeName<U, A> atan(const BCTypeName<U, A>& x)
+{
+  return tapeUnary(TAPE_ATAN, x, &LocalOp<U>::atan);
+}
+
+// COMPARISONS:
+
+#define BTAPE_COMPARE(OP, MYOP)                                            \
+  template <typename U, typename A>                                        \
+  bool operator OP(const BCTypeName<U, A>& x, const BCTypeName<U, A>& y)   \
+  {                                                                        \
+    return Op<U>::MYOP(x.val(), y.val());                                  \
+  }                                                                        \
+  template <typename U, typename A, typename V>                            \
+  bool operator OP(const BCTypeName<U, A>& x, const V& y)                  \
+  {                                                                        \
+    return Op<U>::MYOP(x.val(), y);                                        \
+  }                                                                        \
+  template <typename U, typename A, typename V>                            \
+  bool operator OP(const V& x, const BCTypeName<U, A>& y)                  \
+  {                                                                        \
+    return Op<U>::MYOP(x, y.val());                                        \
+  }
+BTAPE_COMPARE(==, myEq)
+BTAPE_COMPARE(!=, myNe)
+BTAPE_COMPARE(<, myLt)
+BTAPE_COMPARE(<=, myLe)
+BTAPE_COMPARE(>, myGt)
+BTAPE_COMPARE(>=, myGe)
+#undef BTAPE_COMPARE
+
+}  // namespace fadbad
+
+#endif
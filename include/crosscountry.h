@@ -0,0 +1,259 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _CROSSCOUNTRY_H
+#define _CROSSCOUNTRY_H
+
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "badiff.h"
+
+namespace fadbad
+{
+// Multiply-add counts of the Jacobian accumulation: n forward sweeps, m
+// reverse sweeps (one per edge of the linearized graph and direction) and
+// the vertex elimination order actually used.
+struct JacobianCost
+{
+  unsigned long forward;
+  unsigned long reverse;
+  unsigned long elimination;
+};
+
+// Cross-country Jacobian accumulation on a recorded graph. The graph
+// between the inputs x[0..n-1] and the outputs f[0..m-1] is linearized
+// with the local partial derivatives of the nodes, and the intermediate
+// vertices are eliminated greedily by lowest Markowitz degree (number of
+// predecessors times number of successors), which is the multiply-add cost
+// of the elimination. The remaining edges are the Jacobian. Nodes below
+// an input or not depending on any input are left out. The graph is left
+// intact.
+//
+//   B<double> x[3], f[2];
+//   ...
+//   double J[ 2 * 3 ];
+//   JacobianCost c(jacobian(f, 2, x, 3, J));  // J row-major, m x n
+template <typename U>
+class CrossCountry
+{
+  typedef BTypeNameHV<U>                         HV;
+  typedef std::map<unsigned int, U>              Edges;
+  typedef std::pair<unsigned long, unsigned int> Degree;
+
+  std::vector<HV*>                     m_nodes;  // topological order
+  std::unordered_map<const HV*, int>   m_index;
+  std::vector<Edges>                   m_pred;  // m_pred[j][i] = dv_j/dv_i
+  std::vector<std::set<unsigned int> > m_succ;
+  std::vector<bool>                    m_keep;  // independent or dependent
+  std::vector<unsigned long>           m_degree;
+  std::set<Degree>                     m_queue;
+  std::vector<U>                       m_d, m_dd;
+
+  CrossCountry(const CrossCountry&) { /*illegal*/}
+  void operator=(const CrossCountry&) { /*illegal*/}
+
+  unsigned int vertex(HV* pHV)
+  {
+    m_nodes.push_back(pHV);
+    m_pred.push_back(Edges());
+    m_succ.push_back(std::set<unsigned int>());
+    m_keep.push_back(false);
+    return (unsigned int)m_nodes.size() - 1;
+  }
+  void edge(const unsigned int j, const unsigned int i, const U& c)
+  {
+    U& e(m_pred[ j ].insert(std::make_pair(i, Op<U>::myZero())).first->second);
+    AdjointOp<U>::add(e, c);
+    m_succ[ i ].insert(j);
+  }
+  // Records the linearized graph in topological order. Inputs are sources;
+  // m_index is -1 for visited nodes that do not depend on any input.
+  void record(BTypeName<U>* f, const unsigned int m, BTypeName<U>* x, const unsigned int n)
+  {
+    for (unsigned int i = 0; i < n; ++i)
+      if (m_index.find(x[ i ].getBTypeNameHV()) == m_index.end())
+      {
+        m_index[ x[ i ].getBTypeNameHV() ] = (int)vertex(x[ i ].getBTypeNameHV());
+        m_keep.back()                      = true;
+      }
+    for (unsigned int r = 0; r < m; ++r)
+    {
+      HV* pRoot = f[ r ].getBTypeNameHV();
+      if (m_index.find(pRoot) != m_index.end())
+        continue;
+      std::vector<std::pair<HV*, unsigned int> > stack(1, std::make_pair(pRoot, 0u));
+      m_index[ pRoot ] = -1;
+      while (!stack.empty())
+      {
+        HV* pHV = stack.back().first;
+        if (stack.back().second < pHV->arity())
+        {
+          HV* pOp = pHV->operand(stack.back().second++);
+          if (m_index.insert(std::make_pair(pOp, -1)).second)
+            stack.push_back(std::make_pair(pOp, 0u));
+          continue;
+        }
+        stack.pop_back();
+        const unsigned int k = pHV->arity();
+        bool               active = false;
+        for (unsigned int s = 0; s < k && !active; ++s)
+          active = m_index[ pHV->operand(s) ] >= 0;
+        if (!active)
+          continue;
+        if (m_d.size() < k)
+        {
+          m_d.resize(k);
+          m_dd.resize(k * (k + 1) / 2);
+        }
+        pHV->partials(&m_d[ 0 ], &m_dd[ 0 ]);
+        const unsigned int j = vertex(pHV);
+        m_index[ pHV ]       = (int)j;
+        for (unsigned int s = 0; s < k; ++s)
+        {
+          const int i = m_index[ pHV->operand(s) ];
+          if (i >= 0)
+            edge(j, i, m_d[ s ]);
+        }
+      }
+    }
+  }
+  void schedule(const unsigned int j)
+  {
+    if (m_keep[ j ])
+      return;
+    m_queue.erase(Degree(m_degree[ j ], j));
+    m_degree[ j ] = (unsigned long)m_pred[ j ].size() * m_succ[ j ].size();
+    m_queue.insert(Degree(m_degree[ j ], j));
+  }
+  // Front elimination of all intermediate vertices, cheapest first:
+  // c_ki += c_kj * c_ji for every predecessor i and successor k of j.
+  unsigned long eliminate()
+  {
+    unsigned long flops = 0;
+    m_degree.assign(m_nodes.size(), 0);
+    for (unsigned int j = 0; j < m_nodes.size(); ++j)
+      schedule(j);
+    while (!m_queue.empty())
+    {
+      const unsigned int j = m_queue.begin()->second;
+      m_queue.erase(m_queue.begin());
+      flops += m_degree[ j ];
+      for (std::set<unsigned int>::const_iterator k = m_succ[ j ].begin(); k != m_succ[ j ].end();
+           ++k)
+      {
+        Edges&                   pk(m_pred[ *k ]);
+        typename Edges::iterator ckj(pk.find(j));
+        for (typename Edges::const_iterator i = m_pred[ j ].begin(); i != m_pred[ j ].end(); ++i)
+        {
+          U& cki(pk.insert(std::make_pair(i->first, Op<U>::myZero())).first->second);
+          AdjointOp<U>::add_mul(cki, ckj->second, i->second);
+          m_succ[ i->first ].insert(*k);
+        }
+        pk.erase(ckj);
+      }
+      for (typename Edges::const_iterator i = m_pred[ j ].begin(); i != m_pred[ j ].end(); ++i)
+        m_succ[ i->first ].erase(j);
+      std::set<unsigned int> succ;
+      succ.swap(m_succ[ j ]);
+      Edges pred;
+      pred.swap(m_pred[ j ]);
+      for (typename Edges::const_iterator i = pred.begin(); i != pred.end(); ++i)
+        schedule(i->first);
+      for (std::set<unsigned int>::const_iterator k = succ.begin(); k != succ.end(); ++k)
+        schedule(*k);
+    }
+    return flops;
+  }
+
+ public:
+  CrossCountry() {}
+  JacobianCost compute(BTypeName<U>* f, const unsigned int m, BTypeName<U>* x,
+                       const unsigned int n, U* J)
+  {
+    record(f, m, x, n);
+    // An output that is also an input, feeds another vertex or is repeated
+    // is read through a unit edge, so that the node itself can be
+    // eliminated.
+    std::vector<int>          out(m, -1);
+    std::vector<unsigned int> uses(m_nodes.size(), 0);
+    for (unsigned int r = 0; r < m; ++r)
+      if (m_index[ f[ r ].getBTypeNameHV() ] >= 0)
+        ++uses[ m_index[ f[ r ].getBTypeNameHV() ] ];
+    for (unsigned int r = 0; r < m; ++r)
+    {
+      const int j = m_index[ f[ r ].getBTypeNameHV() ];
+      if (j < 0)
+        continue;
+      if (m_keep[ j ] || !m_succ[ j ].empty() || uses[ j ] > 1)
+      {
+        out[ r ] = (int)vertex(0);
+        edge(out[ r ], j, Op<U>::myOne());
+      }
+      else
+        out[ r ] = j;
+      m_keep[ out[ r ] ] = true;
+    }
+    unsigned long edges = 0;
+    for (unsigned int j = 0; j < m_nodes.size(); ++j)
+      edges += m_pred[ j ].size();
+    JacobianCost cost;
+    cost.forward     = edges * n;
+    cost.reverse     = edges * m;
+    cost.elimination = eliminate();
+    for (unsigned int r = 0; r < m; ++r)
+      for (unsigned int c = 0; c < n; ++c)
+      {
+        U& Jrc(J[ r * n + c ]);
+        Jrc = Op<U>::myZero();
+        if (out[ r ] < 0)
+          continue;
+        const Edges&                   pr(m_pred[ out[ r ] ]);
+        typename Edges::const_iterator e(pr.find(m_index[ x[ c ].getBTypeNameHV() ]));
+        if (e != pr.end())
+          Jrc = e->second;
+      }
+    return cost;
+  }
+};
+
+template <typename U>
+JacobianCost jacobian(BTypeName<U>* f, const unsigned int m, BTypeName<U>* x, const unsigned int n,
+                      U* J)
+{
+  CrossCountry<U> cc;
+  return cc.compute(f, m, x, n, J);
+}
+
+}  // namespace fadbad
+
+#endif
@@ -34,12 +34,25 @@
 
 // For test purpose
 #include <iostream>
+#include <type_traits>
 using namespace std;
 
 // mpreal.h include mpfr.h, including gmp.h
 #include "mpreal.h"
 using namespace mpfr;
 
+// Define FADBAD_THREADSAFE to share recorded graphs between threads. The
+// reference counters of shared nodes then become atomic and the scratch
+// values used by the mpreal specializations become thread local.
+#ifdef FADBAD_THREADSAFE
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#define FADBAD_TLS thread_local
+#else
+#define FADBAD_TLS
+#endif
+
 namespace fadbad
 {
 #define PI 3.14159265358979323846
@@ -109,6 +122,7 @@ template <>
 struct Op<mpreal>  //  SPECIALIZED TEMPLATE FOR mpreal class:
 {
   typedef mpreal Base;
+  typedef mpreal Underlying;
   static Base myInteger(const int i) { return Base(i); }
   static Base                     myZero() { return myInteger(0); }
   static Base                     myOne() { return myInteger(1); }
@@ -119,6 +133,8 @@ struct Op<mpreal>  //  SPECIALIZED TEMPLATE FOR mpreal class:
   // static mpreal myNeg(const mpreal& x) { return -x; }
   static void mpreal_neg(mpreal &rop, const mpreal &x, mpfr_rnd_t rnd = DEFAULT_RNDM)
   {
+    if (rop.get_prec() != DEFAULT_PREC)
+      rop.set_prec(DEFAULT_PREC, DEFAULT_RNDM);
     mpfr_neg(rop.mpfr_ptr(), x.mpfr_srcptr(), rnd);
   }
   template <typename U>
@@ -230,6 +246,21 @@ struct Op<mpreal>  //  SPECIALIZED TEMPLATE FOR mpreal class:
       rop.set_prec(DEFAULT_PREC, DEFAULT_RNDM);
     mpfr_div(rop.mpfr_ptr(), op1.mpfr_ptr(), op2.mpfr_ptr(), rnd);
   }
+  // mpreal_fma: rop = op1*op2+op3, mpreal_fms: rop = op1*op2-op3 (single rounding)
+  static void mpreal_fma(mpreal &rop, const mpreal &op1, const mpreal &op2, const mpreal &op3,
+                         mpfr_rnd_t rnd = DEFAULT_RNDM)
+  {
+    if (rop.get_prec() != DEFAULT_PREC)
+      rop.set_prec(DEFAULT_PREC, DEFAULT_RNDM);
+    mpfr_fma(rop.mpfr_ptr(), op1.mpfr_srcptr(), op2.mpfr_srcptr(), op3.mpfr_srcptr(), rnd);
+  }
+  static void mpreal_fms(mpreal &rop, const mpreal &op1, const mpreal &op2, const mpreal &op3,
+                         mpfr_rnd_t rnd = DEFAULT_RNDM)
+  {
+    if (rop.get_prec() != DEFAULT_PREC)
+      rop.set_prec(DEFAULT_PREC, DEFAULT_RNDM);
+    mpfr_fms(rop.mpfr_ptr(), op1.mpfr_srcptr(), op2.mpfr_srcptr(), op3.mpfr_srcptr(), rnd);
+  }
 
   // template <typename X, typename Y>
   // static mpreal myPow(const X& x, const Y& y) { return ::pow(x,y); }
@@ -325,6 +356,16 @@ struct Op<mpreal>  //  SPECIALIZED TEMPLATE FOR mpreal class:
       rop.set_prec(DEFAULT_PREC, DEFAULT_RNDM);
     mpfr_cos(rop.mpfr_ptr(), x.mpfr_ptr(), rnd);
   }
+  // sin and cos of the same argument in one call
+  static void mpreal_sin_cos(mpreal &sop, mpreal &cop, const mpreal &x,
+                             mpfr_rnd_t rnd = DEFAULT_RNDM)
+  {
+    if (sop.get_prec() != DEFAULT_PREC)
+      sop.set_prec(DEFAULT_PREC, DEFAULT_RNDM);
+    if (cop.get_prec() != DEFAULT_PREC)
+      cop.set_prec(DEFAULT_PREC, DEFAULT_RNDM);
+    mpfr_sin_cos(sop.mpfr_ptr(), cop.mpfr_ptr(), x.mpfr_ptr(), rnd);
+  }
   //static mpreal myTan(const mpreal& x) { return ::tan(x); }
   static void mpreal_tan(mpreal &rop, const mpreal &x, mpfr_rnd_t rnd = DEFAULT_RNDM)
   {
@@ -362,8 +403,131 @@ struct Op<mpreal>  //  SPECIALIZED TEMPLATE FOR mpreal class:
   static bool myGe(const mpreal &x, const mpreal &y) { return x >= y; }
 };
 
-static mpreal TEMP_RESULT  = 0.0;
-static mpreal TEMP_RESULT1 = 0.0;
+static FADBAD_TLS mpreal TEMP_RESULT  = 0.0;
+static FADBAD_TLS mpreal TEMP_RESULT1 = 0.0;
+
+// Whether the operations on U may run on several threads at once. Those of
+// mpreal share TEMP_RESULT unless FADBAD_THREADSAFE makes it thread local.
+// Other classes are assumed not to be reentrant unless they specialize
+// this, as F, TF and Lanes do after their element type.
+template <typename U>
+struct Reentrant
+{
+  static const bool value = std::is_arithmetic<U>::value;
+};
+template <>
+struct Reentrant<mpreal>
+{
+#ifdef FADBAD_THREADSAFE
+  static const bool value = true;
+#else
+  static const bool value = false;
+#endif
+};
+
+#ifdef FADBAD_THREADSAFE
+// Reference counter of a node. A node is private to the thread that
+// recorded it until it is marked as shared. Private counters are updated
+// with plain relaxed loads and stores, shared ones with atomic
+// read-modify-write operations.
+class RefCounter
+{
+  std::atomic<unsigned int> m_n;
+  std::atomic<bool>         m_shared;
+
+ public:
+  RefCounter(const unsigned int n = 0) : m_n(n), m_shared(false) {}
+  unsigned int operator++()
+  {
+    if (m_shared.load(std::memory_order_relaxed))
+      return m_n.fetch_add(1, std::memory_order_relaxed) + 1;
+    unsigned int n = m_n.load(std::memory_order_relaxed) + 1;
+    m_n.store(n, std::memory_order_relaxed);
+    return n;
+  }
+  unsigned int operator--()
+  {
+    if (m_shared.load(std::memory_order_relaxed))
+      return m_n.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    unsigned int n = m_n.load(std::memory_order_relaxed) - 1;
+    m_n.store(n, std::memory_order_relaxed);
+    return n;
+  }
+  operator unsigned int() const { return m_n.load(std::memory_order_acquire); }
+  bool shared() const { return m_shared.load(std::memory_order_relaxed); }
+  void share() { m_shared.store(true, std::memory_order_release); }
+};
+inline bool isShared(const RefCounter &rc) { return rc.shared(); }
+inline void markShared(RefCounter &rc) { rc.share(); }
+
+// Serializes updates of a shared node (e.g. adjoint accumulation from
+// several threads). Nodes are hashed on a fixed table of mutexes, so they
+// do not carry a lock of their own.
+class SharedGuard
+{
+  std::mutex *m_lock;
+  static std::mutex &lockOf(const void *p)
+  {
+    static std::mutex locks[ 64 ];
+    return locks[ (reinterpret_cast<std::uintptr_t>(p) >> 4) & 63 ];
+  }
+  SharedGuard(const SharedGuard &);
+  void operator=(const SharedGuard &);
+
+ public:
+  SharedGuard(const RefCounter &rc, const void *p) : m_lock(rc.shared() ? &lockOf(p) : 0)
+  {
+    if (m_lock)
+      m_lock->lock();
+  }
+  ~SharedGuard()
+  {
+    if (m_lock)
+      m_lock->unlock();
+  }
+};
+#define SHARED_GUARD(rc, p) SharedGuard sharedGuard(rc, p);
+#else
+typedef unsigned int RefCounter;
+inline bool isShared(const unsigned int &) { return false; }
+inline void markShared(unsigned int &) {}
+#define SHARED_GUARD(rc, p)
+#endif
+
+// Operation codes of the compact tape (btape.h), also used to describe the
+// nodes of a T graph (graphio.h). The _C forms take a constant as second
+// operand (x op c), the C_ forms as first operand (c op x).
+enum TapeOp
+{
+  TAPE_LEAF,
+  TAPE_ADD,
+  TAPE_SUB,
+  TAPE_MUL,
+  TAPE_DIV,
+  TAPE_POW,
+  TAPE_ADD_C,
+  TAPE_SUB_C,
+  TAPE_C_SUB,
+  TAPE_MUL_C,
+  TAPE_DIV_C,
+  TAPE_C_DIV,
+  TAPE_POW_C,
+  TAPE_C_POW,
+  TAPE_NEG,
+  TAPE_POS,
+  TAPE_SQR,
+  TAPE_SQRT,
+  TAPE_EXP,
+  TAPE_LOG,
+  TAPE_SIN,
+  TAPE_COS,
+  TAPE_TAN,
+  TAPE_ASIN,
+  TAPE_ACOS,
+  TAPE_ATAN,
+  TAPE_DIFF  // T only: diff(x, c)
+};
+
 }  // namespace fadbad
 
 // Name for backward AD type:
@@ -375,6 +539,12 @@ static mpreal TEMP_RESULT1 = 0.0;
 // Name for taylor AD type:
 #define TTypeName T
 
+// Name for eager taylor type:
+#define TFTypeName TF
+
+// Name for backward AD type on a compact tape:
+#define BCTypeName BC
+
 // Should always be inline:
 #define INLINE0 inline
 
@@ -87,7 +87,7 @@ class FTypeName  // STACK-BASED     General Template
     USER_ASSERT(i < N, "Index " << i << " out of bounds [0," << N << "]")
     if (m_depend)
       return m_diff[ i ];
-    static T zero;
+    static FADBAD_TLS T zero;
     zero = Op<T>::myZero();
     return zero;
   }
@@ -96,7 +96,7 @@ class FTypeName  // STACK-BASED     General Template
     USER_ASSERT(i < N, "Index " << i << " out of bounds [0," << N << "]")
     if (m_depend)
       return m_diff[ i ];
-    static T zero;
+    static FADBAD_TLS T zero;
     zero = Op<T>::myZero();
     return zero;
   }
@@ -212,7 +212,7 @@ class FTypeName<T, 0>  // HEAP-BASED     Template specialized
   {
     if (i < m_size)
       return m_diff[ i ];
-    static T zero;
+    static FADBAD_TLS T zero;
     zero = Op<T>::myZero();
     return zero;
   }
@@ -221,7 +221,7 @@ class FTypeName<T, 0>  // HEAP-BASED     Template specialized
   {
     if (i < m_size)
       return m_diff[ i ];
-    static T zero;
+    static FADBAD_TLS T zero;
     zero = Op<T>::myZero();
     return zero;
   }
@@ -1965,12 +1965,14 @@ INLINE2 FTypeName<T, N> sin(const FTypeName<T, N>& a)
 template <unsigned int N>
 INLINE2 FTypeName<mpreal, N> sin(const FTypeName<mpreal, N>& a)
 {
-  Op<mpreal>::mpreal_sin(TEMP_RESULT, a.val());
-  FTypeName<mpreal, N> c(TEMP_RESULT);
   if (!a.depend())
-    return c;
-  Op<mpreal>::mpreal_cos(TEMP_RESULT, a.val());
-  mpreal tmp(TEMP_RESULT);
+  {
+    Op<mpreal>::mpreal_sin(TEMP_RESULT, a.val());
+    return FTypeName<mpreal, N>(TEMP_RESULT);
+  }
+  Op<mpreal>::mpreal_sin_cos(TEMP_RESULT, TEMP_RESULT1, a.val());
+  mpreal tmp(TEMP_RESULT1);
+  FTypeName<mpreal, N> c(TEMP_RESULT);
   c.setDepend(a);
   for (unsigned int i = 0; i < N; ++i)
     Op<mpreal>::mpreal_mul(c[ i ], a[ i ], tmp);
@@ -1992,12 +1994,14 @@ INLINE2 FTypeName<T, 0> sin(const FTypeName<T, 0>& a)
 // reloaded for mpreal
 INLINE2 FTypeName<mpreal, 0> sin(const FTypeName<mpreal, 0>& a)
 {
-  Op<mpreal>::mpreal_sin(TEMP_RESULT, a.val());
-  FTypeName<mpreal, 0> c(TEMP_RESULT);
   if (!a.depend())
-    return c;
-  Op<mpreal>::mpreal_cos(TEMP_RESULT, a.val());
-  mpreal tmp(TEMP_RESULT);
+  {
+    Op<mpreal>::mpreal_sin(TEMP_RESULT, a.val());
+    return FTypeName<mpreal, 0>(TEMP_RESULT);
+  }
+  Op<mpreal>::mpreal_sin_cos(TEMP_RESULT, TEMP_RESULT1, a.val());
+  mpreal tmp(TEMP_RESULT1);
+  FTypeName<mpreal, 0> c(TEMP_RESULT);
   c.setDepend(a);
   for (unsigned int i = 0; i < c.size(); ++i)
     Op<mpreal>::mpreal_mul(c[ i ], a[ i ], tmp);
@@ -2021,13 +2025,15 @@ INLINE2 FTypeName<T, N> cos(const FTypeName<T, N>& a)
 template <unsigned int N>
 INLINE2 FTypeName<mpreal, N> cos(const FTypeName<mpreal, N>& a)
 {
-  Op<mpreal>::mpreal_cos(TEMP_RESULT, a.val());
-  FTypeName<mpreal, N> c(TEMP_RESULT);
   if (!a.depend())
-    return c;
-  Op<mpreal>::mpreal_sin(TEMP_RESULT, a.val());
-  Op<mpreal>::mpreal_neg(TEMP_RESULT1, TEMP_RESULT);
+  {
+    Op<mpreal>::mpreal_cos(TEMP_RESULT, a.val());
+    return FTypeName<mpreal, N>(TEMP_RESULT);
+  }
+  Op<mpreal>::mpreal_sin_cos(TEMP_RESULT1, TEMP_RESULT, a.val());
+  Op<mpreal>::mpreal_neg(TEMP_RESULT1, TEMP_RESULT1);
   mpreal tmp(TEMP_RESULT1);
+  FTypeName<mpreal, N> c(TEMP_RESULT);
   c.setDepend(a);
   for (unsigned int i = 0; i < N; ++i)
     Op<mpreal>::mpreal_mul(c[ i ], a[ i ], tmp);
@@ -2049,13 +2055,15 @@ INLINE2 FTypeName<T, 0> cos(const FTypeName<T, 0>& a)
 // reloaded for mpreal
 INLINE2 FTypeName<mpreal, 0> cos(const FTypeName<mpreal, 0>& a)
 {
-  Op<mpreal>::mpreal_cos(TEMP_RESULT, a.val());
-  FTypeName<mpreal, 0> c(TEMP_RESULT);
   if (!a.depend())
-    return c;
-  Op<mpreal>::mpreal_sin(TEMP_RESULT, a.val());
-  Op<mpreal>::mpreal_neg(TEMP_RESULT1, TEMP_RESULT);
+  {
+    Op<mpreal>::mpreal_cos(TEMP_RESULT, a.val());
+    return FTypeName<mpreal, 0>(TEMP_RESULT);
+  }
+  Op<mpreal>::mpreal_sin_cos(TEMP_RESULT1, TEMP_RESULT, a.val());
+  Op<mpreal>::mpreal_neg(TEMP_RESULT1, TEMP_RESULT1);
   mpreal tmp(TEMP_RESULT1);
+  FTypeName<mpreal, 0> c(TEMP_RESULT);
   c.setDepend(a);
   for (unsigned int i = 0; i < c.size(); ++i)
     Op<mpreal>::mpreal_mul(c[ i ], a[ i ], tmp);
@@ -2307,6 +2315,11 @@ INLINE2 FTypeName<mpreal, 0> atan(const FTypeName<mpreal, 0>& a)
   return c;
 }
 
+template <typename U, unsigned int N>
+struct Reentrant<FTypeName<U, N>> : Reentrant<U>
+{
+};
+
 template <typename U, unsigned int N>
 struct Op<FTypeName<U, N>>
 {
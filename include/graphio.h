@@ -0,0 +1,444 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _GRAPHIO_H
+#define _GRAPHIO_H
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "btape.h"
+#include "tadiff.h"
+
+namespace fadbad
+{
+
+// Versioned binary files holding a recorded graph, so that a process can
+// load it at startup instead of recording it again:
+//
+//   saveGraph(path, tape) / loadGraph(path, tape)
+//     the compact tape of the reverse mode (btape.h), records, values and
+//     pool of constants and kept partials. After loading, new inputs are set
+//     in the leaf records and Tape::replay() recomputes the values and the
+//     partials; BC<U>(BC<U>::Index(i))
+//     refers to record i for diff().
+//
+//   saveGraph(path, x, n, y, m) / loadGraph(path, x, n, y, m)
+//     the T graph of the dependent variables y[0..m) over the independent
+//     variables x[0..n). Loading builds the same nodes again on top of the
+//     caller's x and assigns the roots to y; other leaves keep the
+//     coefficients they had when saved, up to tLength<N>() of them (see
+//     tMaxLength() in tadiff.h), so a file with longer leaves is refused.
+//
+// Values go through TapeIO, so mpreal constants keep their full precision.
+// The files are read in one sequential pass; they are not portable across
+// byte orders. The functions return false on I/O errors and on files of an
+// other version, kind, base type or order N.
+static const unsigned int GRAPH_VERSION = 2;
+
+class GraphFile
+{
+  std::FILE* m_file;
+  bool       m_ok;
+
+  GraphFile(const GraphFile&) { /*illegal*/}
+  void operator=(const GraphFile&) { /*illegal*/}
+
+ public:
+  GraphFile(const char* path, const char* mode)
+      : m_file(std::fopen(path, mode)), m_ok(m_file != 0)
+  {
+  }
+  ~GraphFile()
+  {
+    if (m_file != 0)
+      std::fclose(m_file);
+  }
+  bool ok() const { return m_ok; }
+  bool close()
+  {
+    m_ok   = m_file != 0 && std::fclose(m_file) == 0 && m_ok;
+    m_file = 0;
+    return m_ok;
+  }
+  void put(const unsigned int n) { m_ok = m_ok && std::fwrite(&n, sizeof(n), 1, m_file) == 1; }
+  unsigned int get()
+  {
+    unsigned int n = 0;
+    m_ok           = m_ok && std::fread(&n, sizeof(n), 1, m_file) == 1;
+    return n;
+  }
+  template <typename U>
+  void putValue(const U& x)
+  {
+    m_ok = m_ok && TapeIO<U>::write(m_file, x);
+  }
+  template <typename U>
+  void getValue(U& x)
+  {
+    m_ok = m_ok && TapeIO<U>::read(m_file, x);
+  }
+  void putHeader(const unsigned int kind, const unsigned int size, const unsigned int order)
+  {
+    m_ok = m_ok && std::fwrite("FADBADGR", 8, 1, m_file) == 1;
+    put(GRAPH_VERSION);
+    put(kind);
+    put(size);
+    put(order);
+  }
+  bool getHeader(const unsigned int kind, const unsigned int size, const unsigned int order)
+  {
+    char magic[ 8 ];
+    m_ok = m_ok && std::fread(magic, 8, 1, m_file) == 1 && std::memcmp(magic, "FADBADGR", 8) == 0;
+    m_ok = m_ok && get() == GRAPH_VERSION;
+    m_ok = m_ok && get() == kind;
+    m_ok = m_ok && get() == size;
+    m_ok = m_ok && get() == order;
+    return m_ok;
+  }
+};
+
+// Number of operands of a T node and whether it holds a constant:
+inline unsigned int graphArity(const unsigned int op)
+{
+  switch (op)
+  {
+    case TAPE_LEAF:
+      return 0;
+    case TAPE_ADD:
+    case TAPE_SUB:
+    case TAPE_MUL:
+    case TAPE_DIV:
+    case TAPE_TAN:  // T: the second operand is sqr(cos(x))
+    case TAPE_ASIN:
+    case TAPE_ACOS:
+    case TAPE_ATAN:
+      return 2;
+    default:
+      return 1;
+  }
+}
+inline bool graphConstant(const unsigned int op)
+{
+  switch (op)
+  {
+    case TAPE_ADD_C:
+    case TAPE_SUB_C:
+    case TAPE_C_SUB:
+    case TAPE_MUL_C:
+    case TAPE_DIV_C:
+    case TAPE_C_DIV:
+    case TAPE_DIFF:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// COMPACT TAPE:
+
+template <typename U, typename A>
+bool saveGraph(const char* path, const Tape<U, A>& tape)
+{
+  GraphFile file(path, "wb");
+  file.putHeader(0, sizeof(U), 0);
+  file.put(tape.constants());
+  for (unsigned int k = 0; k < tape.constants(); ++k)
+    file.putValue(tape.constant(k));
+  file.put(tape.size());
+  for (unsigned int i = 0; i < tape.size() && file.ok(); ++i)
+  {
+    const typename Tape<U, A>::Node& n(tape[ i ]);
+    file.put(n.m_op);
+    file.put(n.m_a);
+    file.put(n.m_b);
+    file.putValue(n.m_val);
+  }
+  return file.close();
+}
+
+template <typename U, typename A>
+bool loadGraph(const char* path, Tape<U, A>& tape)
+{
+  USER_ASSERT(tape.size() == 0, "The tape must be empty")
+  GraphFile file(path, "rb");
+  if (!file.getHeader(0, sizeof(U), 0))
+    return false;
+  U                  c;
+  const unsigned int constants = file.get();
+  for (unsigned int k = 0; k < constants && file.ok(); ++k)
+  {
+    file.getValue(c);
+    tape.pushConstant(c);
+  }
+  const unsigned int size = file.get();
+  for (unsigned int i = 0; i < size && file.ok(); ++i)
+  {
+    const unsigned int op = file.get();
+    const unsigned int a  = file.get();
+    const unsigned int b  = file.get();
+    const bool         binary   = op >= TAPE_ADD && op <= TAPE_POW;
+    const bool         constant = op >= TAPE_ADD_C && op <= TAPE_C_POW;
+    const bool         partial  = Tape<U, A>::keepsPartial(op);
+    if (op > TAPE_ATAN || (op != TAPE_LEAF && a >= i) || (binary && b >= i) ||
+        (constant && b >= constants) || (partial && b + constant >= constants))
+    {
+      tape.clear();
+      return false;
+    }
+    file.getValue(tape[ tape.push(op, a, b) ].m_val);
+  }
+  if (!file.ok())
+    tape.clear();
+  return file.ok();
+}
+
+// TAYLOR GRAPH:
+
+template <typename U, int N>
+TTypeNameHV<U, N>* graphNode(const unsigned int op, TTypeNameHV<U, N>* a, TTypeNameHV<U, N>* b,
+                             const U& c)
+{
+  switch (op)
+  {
+    case TAPE_LEAF:
+      return new TTypeNameHV<U, N>();
+    case TAPE_ADD:
+      return new TTypeNameADD<U, N>(a, b);
+    case TAPE_SUB:
+      return new TTypeNameSUB<U, N>(a, b);
+    case TAPE_MUL:
+      return new TTypeNameMUL<U, N>(a, b);
+    case TAPE_DIV:
+      return new TTypeNameDIV<U, N>(a, b);
+    case TAPE_POW:
+      return new TTypeNamePOW<U, N>(a);
+    case TAPE_ADD_C:
+      return new TTypeNameADD2<U, N, U>(a, c);
+    case TAPE_SUB_C:
+      return new TTypeNameSUB2<U, N, U>(a, c);
+    case TAPE_C_SUB:
+      return new TTypeNameSUB1<U, N, U>(c, a);
+    case TAPE_MUL_C:
+      return new TTypeNameMUL2<U, N, U>(a, c);
+    case TAPE_DIV_C:
+      return new TTypeNameDIV2<U, N, U>(a, c);
+    case TAPE_C_DIV:
+      return new TTypeNameDIV1<U, N, U>(c, a);
+    case TAPE_POW_C:
+      return new TTypeNamePOW2<U, N, U>(a);
+    case TAPE_C_POW:
+      return new TTypeNamePOW1<U, N, U>(a);
+    case TAPE_NEG:
+      return new TTypeNameUMINUS<U, N>(a);
+    case TAPE_POS:
+      return new TTypeNameUPLUS<U, N>(a);
+    case TAPE_SQR:
+      return new TTypeNameSQR<U, N>(a);
+    case TAPE_SQRT:
+      return new TTypeNameSQRT<U, N>(a);
+    case TAPE_EXP:
+      return new TTypeNameEXP<U, N>(a);
+    case TAPE_LOG:
+      return new TTypeNameLOG<U, N>(a);
+    case TAPE_SIN:
+      return new TTypeNameSIN<U, N>(a);
+    case TAPE_COS:
+      return new TTypeNameCOS<U, N>(a);
+    case TAPE_TAN:
+      return new TTypeNameTAN<U, N>(a, b);
+    case TAPE_ASIN:
+      return new TTypeNameASIN<U, N>(a, b);
+    case TAPE_ACOS:
+      return new TTypeNameACOS<U, N>(a, b);
+    case TAPE_ATAN:
+      return new TTypeNameATAN<U, N>(a, b);
+    case TAPE_DIFF:
+      return new DIFF<U, N>(a, static_cast<int>(c));
+    default:
+      return 0;
+  }
+}
+
+template <typename U, int N>
+bool saveGraph(const char* path, const TTypeName<U, N>* x, const unsigned int n,
+               const TTypeName<U, N>* y, const unsigned int m)
+{
+  // Number the nodes below the roots in postorder, operands first:
+  typedef TTypeNameHV<U, N>                       HV;
+  std::map<const HV*, unsigned int>               index;
+  std::vector<const HV*>                          order;
+  std::vector<std::pair<const HV*, unsigned int>> stack;
+  for (unsigned int j = 0; j < m; ++j)
+  {
+    if (index.count(y[ j ].getTTypeNameHV()) == 0)
+      stack.push_back(std::make_pair(y[ j ].getTTypeNameHV(), 0u));
+    while (!stack.empty())
+    {
+      const HV* p = stack.back().first;
+      if (stack.back().second < p->arity())
+      {
+        const HV* q = p->operand(stack.back().second++);
+        if (index.count(q) == 0)
+          stack.push_back(std::make_pair(q, 0u));
+        continue;
+      }
+      stack.pop_back();
+      if (index.count(p) == 0)
+      {
+        index[ p ] = (unsigned int)order.size();
+        order.push_back(p);
+      }
+    }
+  }
+  GraphFile file(path, "wb");
+  file.putHeader(1, sizeof(U), N);
+  file.put(n);
+  for (unsigned int i = 0; i < n; ++i)
+  {
+    typename std::map<const HV*, unsigned int>::const_iterator k;
+    k = index.find(x[ i ].getTTypeNameHV());
+    file.put(k == index.end() ? ~0u : k->second);  // unused inputs are not saved
+  }
+  file.put(m);
+  for (unsigned int j = 0; j < m; ++j)
+    file.put(index[ y[ j ].getTTypeNameHV() ]);
+  file.put((unsigned int)order.size());
+  U c;
+  for (unsigned int i = 0; i < order.size() && file.ok(); ++i)
+  {
+    const HV*          p  = order[ i ];
+    const unsigned int op = p->opcode(&c);
+    file.put(op);
+    for (unsigned int k = 0; k < p->arity(); ++k)
+      file.put(index[ p->operand(k) ]);
+    if (graphConstant(op))
+      file.putValue(c);
+    if (op == TAPE_LEAF)  // coefficients up to the last nonzero one
+    {
+      unsigned int l = tLength<N>();
+      while (l > 0 && Op<U>::myEq(p->val(l - 1), Op<U>::myZero()))
+        --l;
+      file.put(p->length());
+      file.put(l);
+      for (unsigned int k = 0; k < l; ++k)
+        file.putValue(p->val(k));
+    }
+  }
+  return file.close();
+}
+
+template <typename U, int N>
+bool loadGraph(const char* path, TTypeName<U, N>* x, const unsigned int n, TTypeName<U, N>* y,
+               const unsigned int m)
+{
+  typedef TTypeNameHV<U, N> HV;
+  GraphFile                 file(path, "rb");
+  if (!file.getHeader(1, sizeof(U), N) || file.get() != n)
+    return false;
+  std::vector<unsigned int> inputs(n), outputs;
+  for (unsigned int i = 0; i < n; ++i)
+    inputs[ i ] = file.get();
+  if (file.get() != m)
+    return false;
+  outputs.resize(m);
+  for (unsigned int j = 0; j < m; ++j)
+    outputs[ j ] = file.get();
+  const unsigned int size = file.get();
+  if (!file.ok())
+    return false;
+  std::vector<int> bound(size, -1);
+  for (unsigned int i = 0; i < n; ++i)
+    if (inputs[ i ] < size)
+      bound[ inputs[ i ] ] = (int)i;
+  // The handles keep the nodes alive until the roots are assigned:
+  std::vector<TTypeName<U, N>> nodes;
+  nodes.reserve(size);
+  U c;
+  for (unsigned int i = 0; i < size; ++i)
+  {
+    const unsigned int op = file.get();
+    const unsigned int r  = graphArity(op);
+    HV*                operand[ 2 ] = {0, 0};
+    for (unsigned int k = 0; k < r; ++k)
+    {
+      const unsigned int a = file.get();
+      if (a >= i)
+        return false;
+      operand[ k ] = nodes[ a ].getTTypeNameHV();
+    }
+    if (graphConstant(op))
+      file.getValue(c);
+    if (!file.ok())
+      return false;
+    if (op == TAPE_LEAF && bound[ i ] >= 0)
+    {
+      USER_ASSERT(x[ bound[ i ] ].getTTypeNameHV()->arity() == 0,
+                  "Independent variable " << bound[ i ] << " is not a leaf")
+      nodes.push_back(x[ bound[ i ] ]);
+    }
+    else
+    {
+      HV* p = graphNode<U, N>(op, operand[ 0 ], operand[ 1 ], c);
+      if (p == 0)
+        return false;
+      nodes.push_back(TTypeName<U, N>(p));
+    }
+    if (op == TAPE_LEAF)
+    {
+      const unsigned int length = file.get();
+      const unsigned int l      = file.get();
+      if (l > tLength<N>() || length > tLength<N>())
+        return false;
+      HV* p = nodes.back().getTTypeNameHV();
+      for (unsigned int k = 0; k < l; ++k)
+        if (bound[ i ] >= 0)
+          file.getValue(c);
+        else
+          file.getValue(p->val(k));
+      if (bound[ i ] < 0)
+        p->length() = length;
+    }
+  }
+  if (!file.ok())
+    return false;
+  for (unsigned int j = 0; j < m; ++j)
+  {
+    if (outputs[ j ] >= size)
+      return false;
+    y[ j ] = nodes[ outputs[ j ] ];
+  }
+  return true;
+}
+
+}  // namespace fadbad
+
+#endif
@@ -0,0 +1,238 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _HESSIAN_H
+#define _HESSIAN_H
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "badiff.h"
+
+namespace fadbad
+{
+// Sparse Hessian of a recorded function by edge pushing: a single second
+// order reverse sweep over the graph below f, which pushes the nonlinear
+// interactions (W) down to the operands of each node together with the
+// ordinary adjoints. Only nonzero entries of W are stored, so the cost
+// scales with the number of nonzeros and not with n^2. The graph is not
+// consumed; diff() can still be called on f afterwards.
+//
+// The lower triangle of the Hessian with respect to x[0..n-1] is returned
+// in coordinate format (row >= col, sorted by row and column), and the
+// gradient in grad if it is not 0. Nodes recorded with RecordPartials
+// carry no second order information; if the graph has any, hessian()
+// returns false and leaves row, col, val and grad unchanged.
+//
+//   B<double> x[3], f(func(x));
+//   std::vector<unsigned int> row, col;
+//   std::vector<double> val;
+//   hessian(f, x, 3, row, col, val);
+template <typename U>
+class EdgePushing
+{
+  typedef BTypeNameHV<U>            HV;
+  typedef std::map<unsigned int, U> Row;
+
+  std::vector<HV*>                            m_nodes;  // topological order, operands first
+  std::unordered_map<const HV*, unsigned int> m_index;
+  std::vector<unsigned int>                   m_start;  // operands: m_ops[m_start[i]..m_start[i+1]]
+  std::vector<unsigned int>                   m_ops;
+  std::vector<U>                              m_adj;
+  std::vector<Row>                            m_W;  // W(j,k) is stored in row max(j,k)
+  std::vector<U>                              m_d, m_dd;
+  U                                           m_c;
+
+  EdgePushing(const EdgePushing&) { /*illegal*/}
+  void operator=(const EdgePushing&) { /*illegal*/}
+
+  U& entry(const unsigned int j, const unsigned int k)
+  {
+    Row& r(m_W[ std::max(j, k) ]);
+    return r.insert(std::make_pair(std::min(j, k), Op<U>::myZero())).first->second;
+  }
+  // W(j,k) += a*b for a symmetric pair of (j,k) and (k,j) when pair is true,
+  // which lands twice on the diagonal if j == k.
+  void push(const unsigned int j, const unsigned int k, const U& a, const U& b, const bool pair)
+  {
+    U& w(entry(j, k));
+    AdjointOp<U>::add_mul(w, a, b);
+    if (pair && j == k)
+      AdjointOp<U>::add_mul(w, a, b);
+  }
+  // Numbers the graph topologically, with the leaves first so that any
+  // W(i,p) with p > i is pushed when the intermediate p is processed.
+  void record(HV* pRoot)
+  {
+    std::vector<HV*>                           order;
+    std::vector<std::pair<HV*, unsigned int> > stack(1, std::make_pair(pRoot, 0u));
+    m_index[ pRoot ] = 0;
+    while (!stack.empty())
+    {
+      HV* pHV = stack.back().first;
+      if (stack.back().second < pHV->arity())
+      {
+        HV* pOp = pHV->operand(stack.back().second++);
+        if (m_index.insert(std::make_pair(pOp, 0u)).second)
+          stack.push_back(std::make_pair(pOp, 0u));
+        continue;
+      }
+      stack.pop_back();
+      order.push_back(pHV);
+    }
+    for (unsigned int i = 0; i < order.size(); ++i)
+      if (order[ i ]->arity() == 0)
+        m_nodes.push_back(order[ i ]);
+    for (unsigned int i = 0; i < order.size(); ++i)
+      if (order[ i ]->arity() != 0)
+        m_nodes.push_back(order[ i ]);
+    for (unsigned int i = 0; i < m_nodes.size(); ++i)
+      m_index[ m_nodes[ i ] ] = i;
+    m_start.resize(m_nodes.size() + 1, 0);
+    for (unsigned int i = 0; i < m_nodes.size(); ++i)
+    {
+      for (unsigned int s = 0; s < m_nodes[ i ]->arity(); ++s)
+        m_ops.push_back(m_index[ m_nodes[ i ]->operand(s) ]);
+      m_start[ i + 1 ] = (unsigned int)m_ops.size();
+    }
+  }
+  void sweep(const unsigned int root)
+  {
+    const unsigned int n = (unsigned int)m_nodes.size();
+    m_adj.assign(n, Op<U>::myZero());
+    m_W.resize(n);
+    m_adj[ root ] = Op<U>::myOne();
+    for (unsigned int i = n; i-- > 0;)
+    {
+      const unsigned int k = m_start[ i + 1 ] - m_start[ i ];
+      if (k == 0)
+        continue;
+      const unsigned int* op(&m_ops[ m_start[ i ] ]);
+      if (m_d.size() < k)
+      {
+        m_d.resize(k);
+        m_dd.resize(k * (k + 1) / 2);
+      }
+      const bool nonlinear = m_nodes[ i ]->partials(&m_d[ 0 ], &m_dd[ 0 ]);
+      // Pushing: W(i,p) is distributed over the operands of node i.
+      for (typename Row::iterator it = m_W[ i ].begin(); it != m_W[ i ].end(); ++it)
+      {
+        const unsigned int p = it->first;
+        const U&           w(it->second);
+        if (p != i)
+          for (unsigned int s = 0; s < k; ++s)
+            push(op[ s ], p, m_d[ s ], w, true);
+        else
+          for (unsigned int s = 0; s < k; ++s)
+            for (unsigned int t = 0; t <= s; ++t)
+            {
+              AdjointOp<U>::mul(m_c, m_d[ s ], m_d[ t ]);
+              push(op[ s ], op[ t ], m_c, w, s != t);
+            }
+      }
+      Row().swap(m_W[ i ]);
+      // Creating: second order partials weighted by the adjoint of node i.
+      if (nonlinear)
+        for (unsigned int s = 0, st = 0; s < k; ++s)
+          for (unsigned int t = 0; t <= s; ++t, ++st)
+            push(op[ s ], op[ t ], m_adj[ i ], m_dd[ st ], s != t);
+      // First order adjoints:
+      for (unsigned int s = 0; s < k; ++s)
+        AdjointOp<U>::add_mul(m_adj[ op[ s ] ], m_d[ s ], m_adj[ i ]);
+    }
+  }
+
+ public:
+  EdgePushing() {}
+  bool compute(const BTypeName<U>& f, BTypeName<U>* x, const unsigned int n,
+               std::vector<unsigned int>& row, std::vector<unsigned int>& col,
+               std::vector<U>& val, U* grad)
+  {
+    record(f.getBTypeNameHV());
+    for (unsigned int i = 0; i < m_nodes.size(); ++i)
+      if (!m_nodes[ i ]->hasSecondOrder())
+        return false;
+    sweep(m_index[ f.getBTypeNameHV() ]);
+    // Graph index of the inputs, and input number of the graph nodes:
+    std::unordered_map<unsigned int, unsigned int> input;
+    std::vector<int>                               node(n, -1);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+      typename std::unordered_map<const HV*, unsigned int>::const_iterator it(
+          m_index.find(x[ i ].getBTypeNameHV()));
+      if (it == m_index.end())
+        continue;
+      node[ i ]           = (int)it->second;
+      input[ it->second ] = i;
+    }
+    std::vector<std::pair<std::pair<unsigned int, unsigned int>, const U*> > h;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+      if (grad != 0)
+        grad[ i ] = node[ i ] < 0 ? Op<U>::myZero() : m_adj[ node[ i ] ];
+      if (node[ i ] < 0)
+        continue;
+      const Row& r(m_W[ node[ i ] ]);
+      for (typename Row::const_iterator it = r.begin(); it != r.end(); ++it)
+      {
+        std::unordered_map<unsigned int, unsigned int>::const_iterator j(input.find(it->first));
+        if (j != input.end())
+          h.push_back(std::make_pair(
+              std::make_pair(std::max(i, j->second), std::min(i, j->second)), &it->second));
+      }
+    }
+    std::sort(h.begin(), h.end());
+    row.resize(h.size());
+    col.resize(h.size());
+    val.resize(h.size());
+    for (unsigned int e = 0; e < h.size(); ++e)
+    {
+      row[ e ] = h[ e ].first.first;
+      col[ e ] = h[ e ].first.second;
+      val[ e ] = *h[ e ].second;
+    }
+    return true;
+  }
+};
+
+template <typename U>
+bool hessian(const BTypeName<U>& f, BTypeName<U>* x, const unsigned int n,
+             std::vector<unsigned int>& row, std::vector<unsigned int>& col, std::vector<U>& val,
+             U* grad = 0)
+{
+  EdgePushing<U> ep;
+  return ep.compute(f, x, n, row, col, val, grad);
+}
+
+}  // namespace fadbad
+
+#endif
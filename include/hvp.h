@@ -0,0 +1,234 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _HVP_H
+#define _HVP_H
+
+#include <vector>
+
+#include "badiff.h"
+#include "fadiff.h"
+
+namespace fadbad
+{
+// Adjoint updates for a forward-differentiated base type. The reverse sweep
+// of B<F<U, N> > carries tangent-augmented adjoints; here the value and the
+// nested tangent components are updated in place with the kernels of the
+// underlying type, so no F temporaries are built during propagation.
+template <typename U, unsigned int N>
+struct AdjointOp<FTypeName<U, N> >
+{
+  typedef FTypeName<U, N> FT;
+
+  static void zero(FT& r) { r = Op<U>::myZero(); }
+  static void neg(FT& r)
+  {
+    AdjointOp<U>::neg(r.x());
+    if (r.depend())
+      for (unsigned int j = 0; j < N; ++j)
+        AdjointOp<U>::neg(r[ j ]);
+  }
+  // r += d, r -= d
+  static void add(FT& r, const FT& d)
+  {
+    AdjointOp<U>::add(r.x(), d.val());
+    if (d.depend())
+    {
+      tangent(r);
+      for (unsigned int j = 0; j < N; ++j)
+        AdjointOp<U>::add(r[ j ], d[ j ]);
+    }
+  }
+  static void sub(FT& r, const FT& d)
+  {
+    AdjointOp<U>::sub(r.x(), d.val());
+    if (d.depend())
+    {
+      tangent(r);
+      for (unsigned int j = 0; j < N; ++j)
+        AdjointOp<U>::sub(r[ j ], d[ j ]);
+    }
+  }
+  // r = a*d
+  static void mul(FT& r, const FT& a, const FT& d)
+  {
+    if (!a.depend() && !d.depend())
+      r = Op<U>::myZero();
+    AdjointOp<U>::mul(r.x(), a.val(), d.val());
+    if (a.depend() && d.depend())
+    {
+      r.setDepend(a, d);
+      for (unsigned int j = 0; j < N; ++j)
+      {
+        AdjointOp<U>::mul(r[ j ], a.val(), d[ j ]);
+        AdjointOp<U>::add_mul(r[ j ], d.val(), a[ j ]);
+      }
+    }
+    else if (a.depend())
+    {
+      r.setDepend(a);
+      for (unsigned int j = 0; j < N; ++j)
+        AdjointOp<U>::mul(r[ j ], d.val(), a[ j ]);
+    }
+    else if (d.depend())
+    {
+      r.setDepend(d);
+      for (unsigned int j = 0; j < N; ++j)
+        AdjointOp<U>::mul(r[ j ], a.val(), d[ j ]);
+    }
+  }
+  template <typename V>
+  static void mul(FT& r, const V& a, const FT& d)
+  {
+    if (!d.depend())
+      r = Op<U>::myZero();
+    AdjointOp<U>::mul(r.x(), a, d.val());
+    if (d.depend())
+    {
+      r.setDepend(d);
+      for (unsigned int j = 0; j < N; ++j)
+        AdjointOp<U>::mul(r[ j ], a, d[ j ]);
+    }
+  }
+  // r = -a*d
+  template <typename V>
+  static void neg_mul(FT& r, const V& a, const FT& d)
+  {
+    mul(r, a, d);
+    neg(r);
+  }
+  // r += a*d
+  static void add_mul(FT& r, const FT& a, const FT& d)
+  {
+    AdjointOp<U>::add_mul(r.x(), a.val(), d.val());
+    if (d.depend())
+    {
+      tangent(r);
+      for (unsigned int j = 0; j < N; ++j)
+        AdjointOp<U>::add_mul(r[ j ], a.val(), d[ j ]);
+    }
+    if (a.depend())
+    {
+      tangent(r);
+      for (unsigned int j = 0; j < N; ++j)
+        AdjointOp<U>::add_mul(r[ j ], d.val(), a[ j ]);
+    }
+  }
+  template <typename V>
+  static void add_mul(FT& r, const V& a, const FT& d)
+  {
+    AdjointOp<U>::add_mul(r.x(), a, d.val());
+    if (d.depend())
+    {
+      tangent(r);
+      for (unsigned int j = 0; j < N; ++j)
+        AdjointOp<U>::add_mul(r[ j ], a, d[ j ]);
+    }
+  }
+  // r -= a*d
+  static void sub_mul(FT& r, const FT& a, const FT& d)
+  {
+    AdjointOp<U>::sub_mul(r.x(), a.val(), d.val());
+    if (d.depend())
+    {
+      tangent(r);
+      for (unsigned int j = 0; j < N; ++j)
+        AdjointOp<U>::sub_mul(r[ j ], a.val(), d[ j ]);
+    }
+    if (a.depend())
+    {
+      tangent(r);
+      for (unsigned int j = 0; j < N; ++j)
+        AdjointOp<U>::sub_mul(r[ j ], d.val(), a[ j ]);
+    }
+  }
+  template <typename V>
+  static void sub_mul(FT& r, const V& a, const FT& d)
+  {
+    AdjointOp<U>::sub_mul(r.x(), a, d.val());
+    if (d.depend())
+    {
+      tangent(r);
+      for (unsigned int j = 0; j < N; ++j)
+        AdjointOp<U>::sub_mul(r[ j ], a, d[ j ]);
+    }
+  }
+
+ private:
+  // Make r dependent with zero tangents, unless it already is.
+  static void tangent(FT& r)
+  {
+    if (r.depend())
+      return;
+    r.setDepend(r);
+    for (unsigned int j = 0; j < N; ++j)
+      AdjointOp<U>::zero(r[ j ]);
+  }
+};
+
+// Hessian-vector product by forward-over-reverse. func is evaluated once in
+// B<F<U, 1> > with the direction v seeded as the tangent of the inputs, and
+// a single reverse sweep returns grad f(x) in the values and H(x)*v in the
+// tangents of the adjoints, at a small constant multiple of the cost of a
+// gradient. The local partials are recorded at forward time (RecordPartials)
+// so the sweep reduces to in-place multiply-accumulates on F<U, 1>, which
+// lives on the stack.
+//
+//   B<F<double, 1> > func(const B<F<double, 1> >* x, unsigned int n);
+//   hvp(func, x, v, n, hv);            // hv = H(x)*v
+//   hvp(func, x, v, n, hv, grad, &f);  // also the gradient and f(x)
+template <typename U, typename Func>
+void hvp(Func func, const U* x, const U* v, const unsigned int n, U* hv, U* grad = 0, U* f = 0)
+{
+  USER_ASSERT(n > 0, "No independent variables")
+  typedef FTypeName<U, 1> FT;
+  RecordPartials            record;
+  std::vector<BTypeName<FT> > bx(n);
+  for (unsigned int i = 0; i < n; ++i)
+  {
+    FT xi(x[ i ]);
+    xi.diff(0) = v[ i ];
+    bx[ i ]    = xi;
+  }
+  BTypeName<FT> r(func(&bx[ 0 ], n));
+  r.diff(0, 1);
+  if (f != 0)
+    *f = r.val().val();
+  for (unsigned int i = 0; i < n; ++i)
+  {
+    const FT& di(bx[ i ].d(0));
+    if (grad != 0)
+      grad[ i ] = di.val();
+    hv[ i ] = di.depend() ? di[ 0 ] : Op<U>::myZero();
+  }
+}
+
+}  // namespace fadbad
+
+#endif
@@ -0,0 +1,501 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _LANES_H
+#define _LANES_H
+
+#include <type_traits>
+
+#include "badiff.h"
+#include "tseries.h"
+
+namespace fadbad
+{
+// Selects R for a built-in scalar V other than the element type T. Such
+// constants, e.g. 1 + sqr(x) in Lanes<mpreal, M>, would otherwise need two
+// conversions, to T and to Lanes, or be ambiguous with the operators of
+// B<mpreal>, which take any V.
+template <typename T, typename V, typename R>
+struct LanesScalar
+    : std::enable_if<std::is_arithmetic<V>::value && !std::is_same<T, V>::value, R>
+{
+};
+
+// M values of T processed together, one per lane. Used as the base type of
+// the reverse mode, B<Lanes<T, M> > records a function once and a single
+// sweep returns the gradients at M points: values and adjoints of every
+// node are Lanes, and all arithmetic runs lane by lane in short fixed
+// length loops which the compiler vectorizes.
+//
+//   B<Lanes<double, 4> > x[2];       // lane l holds point l
+//   for (unsigned int l = 0; l < 4; ++l)
+//   {
+//     x[ 0 ].x()[ l ] = p[ l ][ 0 ];
+//     x[ 1 ].x()[ l ] = p[ l ][ 1 ];
+//   }
+//   B<Lanes<double, 4> > f(func(x));
+//   f.diff(0, 1);                    // x[i].d(0)[l] = df/dx_i at point l
+//
+// As the base type of the Taylor mode, T<Lanes<T, M> > carries M
+// expansions through one graph, e.g. along M directions from the same
+// point (ttensor.h); every convolution of the recurrences then runs over
+// the M lanes at once.
+//
+// A comparison holds if it holds in every lane, so branches of the
+// recorded function must agree across the M points. A comparison that
+// holds in some lanes only sets lanesMixed(); a branch taken on it is
+// wrong for some of the points, which must then be evaluated apart.
+//
+//   lanesMixed() = false;
+//   B<Lanes<double, 4> > f(func(x));
+//   if (lanesMixed()) ...            // the lanes took different branches
+template <typename T, unsigned int M>
+class Lanes
+{
+  T m_v[ M ];
+
+ public:
+  typedef T Element;
+  Lanes() : m_v() {}  // zero, like the coefficients of T that are never set
+  Lanes(const T& x)  // broadcast
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      m_v[ l ] = x;
+  }
+  template <typename V>
+  Lanes(const V& x, typename LanesScalar<T, V, int>::type = 0)  // broadcast
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      m_v[ l ] = x;
+  }
+  T&       operator[](const unsigned int l) { return m_v[ l ]; }
+  const T& operator[](const unsigned int l) const { return m_v[ l ]; }
+  Lanes<T, M>& operator+=(const Lanes<T, M>& x)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      m_v[ l ] += x.m_v[ l ];
+    return *this;
+  }
+  Lanes<T, M>& operator-=(const Lanes<T, M>& x)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      m_v[ l ] -= x.m_v[ l ];
+    return *this;
+  }
+  Lanes<T, M>& operator*=(const Lanes<T, M>& x)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      m_v[ l ] *= x.m_v[ l ];
+    return *this;
+  }
+  Lanes<T, M>& operator/=(const Lanes<T, M>& x)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      m_v[ l ] /= x.m_v[ l ];
+    return *this;
+  }
+};
+
+template <typename T, unsigned int M>
+Lanes<T, M> operator+(const Lanes<T, M>& x)
+{
+  return x;
+}
+template <typename T, unsigned int M>
+Lanes<T, M> operator-(const Lanes<T, M>& x)
+{
+  Lanes<T, M> r;
+  for (unsigned int l = 0; l < M; ++l)
+    r[ l ] = -x[ l ];
+  return r;
+}
+
+// Binary operators for lanes and a scalar on either side (broadcast):
+#define LANES_BINARY(OP)                                                                  \
+  template <typename T, unsigned int M>                                                   \
+  Lanes<T, M> operator OP(const Lanes<T, M>& x, const Lanes<T, M>& y)                     \
+  {                                                                                       \
+    Lanes<T, M> r;                                                                        \
+    for (unsigned int l = 0; l < M; ++l)                                                  \
+      r[ l ] = x[ l ] OP y[ l ];                                                          \
+    return r;                                                                             \
+  }                                                                                       \
+  template <typename T, unsigned int M>                                                   \
+  Lanes<T, M> operator OP(const Lanes<T, M>& x, const typename Lanes<T, M>::Element& y)   \
+  {                                                                                       \
+    Lanes<T, M> r;                                                                        \
+    for (unsigned int l = 0; l < M; ++l)                                                  \
+      r[ l ] = x[ l ] OP y;                                                               \
+    return r;                                                                             \
+  }                                                                                       \
+  template <typename T, unsigned int M>                                                   \
+  Lanes<T, M> operator OP(const typename Lanes<T, M>::Element& x, const Lanes<T, M>& y)   \
+  {                                                                                       \
+    Lanes<T, M> r;                                                                        \
+    for (unsigned int l = 0; l < M; ++l)                                                  \
+      r[ l ] = x OP y[ l ];                                                               \
+    return r;                                                                             \
+  }                                                                                       \
+  template <typename T, unsigned int M, typename V>                                       \
+  typename LanesScalar<T, V, Lanes<T, M> >::type operator OP(const Lanes<T, M>& x,        \
+                                                             const V&           y)        \
+  {                                                                                       \
+    Lanes<T, M> r;                                                                        \
+    for (unsigned int l = 0; l < M; ++l)                                                  \
+      r[ l ] = x[ l ] OP y;                                                               \
+    return r;                                                                             \
+  }                                                                                       \
+  template <typename T, unsigned int M, typename V>                                       \
+  typename LanesScalar<T, V, Lanes<T, M> >::type operator OP(const V&           x,        \
+                                                             const Lanes<T, M>& y)        \
+  {                                                                                       \
+    Lanes<T, M> r;                                                                        \
+    for (unsigned int l = 0; l < M; ++l)                                                  \
+      r[ l ] = x OP y[ l ];                                                               \
+    return r;                                                                             \
+  }
+LANES_BINARY(+)
+LANES_BINARY(-)
+LANES_BINARY(*)
+LANES_BINARY(/)
+#undef LANES_BINARY
+
+// Elementary functions, lane by lane through Op<T>:
+#define LANES_UNARY(NAME, MYNAME)                      \
+  template <typename T, unsigned int M>                \
+  Lanes<T, M> NAME(const Lanes<T, M>& x)               \
+  {                                                    \
+    Lanes<T, M> r;                                     \
+    for (unsigned int l = 0; l < M; ++l)               \
+      r[ l ] = Op<T>::MYNAME(x[ l ]);                  \
+    return r;                                          \
+  }
+LANES_UNARY(sqr, mySqr)
+LANES_UNARY(sqrt, mySqrt)
+LANES_UNARY(exp, myExp)
+LANES_UNARY(log, myLog)
+LANES_UNARY(sin, mySin)
+LANES_UNARY(cos, myCos)
+LANES_UNARY(tan, myTan)
+LANES_UNARY(asin, myAsin)
+LANES_UNARY(acos, myAcos)
+LANES_UNARY(atan, myAtan)
+#undef LANES_UNARY
+// reloaded for mpreal
+#define LANES_UNARY_MPREAL(NAME, MPNAME)               \
+  template <unsigned int M>                            \
+  Lanes<mpreal, M> NAME(const Lanes<mpreal, M>& x)     \
+  {                                                    \
+    Lanes<mpreal, M> r;                                \
+    for (unsigned int l = 0; l < M; ++l)               \
+      Op<mpreal>::MPNAME(r[ l ], x[ l ]);              \
+    return r;                                          \
+  }
+LANES_UNARY_MPREAL(sqr, mpreal_sqr)
+LANES_UNARY_MPREAL(sqrt, mpreal_sqrt)
+LANES_UNARY_MPREAL(exp, mpreal_exp)
+LANES_UNARY_MPREAL(log, mpreal_log)
+LANES_UNARY_MPREAL(sin, mpreal_sin)
+LANES_UNARY_MPREAL(cos, mpreal_cos)
+LANES_UNARY_MPREAL(tan, mpreal_tan)
+LANES_UNARY_MPREAL(asin, mpreal_asin)
+LANES_UNARY_MPREAL(acos, mpreal_acos)
+LANES_UNARY_MPREAL(atan, mpreal_atan)
+#undef LANES_UNARY_MPREAL
+
+template <typename T, unsigned int M>
+Lanes<T, M> pow(const Lanes<T, M>& x, const Lanes<T, M>& y)
+{
+  Lanes<T, M> r;
+  for (unsigned int l = 0; l < M; ++l)
+    r[ l ] = Op<T>::myPow(x[ l ], y[ l ]);
+  return r;
+}
+template <typename T, unsigned int M>
+Lanes<T, M> pow(const Lanes<T, M>& x, const typename Lanes<T, M>::Element& y)
+{
+  Lanes<T, M> r;
+  for (unsigned int l = 0; l < M; ++l)
+    r[ l ] = Op<T>::myPow(x[ l ], y);
+  return r;
+}
+template <typename T, unsigned int M>
+Lanes<T, M> pow(const typename Lanes<T, M>::Element& x, const Lanes<T, M>& y)
+{
+  Lanes<T, M> r;
+  for (unsigned int l = 0; l < M; ++l)
+    r[ l ] = Op<T>::myPow(x, y[ l ]);
+  return r;
+}
+template <typename T, unsigned int M, typename V>
+typename LanesScalar<T, V, Lanes<T, M> >::type pow(const Lanes<T, M>& x, const V& y)
+{
+  return pow(x, T(y));
+}
+template <typename T, unsigned int M, typename V>
+typename LanesScalar<T, V, Lanes<T, M> >::type pow(const V& x, const Lanes<T, M>& y)
+{
+  return pow(T(x), y);
+}
+
+// reloaded for mpreal
+template <unsigned int M>
+Lanes<mpreal, M> pow(const Lanes<mpreal, M>& x, const Lanes<mpreal, M>& y)
+{
+  Lanes<mpreal, M> r;
+  for (unsigned int l = 0; l < M; ++l)
+    Op<mpreal>::mpreal_pow(r[ l ], x[ l ], y[ l ]);
+  return r;
+}
+template <unsigned int M>
+Lanes<mpreal, M> pow(const Lanes<mpreal, M>& x, const mpreal& y)
+{
+  Lanes<mpreal, M> r;
+  for (unsigned int l = 0; l < M; ++l)
+    Op<mpreal>::mpreal_pow(r[ l ], x[ l ], y);
+  return r;
+}
+template <unsigned int M>
+Lanes<mpreal, M> pow(const mpreal& x, const Lanes<mpreal, M>& y)
+{
+  Lanes<mpreal, M> r;
+  for (unsigned int l = 0; l < M; ++l)
+    Op<mpreal>::mpreal_pow(r[ l ], x, y[ l ]);
+  return r;
+}
+
+// Set by a comparison of Lanes that holds in some lanes and not in others,
+// for the calling thread; it is only cleared by the user.
+inline bool& lanesMixed()
+{
+  static FADBAD_TLS bool mixed = false;
+  return mixed;
+}
+
+// Comparisons hold if they hold in every lane:
+#define LANES_COMPARE(OP)                                         \
+  template <typename T, unsigned int M>                           \
+  bool operator OP(const Lanes<T, M>& x, const Lanes<T, M>& y)    \
+  {                                                               \
+    unsigned int n = 0;                                           \
+    for (unsigned int l = 0; l < M; ++l)                          \
+      n += x[ l ] OP y[ l ] ? 1 : 0;                              \
+    if (n != 0 && n != M)                                         \
+      lanesMixed() = true;                                        \
+    return n == M;                                                \
+  }
+LANES_COMPARE(==)
+LANES_COMPARE(<)
+LANES_COMPARE(<=)
+LANES_COMPARE(>)
+LANES_COMPARE(>=)
+#undef LANES_COMPARE
+template <typename T, unsigned int M>
+bool operator!=(const Lanes<T, M>& x, const Lanes<T, M>& y)
+{
+  return !(x == y);
+}
+
+template <typename T, unsigned int M>
+std::ostream& operator<<(std::ostream& os, const Lanes<T, M>& x)
+{
+  os << "(";
+  for (unsigned int l = 0; l < M; ++l)
+    os << (l > 0 ? ", " : "") << x[ l ];
+  return os << ")";
+}
+
+template <typename T, unsigned int M>
+struct Reentrant<Lanes<T, M> > : Reentrant<T>
+{
+};
+
+template <typename T, unsigned int M>
+struct Op<Lanes<T, M> >
+{
+  typedef Lanes<T, M> U;
+  typedef Lanes<T, M> Underlying;
+  typedef typename Op<T>::Base Base;
+  static Base myInteger(const int i) { return Base(i); }
+  static Base                     myZero() { return myInteger(0); }
+  static Base                     myOne() { return myInteger(1); }
+  static Base                     myTwo() { return myInteger(2); }
+  static Base                     myPI() { return Op<T>::myPI(); }
+  static U myPos(const U& x) { return +x; }
+  static U myNeg(const U& x) { return -x; }
+  template <typename V>
+  static U& myCadd(U& x, const V& y)
+  {
+    return x += y;
+  }
+  template <typename V>
+  static U& myCsub(U& x, const V& y)
+  {
+    return x -= y;
+  }
+  template <typename V>
+  static U& myCmul(U& x, const V& y)
+  {
+    return x *= y;
+  }
+  template <typename V>
+  static U& myCdiv(U& x, const V& y)
+  {
+    return x /= y;
+  }
+  static U myInv(const U& x) { return Base(myOne()) / x; }
+  static U mySqr(const U& x) { return fadbad::sqr(x); }
+  template <typename X, typename Y>
+  static U myPow(const X& x, const Y& y)
+  {
+    return fadbad::pow(x, y);
+  }
+  static U mySqrt(const U& x) { return fadbad::sqrt(x); }
+  static U myLog(const U& x) { return fadbad::log(x); }
+  static U myExp(const U& x) { return fadbad::exp(x); }
+  static U mySin(const U& x) { return fadbad::sin(x); }
+  static U myCos(const U& x) { return fadbad::cos(x); }
+  static U myTan(const U& x) { return fadbad::tan(x); }
+  static U myAsin(const U& x) { return fadbad::asin(x); }
+  static U myAcos(const U& x) { return fadbad::acos(x); }
+  static U myAtan(const U& x) { return fadbad::atan(x); }
+  static bool myEq(const U& x, const U& y) { return x == y; }
+  static bool myNe(const U& x, const U& y) { return x != y; }
+  static bool myLt(const U& x, const U& y) { return x < y; }
+  static bool myLe(const U& x, const U& y) { return x <= y; }
+  static bool myGt(const U& x, const U& y) { return x > y; }
+  static bool myGe(const U& x, const U& y) { return x >= y; }
+};
+
+// Block series products of T<Lanes<T, M> > (tseries.h), lane by lane.
+// The lanes are scaled alike, by the decay of the largest one, and the
+// spread is taken over all lanes, so Karatsuba is only used if it is safe
+// for every lane.
+template <typename T, unsigned int M>
+struct TSeriesOp<Lanes<T, M> >
+{
+  typedef Lanes<T, M> L;
+  typedef TSeriesOp<T> S;
+  static void zero(L& r)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      S::zero(r[ l ]);
+  }
+  static void addMul(L& r, const L& a, const L& b)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      S::addMul(r[ l ], a[ l ], b[ l ]);
+  }
+  static void add(L& r, const L& a, const L& b)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      S::add(r[ l ], a[ l ], b[ l ]);
+  }
+  static void sub(L& r, const L& a, const L& b)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      S::sub(r[ l ], a[ l ], b[ l ]);
+  }
+  static void pow2(L& r, const int j)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      S::pow2(r[ l ], j);
+  }
+  static void scale(L& r, const L& f, const int e)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      S::scale(r[ l ], f[ l ], e);
+  }
+  static void range(double& lo, double& hi, const L& a)  // over the nonzero lanes
+  {
+    lo = HUGE_VAL;
+    hi = -HUGE_VAL;
+    for (unsigned int l = 0; l < M; ++l)
+    {
+      double a_lo, a_hi;
+      S::range(a_lo, a_hi, a[ l ]);
+      if (a_hi == -HUGE_VAL)
+        continue;
+      lo = std::min(lo, a_lo);
+      hi = std::max(hi, a_hi);
+    }
+    if (hi == -HUGE_VAL)
+      lo = -HUGE_VAL;
+  }
+};
+
+// Adjoint updates of B<Lanes<T, M> > as single fused loops over the lanes.
+// A partial derivative that is not a Lanes (a constant operand) is
+// broadcast.
+template <typename T, unsigned int M>
+struct AdjointOp<Lanes<T, M> >
+{
+  typedef Lanes<T, M> L;
+
+  static const T& lane(const L& a, const unsigned int l) { return a[ l ]; }
+  template <typename V>
+  static const V& lane(const V& a, const unsigned int) { return a; }
+
+  static void zero(L& r) { r = Op<T>::myZero(); }
+  static void neg(L& r)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      r[ l ] = -r[ l ];
+  }
+  static void add(L& r, const L& d) { r += d; }
+  static void sub(L& r, const L& d) { r -= d; }
+  template <typename V>
+  static void mul(L& r, const V& a, const L& d)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      r[ l ] = lane(a, l) * d[ l ];
+  }
+  template <typename V>
+  static void neg_mul(L& r, const V& a, const L& d)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      r[ l ] = -(lane(a, l) * d[ l ]);
+  }
+  template <typename V>
+  static void add_mul(L& r, const V& a, const L& d)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      r[ l ] += lane(a, l) * d[ l ];
+  }
+  template <typename V>
+  static void sub_mul(L& r, const V& a, const L& d)
+  {
+    for (unsigned int l = 0; l < M; ++l)
+      r[ l ] -= lane(a, l) * d[ l ];
+  }
+};
+
+}  // namespace fadbad
+
+#endif
@@ -0,0 +1,95 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _PREACC_H
+#define _PREACC_H
+
+#include <sstream>
+#include <stdexcept>
+
+#include "badiff.h"
+#include "fadiff.h"
+
+namespace fadbad
+{
+// Statement-level preaccumulation for the reverse mode. The inputs of a
+// statement (or of a larger block) are seeded as forward variables, the
+// statement is evaluated eagerly in FTypeName<U, K>, and output() records a
+// single node holding the partial derivatives with respect to the inputs,
+// instead of one node per operation. K bounds the number of inputs; the
+// (K+1)-th call of input() throws std::length_error, also in release
+// builds, and leaves the preaccumulator as it was.
+//
+//   Preaccumulator<double> pre;
+//   F<double, 8> a(pre.input(x)), b(pre.input(y));
+//   B<double> z(pre.output(sin(a + b / 3.2 - c)));
+template <typename U, unsigned int K = 8>
+class Preaccumulator
+{
+  BTypeNameHV<U>* m_ops[ K ];
+  unsigned int    m_n;
+  Preaccumulator(const Preaccumulator&) { /*illegal*/}
+  void operator=(const Preaccumulator&) { /*illegal*/}
+
+ public:
+  Preaccumulator() : m_n(0) {}
+  ~Preaccumulator()
+  {
+    for (unsigned int i = 0; i < m_n; ++i)
+      m_ops[ i ]->decRef(m_ops[ i ]);
+  }
+  unsigned int size() const { return m_n; }
+  FTypeName<U, K> input(const BTypeName<U>& x)
+  {
+    if (m_n >= K)
+    {
+      std::ostringstream ost;
+      ost << "Preaccumulator: too many inputs, capacity is " << K;
+      throw std::length_error(ost.str());
+    }
+    m_ops[ m_n ] = x.getBTypeNameHV();
+    m_ops[ m_n ]->incRef();
+    FTypeName<U, K> f(x.val());
+    f.diff(m_n++);
+    return f;
+  }
+  BTypeName<U> output(const FTypeName<U, K>& r)
+  {
+    if (!r.depend() || m_n == 0)
+      return BTypeName<U>(r.val());
+    BTypeNameLINN<U>* pHV = new BTypeNameLINN<U>(r.val(), m_ops, m_n);
+    for (unsigned int i = 0; i < m_n; ++i)
+      pHV->m_d[ i ] = r[ i ];
+    return BTypeName<U>(static_cast<BTypeNameHV<U>*>(pHV));
+  }
+};
+
+}  // namespace fadbad
+
+#endif
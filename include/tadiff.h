@@ -31,62 +31,146 @@
 #define _TADIFF_H
 
 #include <algorithm>
+#include <vector>
 
 #ifndef MaxLength
 #define MaxLength 40
 #endif
 
 #include "fadbad.h"
+#include "tseries.h"
 
 namespace fadbad
 {
+// Generation of the Taylor coefficients of the calling thread. reset()
+// starts a new generation instead of walking the graph, which on a graph
+// with shared nodes visits each node once per path. A node stamped with an
+// older generation has no valid coefficients, and finds that out the next
+// time its length is looked at. New generations are drawn from one counter
+// shared by all threads, so a node evaluated by another thread is never
+// taken for an up to date one.
+inline unsigned long& tGeneration()
+{
+  static FADBAD_TLS unsigned long generation = 0;
+  return generation;
+}
+inline void newTGeneration()
+{
+#ifdef FADBAD_THREADSAFE
+  static std::atomic<unsigned long> next(0);
+  tGeneration() = next.fetch_add(1, std::memory_order_relaxed) + 1;
+#else
+  ++tGeneration();
+#endif
+}
+
+// Bound on the number of Taylor coefficients of the T types. It is N
+// unless a bound is set at run time with tMaxLength() = n, which then
+// applies to all T types, so that the order can be chosen without
+// compiling for a larger N. Set it before the T variables are created;
+// 0 restores N.
+inline unsigned int& tMaxLength()
+{
+  static unsigned int n = 0;
+  return n;
+}
+template <int N>
+inline unsigned int tLength()
+{
+  return tMaxLength() != 0 ? tMaxLength() : (unsigned int)N;
+}
+
+// Taylor coefficients of a node. The storage grows on demand, so memory
+// and setup scale with the order that is evaluated; tLength<N>() only
+// bounds the order. Coefficients that were never stored read as zero.
+// They are kept in chunks of TChunk that are never moved once allocated,
+// so references to coefficients stay valid while the storage grows.
 template <typename U, int N>
 class TValues
 {
-  unsigned int m_n;
-  U            m_val[ N ];
+  static const unsigned int TChunk = 8;
+  unsigned int    m_n;
+  std::vector<U*> m_chunk;
+
+  static const U& zero()
+  {
+    static const U z(Op<U>::myZero());
+    return z;
+  }
+  unsigned int size() const { return (unsigned int)m_chunk.size() * TChunk; }
 
  public:
-  TValues() : m_n(0) { std::fill(m_val, m_val + N, Op<U>::myZero()); }
+  TValues() : m_n(0) {}
   template <typename V>
   explicit TValues(const V& val) : m_n(1)
   {
-    m_val[ 0 ] = val;
-    std::fill(m_val + 1, m_val + N, Op<U>::myZero());
+    reserve(1);
+    m_chunk[ 0 ][ 0 ] = val;
+  }
+  ~TValues()
+  {
+    for (unsigned int i = 0; i < m_chunk.size(); ++i)
+      delete[] m_chunk[ i ];
   }
   U& operator[](const unsigned int i)
   {
-    USER_ASSERT(i < N, "Index " << i << " out of bounds [0," << N << "]")
-    return m_val[ i ];
+    USER_ASSERT(i < tLength<N>(), "Index " << i << " out of bounds [0," << tLength<N>() << "]")
+    if (i >= size())
+      reserve(i + 1);
+    return m_chunk[ i / TChunk ][ i % TChunk ];
   }
   const U& operator[](const unsigned int i) const
   {
-    USER_ASSERT(i < N, "Index " << i << " out of bounds [0," << N << "]")
-    return m_val[ i ];
+    USER_ASSERT(i < tLength<N>(), "Index " << i << " out of bounds [0," << tLength<N>() << "]")
+    return i < size() ? m_chunk[ i / TChunk ][ i % TChunk ] : zero();
   }
   unsigned int  length() const { return m_n; }
   unsigned int& length() { return m_n; }
   void          reset() { m_n = 0; }
+  void          reserve(const unsigned int n)
+  {
+    const unsigned int l = std::min(n, tLength<N>());
+    while (size() < l)
+      m_chunk.push_back(new U[ TChunk ]());
+  }
+
+ private:
+  TValues(const TValues<U, N>&);           // not allowed
+  void operator=(const TValues<U, N>&) {}  // not allowed
 };
 
+template <typename U, int N>
+class TrigTTypeNameHV;
+
 template <typename U, int N>
 class TTypeNameHV  // Heap Value
 {
   TValues<U, N> m_val;
-  mutable unsigned int m_rc;
+  unsigned long      m_generation;
+  mutable RefCounter m_rc;
+  TrigTTypeNameHV<U, N>* m_pTrig;
 
  protected:
   virtual ~TTypeNameHV() {}
  public:
-  TTypeNameHV() : m_rc(0) {}
+  TTypeNameHV() : m_generation(tGeneration()), m_rc(0), m_pTrig(0) {}
   template <typename V>
-  explicit TTypeNameHV(const V& val) : m_val(val), m_rc(0)
+  explicit TTypeNameHV(const V& val)
+      : m_val(val), m_generation(tGeneration()), m_rc(0), m_pTrig(0)
   {
   }
   const U& val(const unsigned int i) const { return m_val[ i ]; }
   U& val(const unsigned int i) { return m_val[ i ]; }
-  unsigned int              length() const { return m_val.length(); }
-  unsigned int&             length() { return m_val.length(); }
+  unsigned int length() const { return m_generation == tGeneration() ? m_val.length() : 0; }
+  unsigned int& length()
+  {
+    if (m_generation != tGeneration())
+    {
+      m_val.reset();
+      m_generation = tGeneration();
+    }
+    return m_val.length();
+  }
   void decRef(TTypeNameHV<U, N>*& pTTypeNameHV) const
   {
     if (--m_rc == 0)
@@ -96,8 +180,66 @@ class TTypeNameHV  // Heap Value
     }
   }
   void                 incRef() const { ++m_rc; }
-  virtual void         reset() { m_val.reset(); }
+  virtual void         reserve(const unsigned int n) { m_val.reserve(n); }
+  // Sets the coefficients 0..l-1 to those of the product of a and b formed
+  // at once (tseries.h), on contiguous copies of the coefficients:
+  void bulkMul(TTypeNameHV<U, N>* a, TTypeNameHV<U, N>* b, const unsigned int l)
+  {
+    std::vector<U> x(l), y(l), z(l);
+    for (unsigned int i = 0; i < l; ++i)
+    {
+      x[ i ] = a->val(i);
+      y[ i ] = b->val(i);
+    }
+    TSeries<U>::mul(&z[ 0 ], &x[ 0 ], &y[ 0 ], l);
+    for (unsigned int i = 0; i < l; ++i)
+      val(i) = z[ i ];
+  }
   virtual unsigned int eval(const unsigned int k) { return k + 1; }
+  // Evaluates the node to order k. A node that already has the coefficients
+  // returns at once, so shared nodes are only expanded once:
+  unsigned int evalTo(const unsigned int k)
+  {
+    if (length() > k && arity() > 0)
+      return length();
+    reserve(k + 1);
+    return eval(k);
+  }
+  // Kind of the node as a TapeOp code, and its constant operand if it
+  // holds one (graphio.h):
+  virtual unsigned int opcode(U*) const { return TAPE_LEAF; }
+  // Operands of the node:
+  virtual unsigned int       arity() const { return 0; }
+  virtual TTypeNameHV<U, N>* operand(const unsigned int) const { return 0; }
+  // The last sin or cos node of this node that has not been paired with its
+  // counterpart yet (TrigTTypeNameHV). Shared nodes take no part in this:
+  TrigTTypeNameHV<U, N>** trig() { return isShared(m_rc) ? 0 : &m_pTrig; }
+  void dropTrig(const TrigTTypeNameHV<U, N>* p)
+  {
+    if (m_pTrig == p)
+      m_pTrig = 0;
+  }
+  // Marks the node and the graph below it as shared, after which it may be
+  // referenced from graphs built on other threads (FADBAD_THREADSAFE). The
+  // Taylor coefficients themselves must still be evaluated by one thread
+  // at a time.
+  void share()
+  {
+#ifdef FADBAD_THREADSAFE
+    std::vector<TTypeNameHV<U, N>*> stack(1, this);
+    while (!stack.empty())
+    {
+      TTypeNameHV<U, N>* pHV = stack.back();
+      stack.pop_back();
+      if (isShared(pHV->m_rc))
+        continue;
+      markShared(pHV->m_rc);
+      pHV->m_pTrig = 0;
+      for (unsigned int i = 0; i < pHV->arity(); ++i)
+        stack.push_back(pHV->operand(i));
+    }
+#endif
+  }
 };
 
 template <typename U, int N = MaxLength>
@@ -128,8 +270,7 @@ class TTypeName
     unsigned int                    length() const { return m_pTTypeNameHV->length(); }
     unsigned int&                   length() { return m_pTTypeNameHV->length(); }
     U& val(const unsigned int i) { return m_pTTypeNameHV->val(i); }
-    void                      reset() { m_pTTypeNameHV->reset(); }
-    unsigned int eval(const unsigned int i) { return m_pTTypeNameHV->eval(i); }
+    unsigned int eval(const unsigned int i) { return m_pTTypeNameHV->evalTo(i); }
   } m_sv;
 
  public:
@@ -139,7 +280,7 @@ class TTypeName
   explicit TTypeName(const typename TTypeName<U, N>::SV& sv) : m_sv(sv) {}
   template <typename V> /*explicit*/ TTypeName(const V& val) : m_sv(new TTypeNameHV<U, N>(val))
   {
-    m_sv.length() = N;
+    m_sv.length() = tLength<N>();
   }
   TTypeName<U, N>& operator=(const TTypeName<U, N>& val)
   {
@@ -152,7 +293,7 @@ class TTypeName
   TTypeName<U, N>& operator=(const V& val)
   {
     m_sv.setTTypeNameHV(new TTypeNameHV<U, N>(val));
-    m_sv.length() = N;
+    m_sv.length() = tLength<N>();
     return *this;
   }
   TTypeNameHV<U, N>* getTTypeNameHV() const { return m_sv.getTTypeNameHV(); }
@@ -180,8 +321,11 @@ class TTypeName
   template <typename V>
   TTypeName<U, N>& operator/=(const V& val);
 
-  void         reset() { m_sv.reset(); }
+  // Drops the coefficients of all T nodes of the thread, not only those
+  // below this one; the values of the leaves are kept.
+  void         reset() { newTGeneration(); }
   unsigned int eval(const unsigned int i) { return m_sv.eval(i); }
+  void         share() const { m_sv.getTTypeNameHV()->share(); }
 };
 
 template <typename U, int N>
@@ -303,16 +447,21 @@ class BinTTypeNameHV : public TTypeNameHV<U, N>
   }
   TTypeNameHV<U, N>* op1() { return m_pOp1; }
   TTypeNameHV<U, N>* op2() { return m_pOp2; }
-  unsigned int op1Eval(const unsigned int k) { return this->op1()->eval(k); }
-  unsigned int op2Eval(const unsigned int k) { return this->op2()->eval(k); }
-  const U& op1Val(const unsigned int k) { return this->op1()->val(k); }
-  const U& op2Val(const unsigned int k) { return this->op2()->val(k); }
-  void                               reset()
+  virtual unsigned int       arity() const { return 2; }
+  virtual TTypeNameHV<U, N>* operand(const unsigned int i) const
+  {
+    return i == 0 ? m_pOp1 : m_pOp2;
+  }
+  unsigned int op1Eval(const unsigned int k)
+  {
+    return this->op1()->evalTo(k);
+  }
+  unsigned int op2Eval(const unsigned int k)
   {
-    op1()->reset();
-    op2()->reset();
-    TTypeNameHV<U, N>::reset();
+    return this->op2()->evalTo(k);
   }
+  const U& op1Val(const unsigned int k) { return this->op1()->val(k); }
+  const U& op2Val(const unsigned int k) { return this->op2()->val(k); }
 };
 
 // Unary operator base class:
@@ -330,13 +479,83 @@ class UnTTypeNameHV : public TTypeNameHV<U, N>
   UnTTypeNameHV(TTypeNameHV<U, N>* pOp) : TTypeNameHV<U, N>(), m_pOp(pOp) { m_pOp->incRef(); }
   virtual ~UnTTypeNameHV() { m_pOp->decRef(m_pOp); }
   TTypeNameHV<U, N>* op() { return m_pOp; }
-  unsigned int opEval(const unsigned int k) { return this->op()->eval(k); }
+  virtual unsigned int       arity() const { return 1; }
+  virtual TTypeNameHV<U, N>* operand(const unsigned int) const { return m_pOp; }
+  unsigned int opEval(const unsigned int k)
+  {
+    return this->op()->evalTo(k);
+  }
   const U& opVal(const unsigned int k) { return this->op()->val(k); }
-  void                              reset()
+};
+
+// Sin and cos base class. The two series are computed together, so the
+// sin and cos nodes of the same operand pair up and fill in each other's
+// coefficients instead of running the recurrence twice. A node without a
+// partner keeps the other series to itself:
+
+template <typename U, int N>
+class TrigTTypeNameHV : public UnTTypeNameHV<U, N>
+{
+  const bool             m_sin;
+  TrigTTypeNameHV<U, N>* m_pPartner;
+  TValues<U, N>          m_other;
+
+  void pair()
+  {
+    TrigTTypeNameHV<U, N>** ppPending = this->op()->trig();
+    if (ppPending == 0)
+      return;
+    TrigTTypeNameHV<U, N>* p = *ppPending;
+    if (p != 0 && p->m_sin != m_sin && p->m_pPartner == 0 && p->length() == this->length())
+    {
+      m_pPartner    = p;
+      p->m_pPartner = this;
+      *ppPending    = 0;
+    }
+    else
+      *ppPending = this;
+  }
+
+ public:
+  TrigTTypeNameHV(const U& val, const U& other, TTypeNameHV<U, N>* pOp, const bool sin)
+      : UnTTypeNameHV<U, N>(val, pOp), m_sin(sin), m_pPartner(0), m_other(other)
+  {
+    pair();
+  }
+  TrigTTypeNameHV(TTypeNameHV<U, N>* pOp, const bool sin)
+      : UnTTypeNameHV<U, N>(pOp), m_sin(sin), m_pPartner(0)
+  {
+    pair();
+  }
+  virtual ~TrigTTypeNameHV()
+  {
+    if (m_pPartner)  // the partner keeps our coefficients
+    {
+      for (unsigned int i = 0; i < this->length(); ++i)
+        m_pPartner->m_other[ i ] = this->val(i);
+      m_pPartner->m_pPartner = 0;
+    }
+    this->op()->dropTrig(this);
+  }
+  void reserve(const unsigned int n)
+  {
+    UnTTypeNameHV<U, N>::reserve(n);
+    if (m_pPartner)
+      m_pPartner->UnTTypeNameHV<U, N>::reserve(n);
+    else
+      m_other.reserve(n);
+  }
+  // Coefficient i of cos for a sin node, and of sin for a cos node:
+  U& other(const unsigned int i) { return m_pPartner ? m_pPartner->val(i) : m_other[ i ]; }
+  unsigned int setLength(const unsigned int l)
   {
-    op()->reset();
-    TTypeNameHV<U, N>::reset();
+    if (m_pPartner)
+      m_pPartner->length() = l;
+    return this->length() = l;
   }
+
+ private:
+  void operator=(const TrigTTypeNameHV<U, N>&) {}  // not allowed
 };
 
 // ADDITION:
@@ -351,6 +570,7 @@ struct TTypeNameADD : public BinTTypeNameHV<U, N>
   TTypeNameADD(TTypeNameHV<U, N>* pOp1, TTypeNameHV<U, N>* pOp2) : BinTTypeNameHV<U, N>(pOp1, pOp2)
   {
   }
+  unsigned int opcode(U*) const { return TAPE_ADD; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -374,6 +594,7 @@ struct TTypeNameADD<mpreal, N> : public BinTTypeNameHV<mpreal, N>
       : BinTTypeNameHV<mpreal, N>(pOp1, pOp2)
   {
   }
+  unsigned int opcode(mpreal*) const { return TAPE_ADD; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -398,6 +619,11 @@ struct TTypeNameADD1 : public UnTTypeNameHV<U, N>
   {
   }
   TTypeNameADD1(const V& a, TTypeNameHV<U, N>* pOp2) : UnTTypeNameHV<U, N>(pOp2), m_a(a) {}
+  unsigned int opcode(U* c) const
+  {
+    *c = m_a;
+    return TAPE_ADD_C;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -426,6 +652,11 @@ struct TTypeNameADD1<mpreal, N, V> : public UnTTypeNameHV<mpreal, N>
   TTypeNameADD1(const V& a, TTypeNameHV<mpreal, N>* pOp2) : UnTTypeNameHV<mpreal, N>(pOp2), m_a(a)
   {
   }
+  unsigned int opcode(mpreal* c) const
+  {
+    *c = m_a;
+    return TAPE_ADD_C;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -453,6 +684,11 @@ struct TTypeNameADD2 : public UnTTypeNameHV<U, N>
   {
   }
   TTypeNameADD2(TTypeNameHV<U, N>* pOp1, const V& b) : UnTTypeNameHV<U, N>(pOp1), m_b(b) {}
+  unsigned int opcode(U* c) const
+  {
+    *c = m_b;
+    return TAPE_ADD_C;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -481,6 +717,11 @@ struct TTypeNameADD2<mpreal, N, V> : public UnTTypeNameHV<mpreal, N>
   TTypeNameADD2(TTypeNameHV<mpreal, N>* pOp1, const V& b) : UnTTypeNameHV<mpreal, N>(pOp1), m_b(b)
   {
   }
+  unsigned int opcode(mpreal* c) const
+  {
+    *c = m_b;
+    return TAPE_ADD_C;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -574,6 +815,7 @@ struct TTypeNameSUB : public BinTTypeNameHV<U, N>
   TTypeNameSUB(TTypeNameHV<U, N>* pOp1, TTypeNameHV<U, N>* pOp2) : BinTTypeNameHV<U, N>(pOp1, pOp2)
   {
   }
+  unsigned int opcode(U*) const { return TAPE_SUB; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -598,6 +840,7 @@ struct TTypeNameSUB<mpreal, N> : public BinTTypeNameHV<mpreal, N>
       : BinTTypeNameHV<mpreal, N>(pOp1, pOp2)
   {
   }
+  unsigned int opcode(mpreal*) const { return TAPE_SUB; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -622,6 +865,11 @@ struct TTypeNameSUB1 : public UnTTypeNameHV<U, N>
   {
   }
   TTypeNameSUB1(const V& a, TTypeNameHV<U, N>* pOp2) : UnTTypeNameHV<U, N>(pOp2), m_a(a) {}
+  unsigned int opcode(U* c) const
+  {
+    *c = m_a;
+    return TAPE_C_SUB;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -650,6 +898,11 @@ struct TTypeNameSUB1<mpreal, N, V> : public UnTTypeNameHV<mpreal, N>
   TTypeNameSUB1(const V& a, TTypeNameHV<mpreal, N>* pOp2) : UnTTypeNameHV<mpreal, N>(pOp2), m_a(a)
   {
   }
+  unsigned int opcode(mpreal* c) const
+  {
+    *c = m_a;
+    return TAPE_C_SUB;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -679,6 +932,11 @@ struct TTypeNameSUB2 : public UnTTypeNameHV<U, N>
   {
   }
   TTypeNameSUB2(TTypeNameHV<U, N>* pOp1, const V& b) : UnTTypeNameHV<U, N>(pOp1), m_b(b) {}
+  unsigned int opcode(U* c) const
+  {
+    *c = m_b;
+    return TAPE_SUB_C;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -707,6 +965,11 @@ struct TTypeNameSUB2<mpreal, N, V> : public UnTTypeNameHV<mpreal, N>
   TTypeNameSUB2(TTypeNameHV<mpreal, N>* pOp1, const V& b) : UnTTypeNameHV<mpreal, N>(pOp1), m_b(b)
   {
   }
+  unsigned int opcode(mpreal* c) const
+  {
+    *c = m_b;
+    return TAPE_SUB_C;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -800,9 +1063,15 @@ struct TTypeNameMUL : public BinTTypeNameHV<U, N>
   TTypeNameMUL(TTypeNameHV<U, N>* pOp1, TTypeNameHV<U, N>* pOp2) : BinTTypeNameHV<U, N>(pOp1, pOp2)
   {
   }
+  unsigned int opcode(U*) const { return TAPE_MUL; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
+    if (this->length() == 0 && tBulk(l))  // all at once (tseries.h)
+    {
+      this->bulkMul(this->op1(), this->op2(), l);
+      return this->length() = l;
+    }
     for (unsigned int i = this->length(); i < l; ++i)
     {
       this->val(i) = Op<U>::myZero();
@@ -827,9 +1096,15 @@ struct TTypeNameMUL<mpreal, N> : public BinTTypeNameHV<mpreal, N>
       : BinTTypeNameHV<mpreal, N>(pOp1, pOp2)
   {
   }
+  unsigned int opcode(mpreal*) const { return TAPE_MUL; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
+    if (this->length() == 0 && tBulk(l))  // all at once (tseries.h)
+    {
+      this->bulkMul(this->op1(), this->op2(), l);
+      return this->length() = l;
+    }
     for (unsigned int i = this->length(); i < l; ++i)
     {
       this->val(i) = 0;
@@ -856,6 +1131,11 @@ struct TTypeNameMUL1 : public UnTTypeNameHV<U, N>
   {
   }
   TTypeNameMUL1(const V& a, TTypeNameHV<U, N>* pOp2) : UnTTypeNameHV<U, N>(pOp2), m_a(a) {}
+  unsigned int opcode(U* c) const
+  {
+    *c = m_a;
+    return TAPE_MUL_C;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -879,6 +1159,11 @@ struct TTypeNameMUL1<mpreal, N, V> : public UnTTypeNameHV<mpreal, N>
   TTypeNameMUL1(const V& a, TTypeNameHV<mpreal, N>* pOp2) : UnTTypeNameHV<mpreal, N>(pOp2), m_a(a)
   {
   }
+  unsigned int opcode(mpreal* c) const
+  {
+    *c = m_a;
+    return TAPE_MUL_C;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -903,6 +1188,11 @@ struct TTypeNameMUL2 : public UnTTypeNameHV<U, N>
   {
   }
   TTypeNameMUL2(TTypeNameHV<U, N>* pOp1, const V& b) : UnTTypeNameHV<U, N>(pOp1), m_b(b) {}
+  unsigned int opcode(U* c) const
+  {
+    *c = m_b;
+    return TAPE_MUL_C;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -926,6 +1216,11 @@ struct TTypeNameMUL2<mpreal, N, V> : public UnTTypeNameHV<mpreal, N>
   TTypeNameMUL2(TTypeNameHV<mpreal, N>* pOp1, const V& b) : UnTTypeNameHV<mpreal, N>(pOp1), m_b(b)
   {
   }
+  unsigned int opcode(mpreal* c) const
+  {
+    *c = m_b;
+    return TAPE_MUL_C;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1016,6 +1311,7 @@ struct TTypeNameDIV : public BinTTypeNameHV<U, N>
   TTypeNameDIV(TTypeNameHV<U, N>* pOp1, TTypeNameHV<U, N>* pOp2) : BinTTypeNameHV<U, N>(pOp1, pOp2)
   {
   }
+  unsigned int opcode(U*) const { return TAPE_DIV; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -1045,6 +1341,7 @@ struct TTypeNameDIV<mpreal, N> : public BinTTypeNameHV<mpreal, N>
       : BinTTypeNameHV<mpreal, N>(pOp1, pOp2)
   {
   }
+  unsigned int opcode(mpreal*) const { return TAPE_DIV; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -1075,6 +1372,11 @@ struct TTypeNameDIV1 : public UnTTypeNameHV<U, N>
   {
   }
   TTypeNameDIV1(const V& a, TTypeNameHV<U, N>* pOp2) : UnTTypeNameHV<U, N>(pOp2), m_a(a) {}
+  unsigned int opcode(U* c) const
+  {
+    *c = m_a;
+    return TAPE_C_DIV;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1108,6 +1410,11 @@ struct TTypeNameDIV1<mpreal, N, V> : public UnTTypeNameHV<mpreal, N>
   TTypeNameDIV1(const V& a, TTypeNameHV<mpreal, N>* pOp2) : UnTTypeNameHV<mpreal, N>(pOp2), m_a(a)
   {
   }
+  unsigned int opcode(mpreal* c) const
+  {
+    *c = m_a;
+    return TAPE_C_DIV;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1144,6 +1451,11 @@ struct TTypeNameDIV2 : public UnTTypeNameHV<U, N>
   {
   }
   TTypeNameDIV2(TTypeNameHV<U, N>* pOp1, const V& b) : UnTTypeNameHV<U, N>(pOp1), m_b(b) {}
+  unsigned int opcode(U* c) const
+  {
+    *c = m_b;
+    return TAPE_DIV_C;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1167,6 +1479,11 @@ struct TTypeNameDIV2<mpreal, N, V> : public UnTTypeNameHV<mpreal, N>
   TTypeNameDIV2(TTypeNameHV<mpreal, N>* pOp1, const V& b) : UnTTypeNameHV<mpreal, N>(pOp1), m_b(b)
   {
   }
+  unsigned int opcode(mpreal* c) const
+  {
+    *c = m_b;
+    return TAPE_DIV_C;
+  }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1300,6 +1617,7 @@ struct TTypeNameUMINUS : public UnTTypeNameHV<U, N>
 {
   TTypeNameUMINUS(const U& val, TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(val, pOp) {}
   TTypeNameUMINUS(TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(pOp) {}
+  unsigned int opcode(U*) const { return TAPE_NEG; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1320,6 +1638,7 @@ struct TTypeNameUMINUS<mpreal, N> : public UnTTypeNameHV<mpreal, N>
   {
   }
   TTypeNameUMINUS(TTypeNameHV<mpreal, N>* pOp) : UnTTypeNameHV<mpreal, N>(pOp) {}
+  unsigned int opcode(mpreal*) const { return TAPE_NEG; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1366,6 +1685,7 @@ struct TTypeNameUPLUS : public UnTTypeNameHV<U, N>
 {
   TTypeNameUPLUS(const U& val, TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(val, pOp) {}
   TTypeNameUPLUS(TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(pOp) {}
+  unsigned int opcode(U*) const { return TAPE_POS; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1418,6 +1738,7 @@ struct TTypeNamePOW : public UnTTypeNameHV<U, N>
 {
   TTypeNamePOW(const U& val, TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(val, pOp) {}
   TTypeNamePOW(TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(pOp) {}
+  unsigned int opcode(U*) const { return TAPE_POW; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1437,6 +1758,7 @@ struct TTypeNamePOW<mpreal, N> : public UnTTypeNameHV<mpreal, N>
   {
   }
   TTypeNamePOW(TTypeNameHV<mpreal, N>* pOp) : UnTTypeNameHV<mpreal, N>(pOp) {}
+  unsigned int opcode(mpreal*) const { return TAPE_POW; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1455,6 +1777,7 @@ struct TTypeNamePOW1 : public UnTTypeNameHV<U, N>
 {
   TTypeNamePOW1(const U& val, TTypeNameHV<U, N>* pOp2) : UnTTypeNameHV<U, N>(val, pOp2) {}
   TTypeNamePOW1(TTypeNameHV<U, N>* pOp2) : UnTTypeNameHV<U, N>(pOp2) {}
+  unsigned int opcode(U*) const { return TAPE_C_POW; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1475,6 +1798,7 @@ struct TTypeNamePOW1<mpreal, N, V> : public UnTTypeNameHV<mpreal, N>
   {
   }
   TTypeNamePOW1(TTypeNameHV<mpreal, N>* pOp2) : UnTTypeNameHV<mpreal, N>(pOp2) {}
+  unsigned int opcode(mpreal*) const { return TAPE_C_POW; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1493,6 +1817,7 @@ struct TTypeNamePOW2 : public UnTTypeNameHV<U, N>
 {
   TTypeNamePOW2(const U& val, TTypeNameHV<U, N>* pOp1) : UnTTypeNameHV<U, N>(val, pOp1) {}
   TTypeNamePOW2(TTypeNameHV<U, N>* pOp1) : UnTTypeNameHV<U, N>(pOp1) {}
+  unsigned int opcode(U*) const { return TAPE_POW_C; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1513,6 +1838,7 @@ struct TTypeNamePOW2<mpreal, N, V> : public UnTTypeNameHV<mpreal, N>
   {
   }
   TTypeNamePOW2(TTypeNameHV<mpreal, N>* pOp1) : UnTTypeNameHV<mpreal, N>(pOp1) {}
+  unsigned int opcode(mpreal*) const { return TAPE_POW_C; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1659,9 +1985,15 @@ struct TTypeNameSQR : public UnTTypeNameHV<U, N>
 {
   TTypeNameSQR(const U& val, TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(val, pOp) {}
   TTypeNameSQR(TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(pOp) {}
+  unsigned int opcode(U*) const { return TAPE_SQR; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
+    if (this->length() == 0 && tBulk(l))  // all at once (tseries.h)
+    {
+      this->bulkMul(this->op(), this->op(), l);
+      return this->length() = l;
+    }
     if (0 == this->length())
     {
       this->val(0)   = Op<U>::mySqr(this->opVal(0));
@@ -1691,9 +2023,15 @@ struct TTypeNameSQR<mpreal, N> : public UnTTypeNameHV<mpreal, N>
   {
   }
   TTypeNameSQR(TTypeNameHV<mpreal, N>* pOp) : UnTTypeNameHV<mpreal, N>(pOp) {}
+  unsigned int opcode(mpreal*) const { return TAPE_SQR; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
+    if (this->length() == 0 && tBulk(l))  // all at once (tseries.h)
+    {
+      this->bulkMul(this->op(), this->op(), l);
+      return this->length() = l;
+    }
     if (0 == this->length())
     {
       Op<mpreal>::mpreal_sqr(this->val(0), this->opVal(0));
@@ -1756,6 +2094,7 @@ struct TTypeNameSQRT : public UnTTypeNameHV<U, N>
 {
   TTypeNameSQRT(const U& val, TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(val, pOp) {}
   TTypeNameSQRT(TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(pOp) {}
+  unsigned int opcode(U*) const { return TAPE_SQRT; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1789,6 +2128,7 @@ struct TTypeNameSQRT<mpreal, N> : public UnTTypeNameHV<mpreal, N>
   {
   }
   TTypeNameSQRT(TTypeNameHV<mpreal, N>* pOp) : UnTTypeNameHV<mpreal, N>(pOp) {}
+  unsigned int opcode(mpreal*) const { return TAPE_SQRT; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1857,6 +2197,7 @@ struct TTypeNameEXP : public UnTTypeNameHV<U, N>
 {
   TTypeNameEXP(const U& val, TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(val, pOp) {}
   TTypeNameEXP(TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(pOp) {}
+  unsigned int opcode(U*) const { return TAPE_EXP; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1886,6 +2227,7 @@ struct TTypeNameEXP<mpreal, N> : public UnTTypeNameHV<mpreal, N>
   {
   }
   TTypeNameEXP(TTypeNameHV<mpreal, N>* pOp) : UnTTypeNameHV<mpreal, N>(pOp) {}
+  unsigned int opcode(mpreal*) const { return TAPE_EXP; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1899,12 +2241,11 @@ struct TTypeNameEXP<mpreal, N> : public UnTTypeNameHV<mpreal, N>
       this->val(i) = 0;
       for (unsigned int j = 0; j < i; ++j)
       {
-        TEMP_RESULT = (double)j / (double)i;
-        Op<mpreal>::mpreal_sub(TEMP_RESULT1, 1, TEMP_RESULT);
-        Op<mpreal>::mpreal_mul(TEMP_RESULT, TEMP_RESULT1, this->opVal(i - j));
+        Op<mpreal>::mpreal_mul(TEMP_RESULT, double(i - j), this->opVal(i - j));
         Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT, this->val(j));
         Op<mpreal>::myCadd(this->val(i), TEMP_RESULT1);
       }
+      Op<mpreal>::myCdiv(this->val(i), i);
     }
     return this->length() = l;
   }
@@ -1946,6 +2287,7 @@ struct TTypeNameLOG : public UnTTypeNameHV<U, N>
 {
   TTypeNameLOG(const U& val, TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(val, pOp) {}
   TTypeNameLOG(TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(pOp) {}
+  unsigned int opcode(U*) const { return TAPE_LOG; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1976,6 +2318,7 @@ struct TTypeNameLOG<mpreal, N> : public UnTTypeNameHV<mpreal, N>
   {
   }
   TTypeNameLOG(TTypeNameHV<mpreal, N>* pOp) : UnTTypeNameHV<mpreal, N>(pOp) {}
+  unsigned int opcode(mpreal*) const { return TAPE_LOG; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
@@ -1986,16 +2329,16 @@ struct TTypeNameLOG<mpreal, N> : public UnTTypeNameHV<mpreal, N>
     }
     for (unsigned int i = this->length(); i < l; ++i)
     {
-      this->val(i) = this->opVal(i);
+      this->val(i) = 0;
       for (unsigned int j = 1; j < i; ++j)
       {
-        TEMP_RESULT = (double)j / (double)i;
-        Op<mpreal>::mpreal_sub(TEMP_RESULT1, 1, TEMP_RESULT);
-        Op<mpreal>::mpreal_mul(TEMP_RESULT, TEMP_RESULT1, this->opVal(j));
+        Op<mpreal>::mpreal_mul(TEMP_RESULT, double(i - j), this->opVal(j));
         Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT, this->val(i - j));
-        Op<mpreal>::myCsub(this->val(i), TEMP_RESULT1);
+        Op<mpreal>::myCadd(this->val(i), TEMP_RESULT1);
       }
-      Op<mpreal>::myCdiv(this->val(i), this->opVal(0));
+      Op<mpreal>::myCdiv(this->val(i), i);
+      Op<mpreal>::mpreal_sub(TEMP_RESULT, this->opVal(i), this->val(i));
+      Op<mpreal>::mpreal_div(this->val(i), TEMP_RESULT, this->opVal(0));
     }
     return this->length() = l;
   }
@@ -2034,37 +2377,37 @@ TTypeName<mpreal, N> log(const TTypeName<mpreal, N>& val)
 // SIN
 // SIN CLASS
 template <typename U, int N>
-struct TTypeNameSIN : public UnTTypeNameHV<U, N>
+struct TTypeNameSIN : public TrigTTypeNameHV<U, N>
 {
-  U m_COS[ N ];
-  TTypeNameSIN(const U& val, TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(val, pOp)
+  TTypeNameSIN(const U& val, const U& cosVal, TTypeNameHV<U, N>* pOp)
+      : TrigTTypeNameHV<U, N>(val, cosVal, pOp, true)
   {
-    m_COS[ 0 ] = Op<U>::myCos(this->opVal(0));
   }
-  TTypeNameSIN(TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(pOp) {}
+  TTypeNameSIN(TTypeNameHV<U, N>* pOp) : TrigTTypeNameHV<U, N>(pOp, true) {}
+  unsigned int opcode(U*) const { return TAPE_SIN; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
     if (0 == this->length())
     {
       this->val(0)   = Op<U>::mySin(this->opVal(0));
-      m_COS[ 0 ]     = Op<U>::myCos(this->opVal(0));
-      this->length() = 1;
+      this->other(0) = Op<U>::myCos(this->opVal(0));
+      this->setLength(1);
     }
     for (unsigned int i = this->length(); i < l; ++i)
     {
       this->val(i) = Op<U>::myZero();
       for (unsigned int j = 0; j < i; ++j)
         Op<U>::myCadd(this->val(i),
-                      Op<U>::myInteger(j + 1) * m_COS[ i - 1 - j ] * this->opVal(j + 1));
+                      Op<U>::myInteger(j + 1) * this->other(i - 1 - j) * this->opVal(j + 1));
       Op<U>::myCdiv(this->val(i), Op<U>::myInteger(i));
-      m_COS[ i ] = Op<U>::myZero();
+      this->other(i) = Op<U>::myZero();
       for (unsigned int j = 0; j < i; ++j)
-        Op<U>::myCsub(m_COS[ i ],
+        Op<U>::myCsub(this->other(i),
                       Op<U>::myInteger(j + 1) * this->val(i - 1 - j) * this->opVal(j + 1));
-      Op<U>::myCdiv(m_COS[ i ], Op<U>::myInteger(i));
+      Op<U>::myCdiv(this->other(i), Op<U>::myInteger(i));
     }
-    return this->length() = l;
+    return this->setLength(l);
   }
 
  private:
@@ -2072,43 +2415,42 @@ struct TTypeNameSIN : public UnTTypeNameHV<U, N>
 };
 // SPECIALIZED SIN CLASS
 template <int N>
-struct TTypeNameSIN<mpreal, N> : public UnTTypeNameHV<mpreal, N>
+struct TTypeNameSIN<mpreal, N> : public TrigTTypeNameHV<mpreal, N>
 {
-  mpreal m_COS[ N ];
-  TTypeNameSIN(const mpreal& val, TTypeNameHV<mpreal, N>* pOp) : UnTTypeNameHV<mpreal, N>(val, pOp)
+  TTypeNameSIN(const mpreal& val, const mpreal& cosVal, TTypeNameHV<mpreal, N>* pOp)
+      : TrigTTypeNameHV<mpreal, N>(val, cosVal, pOp, true)
   {
-    Op<mpreal>::mpreal_cos(m_COS[ 0 ], this->opVal(0));
   }
-  TTypeNameSIN(TTypeNameHV<mpreal, N>* pOp) : UnTTypeNameHV<mpreal, N>(pOp) {}
+  TTypeNameSIN(TTypeNameHV<mpreal, N>* pOp) : TrigTTypeNameHV<mpreal, N>(pOp, true) {}
+  unsigned int opcode(mpreal*) const { return TAPE_SIN; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
     if (0 == this->length())
     {
-      Op<mpreal>::mpreal_sin(this->val(0), this->opVal(0));
-      Op<mpreal>::mpreal_cos(m_COS[ 0 ], this->opVal(0));
-      this->length() = 1;
+      Op<mpreal>::mpreal_sin_cos(this->val(0), this->other(0), this->opVal(0));
+      this->setLength(1);
     }
     for (unsigned int i = this->length(); i < l; ++i)
     {
       this->val(i) = 0;
       for (unsigned int j = 0; j < i; ++j)
       {
-        Op<mpreal>::mpreal_mul(TEMP_RESULT, double(j + 1), m_COS[ i - 1 - j ]);
+        Op<mpreal>::mpreal_mul(TEMP_RESULT, double(j + 1), this->other(i - 1 - j));
         Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT, this->opVal(j + 1));
         Op<mpreal>::myCadd(this->val(i), TEMP_RESULT1);
       }
       Op<mpreal>::myCdiv(this->val(i), i);
-      m_COS[ i ] = 0;
+      this->other(i) = 0;
       for (unsigned int j = 0; j < i; ++j)
       {
         Op<mpreal>::mpreal_mul(TEMP_RESULT, double(j + 1), this->val(i - 1 - j));
         Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT, this->opVal(j + 1));
-        Op<mpreal>::myCsub(m_COS[ i ], TEMP_RESULT1);
+        Op<mpreal>::myCsub(this->other(i), TEMP_RESULT1);
       }
-      Op<mpreal>::myCdiv(m_COS[ i ], i);
+      Op<mpreal>::myCdiv(this->other(i), i);
     }
-    return this->length() = l;
+    return this->setLength(l);
   }
 
  private:
@@ -2120,7 +2462,8 @@ template <typename U, int N>
 TTypeName<U, N> sin(const TTypeName<U, N>& val)
 {
   TTypeNameHV<U, N>* pHV =
-      val.length() > 0 ? new TTypeNameSIN<U, N>(Op<U>::mySin(val.val()), val.getTTypeNameHV())
+      val.length() > 0 ? new TTypeNameSIN<U, N>(Op<U>::mySin(val.val()), Op<U>::myCos(val.val()),
+                                                val.getTTypeNameHV())
                        : new TTypeNameSIN<U, N>(val.getTTypeNameHV());
   return TTypeName<U, N>(pHV);
 }
@@ -2131,8 +2474,8 @@ TTypeName<mpreal, N> sin(const TTypeName<mpreal, N>& val)
   TTypeNameHV<mpreal, N>* pHV = NULL;
   if (val.length() > 0)
   {
-    Op<mpreal>::mpreal_sin(TEMP_RESULT, val.val());
-    pHV = new TTypeNameSIN<mpreal, N>(TEMP_RESULT, val.getTTypeNameHV());
+    Op<mpreal>::mpreal_sin_cos(TEMP_RESULT, TEMP_RESULT1, val.val());
+    pHV = new TTypeNameSIN<mpreal, N>(TEMP_RESULT, TEMP_RESULT1, val.getTTypeNameHV());
   }
   else
   {
@@ -2144,37 +2487,37 @@ TTypeName<mpreal, N> sin(const TTypeName<mpreal, N>& val)
 // COS
 // COS CLASS
 template <typename U, int N>
-struct TTypeNameCOS : public UnTTypeNameHV<U, N>
+struct TTypeNameCOS : public TrigTTypeNameHV<U, N>
 {
-  U m_SIN[ N ];
-  TTypeNameCOS(const U& val, TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(val, pOp)
+  TTypeNameCOS(const U& val, const U& sinVal, TTypeNameHV<U, N>* pOp)
+      : TrigTTypeNameHV<U, N>(val, sinVal, pOp, false)
   {
-    m_SIN[ 0 ] = Op<U>::mySin(this->opVal(0));
   }
-  TTypeNameCOS(TTypeNameHV<U, N>* pOp) : UnTTypeNameHV<U, N>(pOp) {}
+  TTypeNameCOS(TTypeNameHV<U, N>* pOp) : TrigTTypeNameHV<U, N>(pOp, false) {}
+  unsigned int opcode(U*) const { return TAPE_COS; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
     if (0 == this->length())
     {
       this->val(0)   = Op<U>::myCos(this->opVal(0));
-      m_SIN[ 0 ]     = Op<U>::mySin(this->opVal(0));
-      this->length() = 1;
+      this->other(0) = Op<U>::mySin(this->opVal(0));
+      this->setLength(1);
     }
     for (unsigned int i = this->length(); i < l; ++i)
     {
       this->val(i) = Op<U>::myZero();
       for (unsigned int j = 0; j < i; ++j)
         Op<U>::myCsub(this->val(i),
-                      Op<U>::myInteger(j + 1) * m_SIN[ i - 1 - j ] * this->opVal(j + 1));
+                      Op<U>::myInteger(j + 1) * this->other(i - 1 - j) * this->opVal(j + 1));
       Op<U>::myCdiv(this->val(i), Op<U>::myInteger(i));
-      m_SIN[ i ] = Op<U>::myZero();
+      this->other(i) = Op<U>::myZero();
       for (unsigned int j = 0; j < i; ++j)
-        Op<U>::myCadd(m_SIN[ i ],
+        Op<U>::myCadd(this->other(i),
                       Op<U>::myInteger(j + 1) * this->val(i - 1 - j) * this->opVal(j + 1));
-      Op<U>::myCdiv(m_SIN[ i ], Op<U>::myInteger(i));
+      Op<U>::myCdiv(this->other(i), Op<U>::myInteger(i));
     }
-    return this->length() = l;
+    return this->setLength(l);
   }
 
  private:
@@ -2182,43 +2525,42 @@ struct TTypeNameCOS : public UnTTypeNameHV<U, N>
 };
 // SPECIALIZED COS CLASS
 template <int N>
-struct TTypeNameCOS<mpreal, N> : public UnTTypeNameHV<mpreal, N>
+struct TTypeNameCOS<mpreal, N> : public TrigTTypeNameHV<mpreal, N>
 {
-  mpreal m_SIN[ N ];
-  TTypeNameCOS(const mpreal& val, TTypeNameHV<mpreal, N>* pOp) : UnTTypeNameHV<mpreal, N>(val, pOp)
+  TTypeNameCOS(const mpreal& val, const mpreal& sinVal, TTypeNameHV<mpreal, N>* pOp)
+      : TrigTTypeNameHV<mpreal, N>(val, sinVal, pOp, false)
   {
-    Op<mpreal>::mpreal_sin(m_SIN[ 0 ], this->opVal(0));
   }
-  TTypeNameCOS(TTypeNameHV<mpreal, N>* pOp) : UnTTypeNameHV<mpreal, N>(pOp) {}
+  TTypeNameCOS(TTypeNameHV<mpreal, N>* pOp) : TrigTTypeNameHV<mpreal, N>(pOp, false) {}
+  unsigned int opcode(mpreal*) const { return TAPE_COS; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = this->opEval(k);
     if (0 == this->length())
     {
-      Op<mpreal>::mpreal_cos(this->val(0), this->opVal(0));
-      Op<mpreal>::mpreal_sin(m_SIN[ 0 ], this->opVal(0));
-      this->length() = 1;
+      Op<mpreal>::mpreal_sin_cos(this->other(0), this->val(0), this->opVal(0));
+      this->setLength(1);
     }
     for (unsigned int i = this->length(); i < l; ++i)
     {
       this->val(i) = 0;
       for (unsigned int j = 0; j < i; ++j)
       {
-        Op<mpreal>::mpreal_mul(TEMP_RESULT, double(j + 1), m_SIN[ i - 1 - j ]);
+        Op<mpreal>::mpreal_mul(TEMP_RESULT, double(j + 1), this->other(i - 1 - j));
         Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT, this->opVal(j + 1));
         Op<mpreal>::myCsub(this->val(i), TEMP_RESULT1);
       }
       Op<mpreal>::myCdiv(this->val(i), i);
-      m_SIN[ i ] = 0;
+      this->other(i) = 0;
       for (unsigned int j = 0; j < i; ++j)
       {
         Op<mpreal>::mpreal_mul(TEMP_RESULT, double(j + 1), this->val(i - 1 - j));
         Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT, this->opVal(j + 1));
-        Op<mpreal>::myCadd(m_SIN[ i ], TEMP_RESULT1);
+        Op<mpreal>::myCadd(this->other(i), TEMP_RESULT1);
       }
-      Op<mpreal>::myCdiv(m_SIN[ i ], i);
+      Op<mpreal>::myCdiv(this->other(i), i);
     }
-    return this->length() = l;
+    return this->setLength(l);
   }
 
  private:
@@ -2230,7 +2572,8 @@ template <typename U, int N>
 TTypeName<U, N> cos(const TTypeName<U, N>& val)
 {
   TTypeNameHV<U, N>* pHV =
-      val.length() > 0 ? new TTypeNameCOS<U, N>(Op<U>::myCos(val.val()), val.getTTypeNameHV())
+      val.length() > 0 ? new TTypeNameCOS<U, N>(Op<U>::myCos(val.val()), Op<U>::mySin(val.val()),
+                                                val.getTTypeNameHV())
                        : new TTypeNameCOS<U, N>(val.getTTypeNameHV());
   return TTypeName<U, N>(pHV);
 }
@@ -2241,8 +2584,8 @@ TTypeName<mpreal, N> cos(const TTypeName<mpreal, N>& val)
   TTypeNameHV<mpreal, N>* pHV = NULL;
   if (val.length() > 0)
   {
-    Op<mpreal>::mpreal_cos(TEMP_RESULT, val.val());
-    pHV = new TTypeNameCOS<mpreal, N>(TEMP_RESULT, val.getTTypeNameHV());
+    Op<mpreal>::mpreal_sin_cos(TEMP_RESULT1, TEMP_RESULT, val.val());
+    pHV = new TTypeNameCOS<mpreal, N>(TEMP_RESULT, TEMP_RESULT1, val.getTTypeNameHV());
   }
   else
   {
@@ -2264,6 +2607,7 @@ struct TTypeNameTAN : public BinTTypeNameHV<U, N>
       : BinTTypeNameHV<U, N>(pOp, pSqrCos)
   {
   }
+  unsigned int opcode(U*) const { return TAPE_TAN; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -2297,6 +2641,7 @@ struct TTypeNameTAN<mpreal, N> : public BinTTypeNameHV<mpreal, N>
       : BinTTypeNameHV<mpreal, N>(pOp, pSqrCos)
   {
   }
+  unsigned int opcode(mpreal*) const { return TAPE_TAN; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -2366,6 +2711,7 @@ struct TTypeNameASIN : public BinTTypeNameHV<U, N>
   TTypeNameASIN(TTypeNameHV<U, N>* pOp, TTypeNameHV<U, N>* pSqrt) : BinTTypeNameHV<U, N>(pOp, pSqrt)
   {
   }
+  unsigned int opcode(U*) const { return TAPE_ASIN; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -2399,6 +2745,7 @@ struct TTypeNameASIN<mpreal, N> : public BinTTypeNameHV<mpreal, N>
       : BinTTypeNameHV<mpreal, N>(pOp, pSqrt)
   {
   }
+  unsigned int opcode(mpreal*) const { return TAPE_ASIN; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -2468,6 +2815,7 @@ struct TTypeNameACOS : public BinTTypeNameHV<U, N>
   TTypeNameACOS(TTypeNameHV<U, N>* pOp, TTypeNameHV<U, N>* pSqrt) : BinTTypeNameHV<U, N>(pOp, pSqrt)
   {
   }
+  unsigned int opcode(U*) const { return TAPE_ACOS; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -2502,6 +2850,7 @@ struct TTypeNameACOS<mpreal, N> : public BinTTypeNameHV<mpreal, N>
       : BinTTypeNameHV<mpreal, N>(pOp, pSqrt)
   {
   }
+  unsigned int opcode(mpreal*) const { return TAPE_ACOS; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -2573,6 +2922,7 @@ struct TTypeNameATAN : public BinTTypeNameHV<U, N>
       : BinTTypeNameHV<U, N>(pOp, p1pSqr)
   {
   }
+  unsigned int opcode(U*) const { return TAPE_ATAN; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -2606,6 +2956,7 @@ struct TTypeNameATAN<mpreal, N> : public BinTTypeNameHV<mpreal, N>
       : BinTTypeNameHV<mpreal, N>(pOp, p1pSqr)
   {
   }
+  unsigned int opcode(mpreal*) const { return TAPE_ATAN; }
   unsigned int eval(const unsigned int k)
   {
     unsigned int l = std::min(this->op1Eval(k), this->op2Eval(k));
@@ -2671,6 +3022,11 @@ struct DIFF : public UnTTypeNameHV<U, N>
   int m_b;
   DIFF(const U& val, TTypeNameHV<U, N>* pOp, const int b) : UnTTypeNameHV<U, N>(val, pOp), m_b(b) {}
   DIFF(TTypeNameHV<U, N>* pOp, const int b) : UnTTypeNameHV<U, N>(pOp), m_b(b) {}
+  unsigned int opcode(U* c) const
+  {
+    *c = m_b;
+    return TAPE_DIFF;
+  }
   unsigned int eval(const unsigned int k)
   {
     // IN ORDER TO COMPUTE i'th ORDER COEFFICIENTS OF diff(m_o1,b)
@@ -2688,7 +3044,7 @@ struct DIFF : public UnTTypeNameHV<U, N>
         {
           fact *= j;
         }
-        this->val(i) = this->opVal(i + m_b) * fact;
+        this->val(i) = this->opVal(i + m_b) * Op<U>::myInteger(fact);
       }
       this->length() = l - m_b;
     }
@@ -2708,6 +3064,11 @@ struct DIFF<mpreal, N> : public UnTTypeNameHV<mpreal, N>
   {
   }
   DIFF(TTypeNameHV<mpreal, N>* pOp, const int b) : UnTTypeNameHV<mpreal, N>(pOp), m_b(b) {}
+  unsigned int opcode(mpreal* c) const
+  {
+    *c = m_b;
+    return TAPE_DIFF;
+  }
   unsigned int eval(const unsigned int k)
   {
     // IN ORDER TO COMPUTE i'th ORDER COEFFICIENTS OF diff(m_o1,b)
@@ -0,0 +1,423 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _TAPESPILL_H
+#define _TAPESPILL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "btape.h"
+
+namespace fadbad
+{
+
+// Out-of-core store of a compact tape (btape.h). Once more than 'resident'
+// segments are in memory, the least recently used complete segment is
+// written to a file and its memory released; a segment that is needed
+// again is read back. All file I/O is done by a background thread: the
+// recording only queues the segments it evicts, and the reverse sweep asks
+// for the two segments below the one it enters so that they are usually
+// read in while it works on the current one. The adjoints live in the
+// records, so a segment is written again when it leaves memory after a
+// sweep. Each segment has its own extent in the file, sized by the bound of
+// TapeIO on its records, and is written again in place; only a segment
+// whose values have gained precision moves to a new extent. The file thus
+// stays at the size of the tape over any number of sweeps, and is truncated
+// when the tape is cleared.
+//
+// I/O errors are reported by ok(), like the files of graphio.h. If the file
+// cannot be opened, the store is not attached and the tape stays in memory.
+// A segment that cannot be written stays in memory too, and no more
+// segments are evicted. A segment that cannot be read back has lost its
+// records, so the results of the tape are invalid once ok() is false.
+//
+// A reference to a record stays valid until 'resident' - 2 other segments
+// have been accessed, hence resident >= 4 (propagate touches the record and
+// two operands). Destroying the store clears the tape.
+//
+//   Tape<double>      tape;
+//   TapeSpill<double> spill(tape, "/scratch/tape.bin", 64);
+//   ... record with BC<double>, diff(), ...
+template <typename U, typename A = U>
+class TapeSpill : public TapeStore<U, A>
+{
+ public:
+  typedef typename Tape<U, A>::Node Node;
+
+ private:
+  enum State
+  {
+    RESIDENT,
+    WRITE_QUEUED,
+    WRITING,
+    ON_DISK,
+    LOAD_QUEUED,
+    LOADING,
+    LOADED
+  };
+  struct Job
+  {
+    bool         m_write;
+    unsigned int m_s;
+  };
+
+  Tape<U, A>&                m_tape;
+  std::FILE*                 m_file;
+  const char*                m_path;
+  long                       m_end;       // end of the last extent of the file
+  unsigned int               m_resident;  // segments kept in memory
+  unsigned long              m_clock;
+  std::vector<unsigned long> m_stamp;     // last access of a segment
+  std::vector<State>         m_state;
+  std::vector<long>          m_offset;    // extent of a segment in the file, or -1
+  std::vector<long>          m_extent;    // and its size
+  std::vector<Node*>         m_buffer;    // segments owned by the I/O thread
+  std::deque<Job>            m_queue;
+  mutable std::mutex         m_mutex;
+  std::condition_variable    m_cv;
+  bool                       m_stop;
+  bool                       m_failed;
+  std::thread                m_worker;
+
+  TapeSpill(const TapeSpill<U, A>&) { /*illegal*/}
+  void operator=(const TapeSpill<U, A>&) { /*illegal*/}
+
+  std::vector<Node*>& segments() { return TapeStore<U, A>::segments(m_tape); }
+
+  void grow(const unsigned int s)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stamp.resize(s + 1, 0);
+    m_state.resize(s + 1, RESIDENT);
+    m_offset.resize(s + 1, -1);
+    m_extent.resize(s + 1, 0);
+    m_buffer.resize(s + 1, 0);
+  }
+
+  // Hand the least recently used segments to the I/O thread until at most
+  // m_resident are left. Only complete segments leave; the segment just
+  // accessed stays too. Called with m_mutex held.
+  void evict(const unsigned int keep)
+  {
+    std::vector<Node*>& seg(segments());
+    const unsigned int  size = m_tape.size();
+    const unsigned int  last = size == 0 ? 0 : (size - 1) / Tape<U, A>::SEGMENT;
+    while (!m_failed)
+    {
+      unsigned int n = 0, lru = 0;
+      bool         found = false;
+      for (unsigned int s = 0; s < seg.size() && s <= last + 1; ++s)
+      {
+        if (seg[ s ] == 0)
+          continue;
+        ++n;
+        if (s == keep || s >= last || s >= m_stamp.size())
+          continue;
+        if (!found || m_stamp[ s ] < m_stamp[ lru ])
+        {
+          lru   = s;
+          found = true;
+        }
+      }
+      if (n <= m_resident || !found)
+        return;
+      m_buffer[ lru ] = seg[ lru ];
+      seg[ lru ]      = 0;
+      m_state[ lru ]  = WRITE_QUEUED;
+      Job job         = {true, lru};
+      m_queue.push_back(job);
+      m_cv.notify_all();
+    }
+  }
+
+  // Bring segment s back into memory, from the write queue, from the
+  // prefetched buffers or from the file.
+  Node* fetch(const unsigned int s)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_state[ s ] == WRITE_QUEUED)
+    {
+      for (typename std::deque<Job>::iterator i = m_queue.begin(); i != m_queue.end(); ++i)
+        if (i->m_s == s)
+        {
+          m_queue.erase(i);
+          break;
+        }
+    }
+    else
+    {
+      while (m_state[ s ] == WRITING)
+        m_cv.wait(lock);
+      if (m_state[ s ] == LOAD_QUEUED)
+      {
+        for (typename std::deque<Job>::iterator i = m_queue.begin(); i != m_queue.end(); ++i)
+          if (i->m_s == s)
+          {
+            m_queue.erase(i);
+            break;
+          }
+        m_state[ s ] = ON_DISK;
+      }
+      if (m_state[ s ] == ON_DISK)
+      {
+        m_state[ s ] = LOAD_QUEUED;
+        Job job      = {false, s};
+        m_queue.push_front(job);
+        m_cv.notify_all();
+      }
+      while (m_state[ s ] != LOADED)
+        m_cv.wait(lock);
+    }
+    Node* p         = m_buffer[ s ];
+    m_buffer[ s ]   = 0;
+    m_state[ s ]    = RESIDENT;
+    segments()[ s ] = p;
+    m_stamp[ s ]    = ++m_clock;
+    evict(s);
+    return p;
+  }
+
+  static long bound(const Node* p)
+  {
+    std::size_t n = 0;
+    for (unsigned int i = 0; i < Tape<U, A>::SEGMENT; ++i)
+      n += 3 * sizeof(unsigned int) + TapeIO<U>::bound(p[ i ].m_val) +
+           TapeIO<A>::bound(p[ i ].m_adj);
+    return (long)n;
+  }
+
+  bool write(Node* p, const long offset)
+  {
+    bool ok = std::fseek(m_file, offset, SEEK_SET) == 0;
+    for (unsigned int i = 0; ok && i < Tape<U, A>::SEGMENT; ++i)
+    {
+      unsigned int r[ 3 ] = {p[ i ].m_op, p[ i ].m_a, p[ i ].m_b};
+      ok = std::fwrite(r, sizeof(r), 1, m_file) == 1 && TapeIO<U>::write(m_file, p[ i ].m_val) &&
+           TapeIO<A>::write(m_file, p[ i ].m_adj);
+    }
+    return ok;
+  }
+
+  bool read(Node* p, const long offset)
+  {
+    bool ok = std::fseek(m_file, offset, SEEK_SET) == 0;
+    for (unsigned int i = 0; ok && i < Tape<U, A>::SEGMENT; ++i)
+    {
+      unsigned int r[ 3 ];
+      ok = std::fread(r, sizeof(r), 1, m_file) == 1 && TapeIO<U>::read(m_file, p[ i ].m_val) &&
+           TapeIO<A>::read(m_file, p[ i ].m_adj);
+      p[ i ].m_op = r[ 0 ];
+      p[ i ].m_a  = r[ 1 ];
+      p[ i ].m_b  = r[ 2 ];
+    }
+    return ok;
+  }
+
+  static Node* allocate()
+  {
+    Node* p = static_cast<Node*>(::operator new(Tape<U, A>::SEGMENT * sizeof(Node)));
+    for (unsigned int i = 0; i < Tape<U, A>::SEGMENT; ++i)
+      new (p + i) Node();
+    return p;
+  }
+
+  static void release(Node* p)
+  {
+    for (unsigned int i = 0; i < Tape<U, A>::SEGMENT; ++i)
+      p[ i ].~Node();
+    ::operator delete(p);
+  }
+
+  // The I/O thread: writes the evicted segments and reads the requested
+  // ones, without holding the lock while it works on the file.
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+      while (!m_stop && m_queue.empty())
+        m_cv.wait(lock);
+      if (m_stop)
+        return;
+      const Job job(m_queue.front());
+      m_queue.pop_front();
+      const unsigned int s = job.m_s;
+      bool               ok;
+      if (job.m_write)
+      {
+        m_state[ s ]      = WRITING;
+        Node*      p      = m_buffer[ s ];
+        const long extent = bound(p);
+        if (m_offset[ s ] < 0 || extent > m_extent[ s ])
+        {
+          m_offset[ s ] = m_end;
+          m_extent[ s ] = extent;
+          m_end += extent;
+        }
+        const long offset = m_offset[ s ];
+        lock.unlock();
+        ok = write(p, offset);
+        if (ok)
+          release(p);
+        lock.lock();
+        if (ok)
+        {
+          m_buffer[ s ] = 0;
+          m_state[ s ]  = ON_DISK;
+        }
+        else
+        {
+          m_offset[ s ] = -1;  // the extent may be incomplete
+          m_state[ s ]  = LOADED;  // still in m_buffer, taken back by fetch
+        }
+      }
+      else
+      {
+        m_state[ s ]      = LOADING;
+        const long offset = m_offset[ s ];
+        lock.unlock();
+        Node* p = allocate();
+        ok      = read(p, offset);
+        lock.lock();
+        m_buffer[ s ] = p;
+        m_state[ s ]  = LOADED;
+      }
+      m_failed = m_failed || !ok;
+      m_cv.notify_all();
+    }
+  }
+
+ public:
+  TapeSpill(Tape<U, A>& tape, const char* path = 0, const unsigned int resident = 16)
+      : m_tape(tape),
+        m_file(path == 0 ? std::tmpfile() : std::fopen(path, "w+b")),
+        m_path(path),
+        m_end(0),
+        m_resident(std::max(resident, 4u)),
+        m_clock(0),
+        m_stop(false),
+        m_failed(false)
+  {
+    USER_ASSERT(tape.size() == 0, "The tape must be empty when the store is attached")
+    m_failed = m_file == 0;
+    if (m_failed)
+      return;
+    m_tape.attach(this);
+    m_worker = std::thread(&TapeSpill<U, A>::run, this);
+  }
+  ~TapeSpill()
+  {
+    if (m_file == 0)
+      return;
+    m_tape.clear();
+    m_tape.attach(0);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_cv.notify_all();
+    m_worker.join();
+    std::fclose(m_file);
+    if (m_path != 0)
+      std::remove(m_path);
+  }
+  // False after the file could not be opened, written or read:
+  bool ok() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_failed;
+  }
+  // Bytes of the file taken by the extents of the segments:
+  long fileSize() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_end;
+  }
+
+  Node* touch(const unsigned int s)
+  {
+    if (s >= m_stamp.size())
+      grow(s);
+    Node* p = segments()[ s ];
+    if (p == 0)
+      return fetch(s);
+    m_stamp[ s ] = ++m_clock;
+    return p;
+  }
+  void sealed(const unsigned int s)
+  {
+    if (s + 1 >= m_stamp.size())
+      grow(s + 1);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stamp[ s + 1 ] = ++m_clock;
+    evict(s + 1);
+  }
+  void sweeping(const unsigned int s)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (unsigned int k = s; k-- > 0 && k + 2 >= s;)
+      if (k < m_state.size() && m_state[ k ] == ON_DISK)
+      {
+        m_state[ k ] = LOAD_QUEUED;
+        Job job      = {false, k};
+        m_queue.push_back(job);
+      }
+    m_cv.notify_all();
+  }
+  // Drop the queued work and every segment held outside the tape, and
+  // truncate the file. The resident segments are destroyed by the tape,
+  // which allocates the others again when it needs them.
+  void clear()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queue.clear();
+    for (unsigned int s = 0; s < m_state.size(); ++s)
+      while (m_state[ s ] == WRITING || m_state[ s ] == LOADING)
+        m_cv.wait(lock);
+    for (unsigned int s = 0; s < m_state.size(); ++s)
+    {
+      if (m_buffer[ s ] != 0)  // complete segments, queued or read in
+        release(m_buffer[ s ]);
+      m_buffer[ s ] = 0;
+      m_state[ s ]  = RESIDENT;
+      m_offset[ s ] = -1;
+    }
+    m_end = 0;
+  }
+};
+
+}  // namespace fadbad
+
+#endif
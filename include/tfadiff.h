@@ -0,0 +1,516 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _TFADIFF_H
+#define _TFADIFF_H
+
+#include "tkernel.h"
+
+namespace fadbad
+{
+// An eager truncated Taylor series. The coefficients 0..K-1 of a value are
+// held inline and each operation computes all of them at once with the
+// recurrences of T (tkernel.h, including its in-place mpreal versions), so
+// nothing is recorded and nothing is left to evaluate:
+//
+//   TF<double, 10> x(x0), y;
+//   x[ 1 ] = 1;
+//   y = f(x);
+//   ... y[ i ] ...
+//
+// This suits short expressions of a known order evaluated many times, where
+// allocating and walking a T graph costs more than the arithmetic. In
+// exchange, every operation computes all K coefficients, and expanding at
+// another point or to a higher order means evaluating f again.
+template <typename U, int K>
+class TFTypeName  // STACK-BASED     General Template
+{
+  U m_val[ K ];
+
+ public:
+  typedef U UnderlyingType;
+  TFTypeName()
+  {
+    for (int i    = 0; i < K; ++i)
+      m_val[ i ] = Op<U>::myZero();
+  }
+  template <class V> /*explicit*/ TFTypeName(const V& val)
+  {
+    m_val[ 0 ] = val;
+    for (int i    = 1; i < K; ++i)
+      m_val[ i ] = Op<U>::myZero();
+  }
+  template <class V>
+  TFTypeName<U, K>& operator=(const V& val)
+  {
+    m_val[ 0 ] = val;
+    for (int i    = 1; i < K; ++i)
+      m_val[ i ] = Op<U>::myZero();
+    return *this;
+  }
+  unsigned int length() const { return K; }
+  const U& operator[](const unsigned int i) const
+  {
+    USER_ASSERT(i < K, "Index " << i << " out of bounds [0," << K << "]")
+    return m_val[ i ];
+  }
+  U& operator[](const unsigned int i)
+  {
+    USER_ASSERT(i < K, "Index " << i << " out of bounds [0," << K << "]")
+    return m_val[ i ];
+  }
+  const U& val() const { return m_val[ 0 ]; }
+  U&       x() { return m_val[ 0 ]; }
+  TFTypeName<U, K>& operator+=(const TFTypeName<U, K>& val);
+  TFTypeName<U, K>& operator-=(const TFTypeName<U, K>& val);
+  TFTypeName<U, K>& operator*=(const TFTypeName<U, K>& val);
+  TFTypeName<U, K>& operator/=(const TFTypeName<U, K>& val);
+  template <typename V>
+  TFTypeName<U, K>& operator+=(const V& val);
+  template <typename V>
+  TFTypeName<U, K>& operator-=(const V& val);
+  template <typename V>
+  TFTypeName<U, K>& operator*=(const V& val);
+  template <typename V>
+  TFTypeName<U, K>& operator/=(const V& val);
+};
+
+// All K coefficients of op(a, b) for the op codes of TKernel; c is the
+// constant of the _C ops and is ignored by the others.
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> tfRun(const unsigned int op,
+                               const typename TFTypeName<U, K>::UnderlyingType& c,
+                               const TFTypeName<U, K>& a, const TFTypeName<U, K>& b)
+{
+  TFTypeName<U, K> v;
+  TKernel<U>::run(op, c, 0, &a[ 0 ], &b[ 0 ], &v[ 0 ], &v[ 0 ], 0, K);
+  return v;
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> tfRun(const unsigned int op, const TFTypeName<U, K>& a,
+                               const TFTypeName<U, K>& b)
+{
+  return tfRun(op, a[ 0 ], a, b);
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> tfRun(const unsigned int op, const TFTypeName<U, K>& a)
+{
+  return tfRun(op, a[ 0 ], a, a);
+}
+
+// The elementwise ops run in place, the convolutions into a temporary.
+template <typename U, int K>
+INLINE2 TFTypeName<U, K>& TFTypeName<U, K>::operator+=(const TFTypeName<U, K>& val)
+{
+  TKernel<U>::run(TAPE_ADD, m_val[ 0 ], 0, m_val, &val[ 0 ], m_val, m_val, 0, K);
+  return *this;
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K>& TFTypeName<U, K>::operator-=(const TFTypeName<U, K>& val)
+{
+  TKernel<U>::run(TAPE_SUB, m_val[ 0 ], 0, m_val, &val[ 0 ], m_val, m_val, 0, K);
+  return *this;
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K>& TFTypeName<U, K>::operator*=(const TFTypeName<U, K>& val)
+{
+  return *this = tfRun(TAPE_MUL, *this, val);
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K>& TFTypeName<U, K>::operator/=(const TFTypeName<U, K>& val)
+{
+  return *this = tfRun(TAPE_DIV, *this, val);
+}
+template <typename U, int K>
+template <typename V>
+INLINE2 TFTypeName<U, K>& TFTypeName<U, K>::operator+=(const V& val)
+{
+  const U& c = val;
+  TKernel<U>::run(TAPE_ADD_C, c, 0, m_val, m_val, m_val, m_val, 0, K);
+  return *this;
+}
+template <typename U, int K>
+template <typename V>
+INLINE2 TFTypeName<U, K>& TFTypeName<U, K>::operator-=(const V& val)
+{
+  const U& c = val;
+  TKernel<U>::run(TAPE_SUB_C, c, 0, m_val, m_val, m_val, m_val, 0, K);
+  return *this;
+}
+template <typename U, int K>
+template <typename V>
+INLINE2 TFTypeName<U, K>& TFTypeName<U, K>::operator*=(const V& val)
+{
+  const U& c = val;
+  TKernel<U>::run(TAPE_MUL_C, c, 0, m_val, m_val, m_val, m_val, 0, K);
+  return *this;
+}
+template <typename U, int K>
+template <typename V>
+INLINE2 TFTypeName<U, K>& TFTypeName<U, K>::operator/=(const V& val)
+{
+  const U& c = val;
+  TKernel<U>::run(TAPE_DIV_C, c, 0, m_val, m_val, m_val, m_val, 0, K);
+  return *this;
+}
+
+//operations-----------------------------------------------------------------
+// Comparisons are on the values
+template <typename U, int K>
+bool operator==(const TFTypeName<U, K>& val1, const TFTypeName<U, K>& val2)
+{
+  return Op<U>::myEq(val1.val(), val2.val());
+}
+template <typename U, int K>
+bool operator!=(const TFTypeName<U, K>& val1, const TFTypeName<U, K>& val2)
+{
+  return Op<U>::myNe(val1.val(), val2.val());
+}
+template <typename U, int K>
+bool operator<(const TFTypeName<U, K>& val1, const TFTypeName<U, K>& val2)
+{
+  return Op<U>::myLt(val1.val(), val2.val());
+}
+template <typename U, int K>
+bool operator<=(const TFTypeName<U, K>& val1, const TFTypeName<U, K>& val2)
+{
+  return Op<U>::myLe(val1.val(), val2.val());
+}
+template <typename U, int K>
+bool operator>(const TFTypeName<U, K>& val1, const TFTypeName<U, K>& val2)
+{
+  return Op<U>::myGt(val1.val(), val2.val());
+}
+template <typename U, int K>
+bool operator>=(const TFTypeName<U, K>& val1, const TFTypeName<U, K>& val2)
+{
+  return Op<U>::myGe(val1.val(), val2.val());
+}
+template <typename U, int K, typename V>
+bool operator==(const TFTypeName<U, K>& val1, const V& val2)
+{
+  return Op<U>::myEq(val1.val(), val2);
+}
+template <typename U, int K, typename V>
+bool operator==(const V& val1, const TFTypeName<U, K>& val2)
+{
+  return Op<U>::myEq(val1, val2.val());
+}
+template <typename U, int K, typename V>
+bool operator!=(const TFTypeName<U, K>& val1, const V& val2)
+{
+  return Op<U>::myNe(val1.val(), val2);
+}
+template <typename U, int K, typename V>
+bool operator!=(const V& val1, const TFTypeName<U, K>& val2)
+{
+  return Op<U>::myNe(val1, val2.val());
+}
+template <typename U, int K, typename V>
+bool operator<(const TFTypeName<U, K>& val1, const V& val2)
+{
+  return Op<U>::myLt(val1.val(), val2);
+}
+template <typename U, int K, typename V>
+bool operator<(const V& val1, const TFTypeName<U, K>& val2)
+{
+  return Op<U>::myLt(val1, val2.val());
+}
+template <typename U, int K, typename V>
+bool operator<=(const TFTypeName<U, K>& val1, const V& val2)
+{
+  return Op<U>::myLe(val1.val(), val2);
+}
+template <typename U, int K, typename V>
+bool operator<=(const V& val1, const TFTypeName<U, K>& val2)
+{
+  return Op<U>::myLe(val1, val2.val());
+}
+template <typename U, int K, typename V>
+bool operator>(const TFTypeName<U, K>& val1, const V& val2)
+{
+  return Op<U>::myGt(val1.val(), val2);
+}
+template <typename U, int K, typename V>
+bool operator>(const V& val1, const TFTypeName<U, K>& val2)
+{
+  return Op<U>::myGt(val1, val2.val());
+}
+template <typename U, int K, typename V>
+bool operator>=(const TFTypeName<U, K>& val1, const V& val2)
+{
+  return Op<U>::myGe(val1.val(), val2);
+}
+template <typename U, int K, typename V>
+bool operator>=(const V& val1, const TFTypeName<U, K>& val2)
+{
+  return Op<U>::myGe(val1, val2.val());
+}
+
+// Arithmetic
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> operator+(const TFTypeName<U, K>& a)
+{
+  return a;
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> operator-(const TFTypeName<U, K>& a)
+{
+  return tfRun(TAPE_NEG, a);
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> operator+(const TFTypeName<U, K>& a, const TFTypeName<U, K>& b)
+{
+  return tfRun(TAPE_ADD, a, b);
+}
+template <typename U, int K, typename V>
+INLINE2 TFTypeName<U, K> operator+(const V& a, const TFTypeName<U, K>& b)
+{
+  return tfRun(TAPE_ADD_C, a, b, b);
+}
+template <typename U, int K, typename V>
+INLINE2 TFTypeName<U, K> operator+(const TFTypeName<U, K>& a, const V& b)
+{
+  return tfRun(TAPE_ADD_C, b, a, a);
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> operator-(const TFTypeName<U, K>& a, const TFTypeName<U, K>& b)
+{
+  return tfRun(TAPE_SUB, a, b);
+}
+template <typename U, int K, typename V>
+INLINE2 TFTypeName<U, K> operator-(const V& a, const TFTypeName<U, K>& b)
+{
+  return tfRun(TAPE_C_SUB, a, b, b);
+}
+template <typename U, int K, typename V>
+INLINE2 TFTypeName<U, K> operator-(const TFTypeName<U, K>& a, const V& b)
+{
+  return tfRun(TAPE_SUB_C, b, a, a);
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> operator*(const TFTypeName<U, K>& a, const TFTypeName<U, K>& b)
+{
+  return tfRun(TAPE_MUL, a, b);
+}
+template <typename U, int K, typename V>
+INLINE2 TFTypeName<U, K> operator*(const V& a, const TFTypeName<U, K>& b)
+{
+  return tfRun(TAPE_MUL_C, a, b, b);
+}
+template <typename U, int K, typename V>
+INLINE2 TFTypeName<U, K> operator*(const TFTypeName<U, K>& a, const V& b)
+{
+  return tfRun(TAPE_MUL_C, b, a, a);
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> operator/(const TFTypeName<U, K>& a, const TFTypeName<U, K>& b)
+{
+  return tfRun(TAPE_DIV, a, b);
+}
+template <typename U, int K, typename V>
+INLINE2 TFTypeName<U, K> operator/(const V& a, const TFTypeName<U, K>& b)
+{
+  return tfRun(TAPE_C_DIV, a, b, b);
+}
+template <typename U, int K, typename V>
+INLINE2 TFTypeName<U, K> operator/(const TFTypeName<U, K>& a, const V& b)
+{
+  return tfRun(TAPE_DIV_C, b, a, a);
+}
+
+// Elementary functions
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> sqr(const TFTypeName<U, K>& a)
+{
+  return tfRun(TAPE_SQR, a);
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> sqrt(const TFTypeName<U, K>& a)
+{
+  return tfRun(TAPE_SQRT, a);
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> exp(const TFTypeName<U, K>& a)
+{
+  return tfRun(TAPE_EXP, a);
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> log(const TFTypeName<U, K>& a)
+{
+  return tfRun(TAPE_LOG, a);
+}
+// As T, pow is exp(b*log(a)) with the 0th coefficient from pow itself.
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> pow(const TFTypeName<U, K>& a, const TFTypeName<U, K>& b)
+{
+  TFTypeName<U, K> c(exp(b * log(a)));
+  c[ 0 ] = Op<U>::myPow(a[ 0 ], b[ 0 ]);
+  return c;
+}
+// reloaded for mpreal
+template <int K>
+INLINE2 TFTypeName<mpreal, K> pow(const TFTypeName<mpreal, K>& a, const TFTypeName<mpreal, K>& b)
+{
+  TFTypeName<mpreal, K> c(exp(b * log(a)));
+  Op<mpreal>::mpreal_pow(c[ 0 ], a[ 0 ], b[ 0 ]);
+  return c;
+}
+template <typename U, int K, typename V>
+INLINE2 TFTypeName<U, K> pow(const V& a, const TFTypeName<U, K>& b)
+{
+  TFTypeName<U, K> c(exp(b * Op<V>::myLog(a)));
+  c[ 0 ] = Op<U>::myPow(a, b[ 0 ]);
+  return c;
+}
+// reloaded for mpreal
+template <int K, typename V>
+INLINE2 TFTypeName<mpreal, K> pow(const V& a, const TFTypeName<mpreal, K>& b)
+{
+  Op<mpreal>::mpreal_log(TEMP_RESULT, a);
+  TFTypeName<mpreal, K> c(exp(b * TEMP_RESULT));
+  Op<mpreal>::mpreal_pow(c[ 0 ], a, b[ 0 ]);
+  return c;
+}
+template <typename U, int K, typename V>
+INLINE2 TFTypeName<U, K> pow(const TFTypeName<U, K>& a, const V& b)
+{
+  TFTypeName<U, K> c(exp(b * log(a)));
+  c[ 0 ] = Op<U>::myPow(a[ 0 ], b);
+  return c;
+}
+// reloaded for mpreal
+template <int K, typename V>
+INLINE2 TFTypeName<mpreal, K> pow(const TFTypeName<mpreal, K>& a, const V& b)
+{
+  TFTypeName<mpreal, K> c(exp(b * log(a)));
+  Op<mpreal>::mpreal_pow(c[ 0 ], a[ 0 ], b);
+  return c;
+}
+// sin and cos compute each other as the helper series of the recurrence.
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> sin(const TFTypeName<U, K>& a)
+{
+  TFTypeName<U, K> v, w;
+  TKernel<U>::run(TAPE_SIN, a[ 0 ], 0, &a[ 0 ], &a[ 0 ], &v[ 0 ], &w[ 0 ], 0, K);
+  return v;
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> cos(const TFTypeName<U, K>& a)
+{
+  TFTypeName<U, K> v, w;
+  TKernel<U>::run(TAPE_COS, a[ 0 ], 0, &a[ 0 ], &a[ 0 ], &v[ 0 ], &w[ 0 ], 0, K);
+  return v;
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> tan(const TFTypeName<U, K>& a)
+{
+  return tfRun(TAPE_TAN, a, sqr(cos(a)));
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> asin(const TFTypeName<U, K>& a)
+{
+  return tfRun(TAPE_ASIN, a, sqrt(Op<U>::myOne() - sqr(a)));
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> acos(const TFTypeName<U, K>& a)
+{
+  return tfRun(TAPE_ACOS, a, sqrt(Op<U>::myOne() - sqr(a)));
+}
+template <typename U, int K>
+INLINE2 TFTypeName<U, K> atan(const TFTypeName<U, K>& a)
+{
+  return tfRun(TAPE_ATAN, a, Op<U>::myOne() + sqr(a));
+}
+
+template <typename U, int K>
+struct Reentrant<TFTypeName<U, K>> : Reentrant<U>
+{
+};
+
+template <typename U, int K>
+struct Op<TFTypeName<U, K>>
+{
+  typedef TFTypeName<U, K> T;
+  typedef TFTypeName<U, K> Underlying;
+  typedef typename Op<U>::Base Base;
+  static Base myInteger(const int i) { return Base(i); }
+  static Base                     myZero() { return myInteger(0); }
+  static Base                     myOne() { return myInteger(1); }
+  static Base                     myTwo() { return myInteger(2); }
+  static Base                     myPI() { return Op<Base>::myPI(); }
+  static T myPos(const T& x) { return +x; }
+  static T myNeg(const T& x) { return -x; }
+  template <typename V>
+  static T& myCadd(T& x, const V& y)
+  {
+    return x += y;
+  }
+  template <typename V>
+  static T& myCsub(T& x, const V& y)
+  {
+    return x -= y;
+  }
+  template <typename V>
+  static T& myCmul(T& x, const V& y)
+  {
+    return x *= y;
+  }
+  template <typename V>
+  static T& myCdiv(T& x, const V& y)
+  {
+    return x /= y;
+  }
+  static T myInv(const T& x) { return myOne() / x; }
+  static T mySqr(const T& x) { return fadbad::sqr(x); }
+  template <typename X, typename Y>
+  static T myPow(const X& x, const Y& y)
+  {
+    return fadbad::pow(x, y);
+  }
+  static T mySqrt(const T& x) { return fadbad::sqrt(x); }
+  static T myLog(const T& x) { return fadbad::log(x); }
+  static T myExp(const T& x) { return fadbad::exp(x); }
+  static T mySin(const T& x) { return fadbad::sin(x); }
+  static T myCos(const T& x) { return fadbad::cos(x); }
+  static T myTan(const T& x) { return fadbad::tan(x); }
+  static T myAsin(const T& x) { return fadbad::asin(x); }
+  static T myAcos(const T& x) { return fadbad::acos(x); }
+  static T myAtan(const T& x) { return fadbad::atan(x); }
+  static bool myEq(const T& x, const T& y) { return x == y; }
+  static bool myNe(const T& x, const T& y) { return x != y; }
+  static bool myLt(const T& x, const T& y) { return x < y; }
+  static bool myLe(const T& x, const T& y) { return x <= y; }
+  static bool myGt(const T& x, const T& y) { return x > y; }
+  static bool myGe(const T& x, const T& y) { return x >= y; }
+};
+
+}  // namespace fadbad
+
+#endif
@@ -0,0 +1,236 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _TINTEGRATOR_H
+#define _TINTEGRATOR_H
+
+#include <cmath>
+#include <vector>
+
+#include "tprogram.h"
+
+namespace fadbad
+{
+
+// Taylor series integrator of the autonomous system x' = f(x). The right
+// hand side is recorded once with T and frozen into a TProgram; each step
+// resets the program at the current point and generates the coefficients
+// of the solution by the recurrence x[i+1] = f(x)[i]/(i+1):
+//
+//   T<double> x[2], xp[2];
+//   xp[0] = x[1];
+//   xp[1] = -sin(x[0]);
+//   TIntegrator<double> ode(x, xp, 2, 1e-14);
+//   double t = 0, y[2] = {1, 0};
+//   ode.integrate(t, y, 10.0);
+//
+// The order and the step follow Jorba and Zou: for a tolerance eps the
+// order is p = -ln(eps)/2 + 1, at most tLength<N>() - 1, and the step is
+// the smaller of (eps/|x[j]|)^(1/j) for the last two coefficients j = p - 1
+// and p, which for that order is the radius of convergence estimated from
+// the tail, divided by e^2. Norms are max norms relative to max(1, |x|).
+// The step control runs in double on log2 of the norms, so eps must be a
+// normal double; the series itself is summed in U by Horner's method. A
+// time dependent system gets t as an extra variable with t' = 1.
+//
+// A step fails, and leaves t and x as they were, when a coefficient is not
+// finite or when the step would be shorter than hmin; integrate also fails
+// after maxSteps steps. Near a singularity the steps shrink towards zero,
+// so integrate then stops at the last point reached and returns false.
+template <typename U>
+struct TNorm  // log2|x| in double, for the step control; -HUGE_VAL for 0
+{
+  static double log2Abs(const U& x) { return std::log2(std::fabs(static_cast<double>(x))); }
+};
+// SPECIALIZED TEMPLATE FOR mpreal class:
+template <>
+struct TNorm<mpreal>
+{
+  static double log2Abs(const mpreal& x)
+  {
+    if (mpfr_zero_p(x.mpfr_srcptr()))
+      return -HUGE_VAL;
+    long         e;
+    const double d = mpfr_get_d_2exp(&e, x.mpfr_srcptr(), MPFR_RNDN);
+    return std::log2(std::fabs(d)) + e;  // NaN and inf pass through
+  }
+};
+
+template <typename U, int N = MaxLength>
+class TIntegrator
+{
+  TProgram<U, N> m_f;
+  unsigned int   m_n;
+  unsigned int   m_order;
+  double         m_tol;
+  TPool*         m_pool;
+  unsigned int   m_steps;
+  double         m_hmin;
+  unsigned int   m_maxSteps;
+
+  // log2 of the max norm of coefficient i; NaN if one is NaN:
+  double lnorm(const unsigned int i) const
+  {
+    double r = -HUGE_VAL;
+    for (unsigned int j = 0; j < m_n; ++j)
+    {
+      const double l = TNorm<U>::log2Abs(m_f.x(j, i));
+      if (l != l)
+        return l;
+      r = std::max(r, l);
+    }
+    return r;
+  }
+
+ public:
+  // x[0..n) are the state variables and xp[0..n) = f(x) was recorded over
+  // them.
+  TIntegrator(const TTypeName<U, N>* x, const TTypeName<U, N>* xp, const unsigned int n,
+              const double tol)
+      : m_f(x, n, xp, n),
+        m_n(n),
+        m_tol(tol),
+        m_pool(0),
+        m_steps(0),
+        m_hmin(1e-12),
+        m_maxSteps(100000)
+  {
+    m_order = (unsigned int)std::ceil(-0.5 * std::log(tol) + 1);
+    m_order = std::max(2u, std::min(m_order, tLength<N>() - 1));
+  }
+  // Overrides the order chosen from the tolerance, at most tLength<N>() - 1:
+  void setOrder(const unsigned int p)
+  {
+    USER_ASSERT(p > 0 && p < tLength<N>(),
+                "Order " << p << " out of bounds [1," << tLength<N>() - 1 << "]")
+    m_order = p;
+  }
+  // The shortest step and the most steps of one integrate, by default
+  // 1e-12 and 100000:
+  void setStepLimits(const double hmin, const unsigned int maxSteps)
+  {
+    USER_ASSERT(hmin >= 0 && maxSteps > 0, "Invalid step limits " << hmin << ", " << maxSteps)
+    m_hmin     = hmin;
+    m_maxSteps = maxSteps;
+  }
+  // Evaluates the right-hand side on the threads of the pool (TProgram):
+  void         setPool(TPool* pool) { m_pool = pool; }
+  unsigned int order() const { return m_order; }
+  unsigned int steps() const { return m_steps; }
+  // Generates the Taylor coefficients of the solution through x0, up to
+  // order k; coefficient i of variable j is then coef(j, i).
+  void expand(const U* x0, const unsigned int k)
+  {
+    m_f.reset();
+    for (unsigned int j = 0; j < m_n; ++j)
+      m_f.x(j, 0) = x0[ j ];
+    for (unsigned int i = 0; i < k; ++i)
+    {
+      if (m_pool)
+        m_f.eval(i, *m_pool);
+      else
+        m_f.eval(i);
+      for (unsigned int j = 0; j < m_n; ++j)
+      {
+        U& c = m_f.x(j, i + 1);
+        c    = m_f.y(j, i);
+        Op<U>::myCdiv(c, Op<U>::myInteger(i + 1));
+      }
+    }
+  }
+  const U& coef(const unsigned int j, const unsigned int i) const { return m_f.x(j, i); }
+  // Sums the series of the last expansion at h by Horner's method.
+  void sum(const U& h, U* x) const
+  {
+    for (unsigned int j = 0; j < m_n; ++j)
+    {
+      x[ j ] = m_f.x(j, m_order);
+      for (unsigned int i = m_order; i-- > 0;)
+      {
+        Op<U>::myCmul(x[ j ], h);
+        Op<U>::myCadd(x[ j ], m_f.x(j, i));
+      }
+    }
+  }
+  // One step from (t, x) of length at most |h|, in the direction of h; h
+  // becomes the step taken. Returns false, with t and x unchanged, when a
+  // coefficient is not finite or the step would be shorter than hmin.
+  bool step(U& t, U* x, U& h)
+  {
+    expand(x, m_order);
+    const double scale = std::max(0.0, lnorm(0));
+    if (!(scale < HUGE_VAL))
+      return false;
+    const double ltol = std::log2(m_tol);
+    double       r    = HUGE_VAL;
+    for (unsigned int i = 1; i <= m_order; ++i)
+    {
+      const double c = lnorm(i) - scale;
+      if (!(c < HUGE_VAL))
+        return false;  // NaN or infinite
+      if (i >= m_order - 1 && c > -HUGE_VAL)
+        r = std::min(r, std::exp2((ltol - c) / i));
+    }
+    if (std::log2(r) < TNorm<U>::log2Abs(h))
+    {
+      if (r < m_hmin)
+        return false;
+      const bool back = Op<U>::myLt(h, Op<U>::myZero());
+      h               = r;
+      if (back)
+        h = -h;
+    }
+    sum(h, x);
+    Op<U>::myCadd(t, h);
+    ++m_steps;
+    return true;
+  }
+  // Integrates from t to t1; t becomes t1 and x the state there. Returns
+  // false when a step fails or after maxSteps steps, with (t, x) the last
+  // point reached.
+  bool integrate(U& t, U* x, const U& t1)
+  {
+    for (unsigned int s = 0; Op<U>::myNe(t, t1); ++s)
+    {
+      if (s == m_maxSteps)
+        return false;
+      U       h = t1 - t;
+      const U d = h;
+      if (!step(t, x, h))
+        return false;
+      if (Op<U>::myEq(h, d))
+        t = t1;  // the last step lands on t1 exactly
+    }
+    return true;
+  }
+};
+
+}  // namespace fadbad
+
+#endif
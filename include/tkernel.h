@@ -0,0 +1,511 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _TKERNEL_H
+#define _TKERNEL_H
+
+#include "fadbad.h"
+
+namespace fadbad
+{
+// The Taylor coefficient recurrences of the elementary operations, on
+// plain arrays of coefficients. Shared by TProgram, which runs them over
+// the rows of its arena, and the eager TF type, which runs them over the
+// coefficients held in each value.
+template <typename U>
+struct TKernel  // coefficients l0..l-1 of v = op(a, b); w is the helper series of sin and cos
+{
+  static const bool reentrant = Reentrant<U>::value;
+  static void run(const unsigned int op, const U& c, const unsigned int d, const U* a, const U* b,
+                  U* v, U* w, unsigned int i, const unsigned int l)
+  {
+    switch (op)
+    {
+      case TAPE_ADD:
+        for (; i < l; ++i)
+          v[ i ] = a[ i ] + b[ i ];
+        break;
+      case TAPE_SUB:
+        for (; i < l; ++i)
+          v[ i ] = a[ i ] - b[ i ];
+        break;
+      case TAPE_MUL:
+        for (; i < l; ++i)
+        {
+          v[ i ] = Op<U>::myZero();
+          for (unsigned int j = 0; j <= i; ++j)
+            Op<U>::myCadd(v[ i ], a[ j ] * b[ i - j ]);
+        }
+        break;
+      case TAPE_DIV:
+        for (; i < l; ++i)
+        {
+          v[ i ] = a[ i ];
+          for (unsigned int j = 1; j <= i; ++j)
+            Op<U>::myCsub(v[ i ], b[ j ] * v[ i - j ]);
+          Op<U>::myCdiv(v[ i ], b[ 0 ]);
+        }
+        break;
+      case TAPE_ADD_C:
+        if (i == 0)
+          v[ i++ ] = c + a[ 0 ];
+        for (; i < l; ++i)
+          v[ i ] = a[ i ];
+        break;
+      case TAPE_SUB_C:
+        if (i == 0)
+          v[ i++ ] = a[ 0 ] - c;
+        for (; i < l; ++i)
+          v[ i ] = a[ i ];
+        break;
+      case TAPE_C_SUB:
+        if (i == 0)
+          v[ i++ ] = c - a[ 0 ];
+        for (; i < l; ++i)
+          v[ i ] = Op<U>::myNeg(a[ i ]);
+        break;
+      case TAPE_MUL_C:
+        for (; i < l; ++i)
+          v[ i ] = c * a[ i ];
+        break;
+      case TAPE_DIV_C:
+        for (; i < l; ++i)
+          v[ i ] = a[ i ] / c;
+        break;
+      case TAPE_C_DIV:
+        if (i == 0)
+          v[ i++ ] = c / a[ 0 ];
+        for (; i < l; ++i)
+        {
+          v[ i ] = Op<U>::myZero();
+          for (unsigned int j = 1; j <= i; ++j)
+            Op<U>::myCsub(v[ i ], a[ j ] * v[ i - j ]);
+          Op<U>::myCdiv(v[ i ], a[ 0 ]);
+        }
+        break;
+      case TAPE_NEG:
+        for (; i < l; ++i)
+          v[ i ] = Op<U>::myNeg(a[ i ]);
+        break;
+      case TAPE_SQR:
+        if (i == 0)
+          v[ i++ ] = Op<U>::mySqr(a[ 0 ]);
+        for (; i < l; ++i)
+        {
+          v[ i ]         = Op<U>::myZero();
+          unsigned int m = (i + 1) / 2;
+          for (unsigned int j = 0; j < m; ++j)
+            Op<U>::myCadd(v[ i ], a[ i - j ] * a[ j ]);
+          Op<U>::myCmul(v[ i ], Op<U>::myTwo());
+          if (0 == i % 2)
+            Op<U>::myCadd(v[ i ], Op<U>::mySqr(a[ m ]));
+        }
+        break;
+      case TAPE_SQRT:
+        if (i == 0)
+          v[ i++ ] = Op<U>::mySqrt(a[ 0 ]);
+        for (; i < l; ++i)
+        {
+          v[ i ]         = Op<U>::myZero();
+          unsigned int m = (i + 1) / 2;
+          for (unsigned int j = 1; j < m; ++j)
+            Op<U>::myCadd(v[ i ], v[ i - j ] * v[ j ]);
+          Op<U>::myCmul(v[ i ], Op<U>::myTwo());
+          if (0 == i % 2)
+            Op<U>::myCadd(v[ i ], Op<U>::mySqr(v[ m ]));
+          v[ i ] = (a[ i ] - v[ i ]) / (Op<U>::myTwo() * v[ 0 ]);
+        }
+        break;
+      case TAPE_EXP:
+        if (i == 0)
+          v[ i++ ] = Op<U>::myExp(a[ 0 ]);
+        for (; i < l; ++i)
+        {
+          v[ i ] = Op<U>::myZero();
+          for (unsigned int j = 0; j < i; ++j)
+            Op<U>::myCadd(v[ i ], (Op<U>::myOne() - Op<U>::myInteger(j) / Op<U>::myInteger(i)) *
+                                      a[ i - j ] * v[ j ]);
+        }
+        break;
+      case TAPE_LOG:
+        if (i == 0)
+          v[ i++ ] = Op<U>::myLog(a[ 0 ]);
+        for (; i < l; ++i)
+        {
+          v[ i ] = a[ i ];
+          for (unsigned int j = 1; j < i; ++j)
+            Op<U>::myCsub(v[ i ], (Op<U>::myOne() - Op<U>::myInteger(j) / Op<U>::myInteger(i)) *
+                                      a[ j ] * v[ i - j ]);
+          Op<U>::myCdiv(v[ i ], a[ 0 ]);
+        }
+        break;
+      case TAPE_SIN:  // w = cos
+      case TAPE_COS:  // w = sin
+        if (i == 0)
+        {
+          v[ 0 ] = op == TAPE_SIN ? Op<U>::mySin(a[ 0 ]) : Op<U>::myCos(a[ 0 ]);
+          w[ 0 ] = op == TAPE_SIN ? Op<U>::myCos(a[ 0 ]) : Op<U>::mySin(a[ 0 ]);
+          i      = 1;
+        }
+        for (; i < l; ++i)
+        {
+          v[ i ] = Op<U>::myZero();
+          for (unsigned int j = 0; j < i; ++j)
+          {
+            if (op == TAPE_SIN)
+              Op<U>::myCadd(v[ i ], Op<U>::myInteger(j + 1) * w[ i - 1 - j ] * a[ j + 1 ]);
+            else
+              Op<U>::myCsub(v[ i ], Op<U>::myInteger(j + 1) * w[ i - 1 - j ] * a[ j + 1 ]);
+          }
+          Op<U>::myCdiv(v[ i ], Op<U>::myInteger(i));
+          w[ i ] = Op<U>::myZero();
+          for (unsigned int j = 0; j < i; ++j)
+          {
+            if (op == TAPE_SIN)
+              Op<U>::myCsub(w[ i ], Op<U>::myInteger(j + 1) * v[ i - 1 - j ] * a[ j + 1 ]);
+            else
+              Op<U>::myCadd(w[ i ], Op<U>::myInteger(j + 1) * v[ i - 1 - j ] * a[ j + 1 ]);
+          }
+          Op<U>::myCdiv(w[ i ], Op<U>::myInteger(i));
+        }
+        break;
+      case TAPE_TAN:  // b = sqr(cos(a)), 1 - sqr(a) and 1 + sqr(a) below
+      case TAPE_ASIN:
+      case TAPE_ACOS:
+      case TAPE_ATAN:
+        if (i == 0)
+        {
+          switch (op)
+          {
+            case TAPE_TAN:
+              v[ 0 ] = Op<U>::myTan(a[ 0 ]);
+              break;
+            case TAPE_ASIN:
+              v[ 0 ] = Op<U>::myAsin(a[ 0 ]);
+              break;
+            case TAPE_ACOS:
+              v[ 0 ] = Op<U>::myAcos(a[ 0 ]);
+              break;
+            default:
+              v[ 0 ] = Op<U>::myAtan(a[ 0 ]);
+          }
+          i = 1;
+        }
+        for (; i < l; ++i)
+        {
+          v[ i ] = Op<U>::myZero();
+          for (unsigned int j = 1; j < i; ++j)
+            Op<U>::myCadd(v[ i ], Op<U>::myInteger(j) * v[ j ] * b[ i - j ]);
+          if (op == TAPE_ACOS)
+            v[ i ] = Op<U>::myNeg((a[ i ] + v[ i ] / Op<U>::myInteger(i)) / b[ 0 ]);
+          else
+            v[ i ] = (a[ i ] - v[ i ] / Op<U>::myInteger(i)) / b[ 0 ];
+        }
+        break;
+      case TAPE_DIFF:
+        for (; i < l; ++i)
+        {
+          unsigned int fact = 1;
+          for (unsigned int j = i + d; j > i; --j)
+            fact *= j;
+          v[ i ] = a[ i + d ] * Op<U>::myInteger(fact);
+        }
+        break;
+      default:
+        INTERNAL_ASSERT(false, "Unexpected op code " << op)
+        break;
+    }
+  }
+};
+// SPECIALIZED TEMPLATE FOR mpreal class:
+template <>
+struct TKernel<mpreal>
+{
+  static const bool reentrant = Reentrant<mpreal>::value;
+  static void run(const unsigned int op, const mpreal& c, const unsigned int d, const mpreal* a,
+                  const mpreal* b, mpreal* v, mpreal* w, unsigned int i, const unsigned int l)
+  {
+    switch (op)
+    {
+      case TAPE_ADD:
+        for (; i < l; ++i)
+          Op<mpreal>::mpreal_add(v[ i ], a[ i ], b[ i ]);
+        break;
+      case TAPE_SUB:
+        for (; i < l; ++i)
+          Op<mpreal>::mpreal_sub(v[ i ], a[ i ], b[ i ]);
+        break;
+      case TAPE_MUL:
+        for (; i < l; ++i)
+        {
+          v[ i ] = 0;
+          for (unsigned int j = 0; j <= i; ++j)
+          {
+            Op<mpreal>::mpreal_mul(TEMP_RESULT, a[ j ], b[ i - j ]);
+            Op<mpreal>::myCadd(v[ i ], TEMP_RESULT);
+          }
+        }
+        break;
+      case TAPE_DIV:
+        for (; i < l; ++i)
+        {
+          v[ i ] = a[ i ];
+          for (unsigned int j = 1; j <= i; ++j)
+          {
+            Op<mpreal>::mpreal_mul(TEMP_RESULT, b[ j ], v[ i - j ]);
+            Op<mpreal>::myCsub(v[ i ], TEMP_RESULT);
+          }
+          Op<mpreal>::myCdiv(v[ i ], b[ 0 ]);
+        }
+        break;
+      case TAPE_ADD_C:
+        if (i == 0)
+          Op<mpreal>::mpreal_add(v[ i++ ], c, a[ 0 ]);
+        for (; i < l; ++i)
+          v[ i ] = a[ i ];
+        break;
+      case TAPE_SUB_C:
+        if (i == 0)
+          Op<mpreal>::mpreal_sub(v[ i++ ], a[ 0 ], c);
+        for (; i < l; ++i)
+          v[ i ] = a[ i ];
+        break;
+      case TAPE_C_SUB:
+        if (i == 0)
+          Op<mpreal>::mpreal_sub(v[ i++ ], c, a[ 0 ]);
+        for (; i < l; ++i)
+          Op<mpreal>::mpreal_neg(v[ i ], a[ i ]);
+        break;
+      case TAPE_MUL_C:
+        for (; i < l; ++i)
+          Op<mpreal>::mpreal_mul(v[ i ], c, a[ i ]);
+        break;
+      case TAPE_DIV_C:
+        for (; i < l; ++i)
+        {
+          Op<mpreal>::mpreal_div(TEMP_RESULT, a[ i ], c);
+          v[ i ] = TEMP_RESULT;
+        }
+        break;
+      case TAPE_C_DIV:
+        if (i == 0)
+        {
+          Op<mpreal>::mpreal_div(TEMP_RESULT, c, a[ 0 ]);
+          v[ i++ ] = TEMP_RESULT;
+        }
+        for (; i < l; ++i)
+        {
+          v[ i ] = 0;
+          for (unsigned int j = 1; j <= i; ++j)
+          {
+            Op<mpreal>::mpreal_mul(TEMP_RESULT, a[ j ], v[ i - j ]);
+            Op<mpreal>::myCsub(v[ i ], TEMP_RESULT);
+          }
+          Op<mpreal>::myCdiv(v[ i ], a[ 0 ]);
+        }
+        break;
+      case TAPE_NEG:
+        for (; i < l; ++i)
+          Op<mpreal>::mpreal_neg(v[ i ], a[ i ]);
+        break;
+      case TAPE_SQR:
+        if (i == 0)
+          Op<mpreal>::mpreal_sqr(v[ i++ ], a[ 0 ]);
+        for (; i < l; ++i)
+        {
+          v[ i ]         = 0;
+          unsigned int m = (i + 1) / 2;
+          for (unsigned int j = 0; j < m; ++j)
+          {
+            Op<mpreal>::mpreal_mul(TEMP_RESULT, a[ i - j ], a[ j ]);
+            Op<mpreal>::myCadd(v[ i ], TEMP_RESULT);
+          }
+          Op<mpreal>::myCmul(v[ i ], 2);
+          if (0 == i % 2)
+          {
+            Op<mpreal>::mpreal_sqr(TEMP_RESULT, a[ m ]);
+            Op<mpreal>::myCadd(v[ i ], TEMP_RESULT);
+          }
+        }
+        break;
+      case TAPE_SQRT:
+        if (i == 0)
+          Op<mpreal>::mpreal_sqrt(v[ i++ ], a[ 0 ]);
+        for (; i < l; ++i)
+        {
+          v[ i ]         = 0;
+          unsigned int m = (i + 1) / 2;
+          for (unsigned int j = 1; j < m; ++j)
+          {
+            Op<mpreal>::mpreal_mul(TEMP_RESULT, v[ i - j ], v[ j ]);
+            Op<mpreal>::myCadd(v[ i ], TEMP_RESULT);
+          }
+          Op<mpreal>::myCmul(v[ i ], 2);
+          if (0 == i % 2)
+          {
+            Op<mpreal>::mpreal_sqr(TEMP_RESULT, v[ m ]);
+            Op<mpreal>::myCadd(v[ i ], TEMP_RESULT);
+          }
+          Op<mpreal>::mpreal_sub(TEMP_RESULT, a[ i ], v[ i ]);
+          Op<mpreal>::mpreal_mul(TEMP_RESULT1, 2, v[ 0 ]);
+          Op<mpreal>::mpreal_div(v[ i ], TEMP_RESULT, TEMP_RESULT1);
+        }
+        break;
+      case TAPE_EXP:
+        if (i == 0)
+          Op<mpreal>::mpreal_exp(v[ i++ ], a[ 0 ]);
+        for (; i < l; ++i)
+        {
+          v[ i ] = 0;
+          for (unsigned int j = 0; j < i; ++j)
+          {
+            Op<mpreal>::mpreal_mul(TEMP_RESULT, double(i - j), a[ i - j ]);
+            Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT, v[ j ]);
+            Op<mpreal>::myCadd(v[ i ], TEMP_RESULT1);
+          }
+          Op<mpreal>::myCdiv(v[ i ], i);
+        }
+        break;
+      case TAPE_LOG:
+        if (i == 0)
+          Op<mpreal>::mpreal_log(v[ i++ ], a[ 0 ]);
+        for (; i < l; ++i)
+        {
+          v[ i ] = 0;
+          for (unsigned int j = 1; j < i; ++j)
+          {
+            Op<mpreal>::mpreal_mul(TEMP_RESULT, double(i - j), a[ j ]);
+            Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT, v[ i - j ]);
+            Op<mpreal>::myCadd(v[ i ], TEMP_RESULT1);
+          }
+          Op<mpreal>::myCdiv(v[ i ], i);
+          Op<mpreal>::mpreal_sub(TEMP_RESULT, a[ i ], v[ i ]);
+          Op<mpreal>::mpreal_div(v[ i ], TEMP_RESULT, a[ 0 ]);
+        }
+        break;
+      case TAPE_SIN:  // w = cos
+      case TAPE_COS:  // w = sin
+        if (i == 0)
+        {
+          if (op == TAPE_SIN)
+            Op<mpreal>::mpreal_sin_cos(v[ 0 ], w[ 0 ], a[ 0 ]);
+          else
+            Op<mpreal>::mpreal_sin_cos(w[ 0 ], v[ 0 ], a[ 0 ]);
+          i = 1;
+        }
+        for (; i < l; ++i)
+        {
+          v[ i ] = 0;
+          for (unsigned int j = 0; j < i; ++j)
+          {
+            Op<mpreal>::mpreal_mul(TEMP_RESULT, double(j + 1), w[ i - 1 - j ]);
+            Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT, a[ j + 1 ]);
+            if (op == TAPE_SIN)
+              Op<mpreal>::myCadd(v[ i ], TEMP_RESULT1);
+            else
+              Op<mpreal>::myCsub(v[ i ], TEMP_RESULT1);
+          }
+          Op<mpreal>::myCdiv(v[ i ], i);
+          w[ i ] = 0;
+          for (unsigned int j = 0; j < i; ++j)
+          {
+            Op<mpreal>::mpreal_mul(TEMP_RESULT, double(j + 1), v[ i - 1 - j ]);
+            Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT, a[ j + 1 ]);
+            if (op == TAPE_SIN)
+              Op<mpreal>::myCsub(w[ i ], TEMP_RESULT1);
+            else
+              Op<mpreal>::myCadd(w[ i ], TEMP_RESULT1);
+          }
+          Op<mpreal>::myCdiv(w[ i ], i);
+        }
+        break;
+      case TAPE_TAN:
+      case TAPE_ASIN:
+      case TAPE_ACOS:
+      case TAPE_ATAN:
+        if (i == 0)
+        {
+          switch (op)
+          {
+            case TAPE_TAN:
+              Op<mpreal>::mpreal_tan(v[ 0 ], a[ 0 ]);
+              break;
+            case TAPE_ASIN:
+              Op<mpreal>::mpreal_asin(v[ 0 ], a[ 0 ]);
+              break;
+            case TAPE_ACOS:
+              Op<mpreal>::mpreal_acos(v[ 0 ], a[ 0 ]);
+              break;
+            default:
+              Op<mpreal>::mpreal_atan(v[ 0 ], a[ 0 ]);
+          }
+          i = 1;
+        }
+        for (; i < l; ++i)
+        {
+          v[ i ] = 0;
+          for (unsigned int j = 1; j < i; ++j)
+          {
+            Op<mpreal>::mpreal_mul(TEMP_RESULT, double(j), v[ j ]);
+            Op<mpreal>::mpreal_mul(TEMP_RESULT1, TEMP_RESULT, b[ i - j ]);
+            Op<mpreal>::myCadd(v[ i ], TEMP_RESULT1);
+          }
+          Op<mpreal>::mpreal_div(TEMP_RESULT, v[ i ], double(i));
+          if (op == TAPE_ACOS)
+          {
+            Op<mpreal>::mpreal_add(TEMP_RESULT1, a[ i ], TEMP_RESULT);
+            Op<mpreal>::mpreal_div(TEMP_RESULT, TEMP_RESULT1, b[ 0 ]);
+            Op<mpreal>::mpreal_neg(v[ i ], TEMP_RESULT);
+          }
+          else
+          {
+            Op<mpreal>::mpreal_sub(TEMP_RESULT1, a[ i ], TEMP_RESULT);
+            Op<mpreal>::mpreal_div(v[ i ], TEMP_RESULT1, b[ 0 ]);
+          }
+        }
+        break;
+      case TAPE_DIFF:
+        for (; i < l; ++i)
+        {
+          unsigned int fact = 1;
+          for (unsigned int j = i + d; j > i; --j)
+            fact *= j;
+          Op<mpreal>::mpreal_mul(v[ i ], a[ i + d ], fact);
+        }
+        break;
+      default:
+        INTERNAL_ASSERT(false, "Unexpected op code " << op)
+        break;
+    }
+  }
+};
+
+}  // namespace fadbad
+
+#endif
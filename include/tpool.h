@@ -0,0 +1,223 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _TPOOL_H
+#define _TPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fadbad
+{
+
+// Work-stealing pool of threads that runs the tasks of a dependency graph.
+// A task becomes ready when the tasks it depends on are done; it is then
+// queued on the thread that finished the last of them, which picks its own
+// newest task first, and a thread without tasks steals the oldest one of
+// another thread. The calling thread takes part as thread 0. A thread that
+// finds no task anywhere sleeps until one is queued or the run ends.
+//
+//   TPool pool(32);
+//   pool.run(n, pending, first, next, task);
+//
+// runs task(t) for t in [0, n), where pending[t] is the number of tasks
+// that t waits for and next[first[t]..first[t + 1]) are the tasks waiting
+// for t.
+class TPool
+{
+  struct Queue
+  {
+    std::mutex               m_mutex;
+    std::deque<unsigned int> m_tasks;
+  };
+
+  std::vector<std::thread>                  m_threads;
+  std::deque<Queue>                         m_queues;
+  std::mutex                                m_mutex;
+  std::condition_variable                   m_start, m_done;
+  unsigned long                             m_batch;
+  unsigned int                              m_busy;
+  bool                                      m_stop;
+  const unsigned int*                       m_first;
+  const unsigned int*                       m_next;
+  std::vector<std::atomic<unsigned int>>    m_pending;
+  std::atomic<unsigned int>                 m_left;
+  std::atomic<unsigned int>                 m_queued;   // tasks in the queues
+  std::atomic<unsigned int>                 m_waiting;  // threads asleep in work()
+  std::mutex                                m_idle;
+  std::condition_variable                   m_wake;
+  std::function<void(const unsigned int)>   m_task;
+
+  TPool(const TPool&) { /*illegal*/}
+  void operator=(const TPool&) { /*illegal*/}
+
+  // Wakes sleeping threads. A sleeper counts itself in m_waiting before it
+  // looks at m_queued and m_left, and the waker changes those before it
+  // looks at m_waiting, so either side sees the other.
+  void wake(const bool all)
+  {
+    if (m_waiting.load() == 0)
+      return;
+    std::lock_guard<std::mutex> lock(m_idle);
+    if (all)
+      m_wake.notify_all();
+    else
+      m_wake.notify_one();
+  }
+  void push(const unsigned int i, const unsigned int t)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_queues[ i ].m_mutex);
+      m_queues[ i ].m_tasks.push_back(t);
+    }
+    m_queued.fetch_add(1);
+    wake(false);
+  }
+  bool pop(const unsigned int i, unsigned int& t)
+  {
+    std::lock_guard<std::mutex> lock(m_queues[ i ].m_mutex);
+    if (m_queues[ i ].m_tasks.empty())
+      return false;
+    t = m_queues[ i ].m_tasks.back();
+    m_queues[ i ].m_tasks.pop_back();
+    m_queued.fetch_sub(1);
+    return true;
+  }
+  bool steal(const unsigned int i, unsigned int& t)
+  {
+    for (unsigned int k = 1; k < m_queues.size(); ++k)
+    {
+      Queue&                      q = m_queues[ (i + k) % m_queues.size() ];
+      std::lock_guard<std::mutex> lock(q.m_mutex);
+      if (q.m_tasks.empty())
+        continue;
+      t = q.m_tasks.front();
+      q.m_tasks.pop_front();
+      m_queued.fetch_sub(1);
+      return true;
+    }
+    return false;
+  }
+  void work(const unsigned int i)
+  {
+    unsigned int t;
+    while (m_left.load(std::memory_order_acquire) > 0)
+    {
+      if (!pop(i, t) && !steal(i, t))
+      {
+        std::unique_lock<std::mutex> lock(m_idle);
+        m_waiting.fetch_add(1);
+        m_wake.wait(lock, [&] { return m_left.load() == 0 || m_queued.load() > 0; });
+        m_waiting.fetch_sub(1);
+        continue;
+      }
+      m_task(t);
+      for (unsigned int k = m_first[ t ]; k < m_first[ t + 1 ]; ++k)
+        if (m_pending[ m_next[ k ] ].fetch_sub(1, std::memory_order_acq_rel) == 1)
+          push(i, m_next[ k ]);
+      if (m_left.fetch_sub(1) == 1)
+        wake(true);
+    }
+  }
+  void worker(const unsigned int i)
+  {
+    unsigned long batch = 0;
+    for (;;)
+    {
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_start.wait(lock, [&] { return m_stop || m_batch != batch; });
+        if (m_stop)
+          return;
+        batch = m_batch;
+      }
+      work(i);
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_busy == 0)
+        m_done.notify_one();
+    }
+  }
+
+ public:
+  explicit TPool(const unsigned int threads = std::thread::hardware_concurrency())
+      : m_queues(std::max(threads, 1u)), m_batch(0), m_busy(0), m_stop(false), m_first(0),
+        m_next(0), m_left(0), m_queued(0), m_waiting(0)
+  {
+    for (unsigned int i = 1; i < m_queues.size(); ++i)
+      m_threads.push_back(std::thread(&TPool::worker, this, i));
+  }
+  ~TPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_start.notify_all();
+    for (unsigned int i = 0; i < m_threads.size(); ++i)
+      m_threads[ i ].join();
+  }
+  unsigned int size() const { return (unsigned int)m_queues.size(); }
+  void run(const unsigned int n, const unsigned int* pending, const unsigned int* first,
+           const unsigned int* next, const std::function<void(const unsigned int)>& task)
+  {
+    if (n == 0)
+      return;
+    std::vector<std::atomic<unsigned int>> counters(n);
+    unsigned int                           ready = 0;
+    for (unsigned int t = 0; t < n; ++t)
+    {
+      counters[ t ].store(pending[ t ], std::memory_order_relaxed);
+      if (pending[ t ] == 0)
+        push(ready++ % size(), t);
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_pending.swap(counters);
+    m_first = first;
+    m_next  = next;
+    m_task  = task;
+    m_left.store(n, std::memory_order_release);
+    m_busy = size() - 1;
+    ++m_batch;
+    lock.unlock();
+    m_start.notify_all();
+    work(0);
+    lock.lock();
+    m_done.wait(lock, [&] { return m_busy == 0; });
+  }
+};
+
+}  // namespace fadbad
+
+#endif
@@ -0,0 +1,486 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _TPROGRAM_H
+#define _TPROGRAM_H
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "tadiff.h"
+#include "tkernel.h"
+#include "tpool.h"
+
+namespace fadbad
+{
+
+// A T graph frozen into a flat program. The nodes below the dependent
+// variables are sorted once, operands first, into an array of
+// instructions holding the op code and the indices of their operand rows,
+// and the Taylor coefficients of all nodes are kept in one arena with a
+// row per node, in the same order, holding the coefficients of order up to
+// the order given to the constructor (by default tLength<N>() - 1, see
+// tMaxLength() in tadiff.h). eval(k) is then a
+// single forward loop over the instructions, with no recursion, no
+// virtual calls and no length checks at shared nodes:
+//
+//   T<double> x, y = f(x);
+//   TProgram<double> p(&x, 1, &y, 1, k);
+//   for (each step)
+//   {
+//     p.reset();
+//     p.x(0, 0) = x0;
+//     p.x(0, 1) = 1;
+//     p.eval(k);
+//     ... p.y(0, i) ...
+//   }
+//
+// The program does not refer to the graph after it has been built, so it
+// may be reused for as long as the expression stays the same. Leaves other
+// than the inputs keep the coefficients they had when the program was
+// built. The result of pow() is evaluated as exp(b*log(a)), which is what
+// T computes for all but the 0th coefficient. The graph may have a base
+// type other than U if it converts to U, e.g. a T<double> graph for a
+// program of Lanes<double, M> (TBatch below).
+//
+// eval(k, pool) spreads the instructions over the threads of a TPool, each
+// instruction starting as soon as its operands are done. This pays off when
+// single instructions are expensive, as with T<mpreal> at high precision,
+// and the graph is wide, as the right-hand side of a system of ODEs. The
+// worker threads compute at the default precision and rounding mode of the
+// calling thread. T<mpreal> needs FADBAD_THREADSAFE for its scratch values;
+// without it the program is evaluated by the calling thread alone.
+
+template <typename U, int N = MaxLength>
+class TBatch;
+
+template <typename U, int N = MaxLength>
+class TProgram
+{
+  struct Instr
+  {
+    unsigned int m_op;
+    unsigned int m_v, m_a, m_b;  // rows of the result and the operands
+    unsigned int m_w;            // row of the helper series of sin and cos
+    unsigned int m_c;            // index of the constant, or the order of diff
+  };
+  struct State  // the coefficients of one evaluation
+  {
+    std::vector<U>            m_coef;  // m_width coefficients per row
+    std::vector<unsigned int> m_len;   // coefficients computed per row
+  };
+  friend class TBatch<U, N>;
+
+  std::vector<Instr>        m_code;
+  State                     m_state;
+  std::vector<unsigned int> m_shift;   // extra orders needed per row by diff
+  std::vector<unsigned int> m_leaves;  // rows of the leaves
+  std::vector<U>            m_const;
+  std::vector<unsigned int> m_x, m_y;  // rows of the inputs and outputs
+  std::vector<unsigned int> m_pending;  // operand instructions of an instruction
+  std::vector<unsigned int> m_first;    // m_next[m_first[j]..m_first[j + 1]) use instruction j
+  std::vector<unsigned int> m_next;
+  unsigned int              m_rows;
+  unsigned int              m_width;  // coefficients per row
+
+  unsigned int row() { return m_rows++; }
+  void         expand(State& s, const unsigned int k) const
+  {
+    for (unsigned int j = 0; j < m_leaves.size(); ++j)
+    {
+      const unsigned int r = m_leaves[ j ];
+      s.m_len[ r ] = std::max(s.m_len[ r ], std::min(k + 1 + m_shift[ r ], m_width));
+    }
+  }
+  // Computes the first l coefficients of a product at once (tseries.h);
+  // false for the other ops, which keep their recurrences.
+  bool bulk(State& s, const Instr& i, const unsigned int l) const
+  {
+    const U* a = &s.m_coef[ i.m_a * m_width ];
+    const U* b = &s.m_coef[ i.m_b * m_width ];
+    U*       v = &s.m_coef[ i.m_v * m_width ];
+    switch (i.m_op)
+    {
+      case TAPE_MUL:
+        TSeries<U>::mul(v, a, b, l);
+        return true;
+      case TAPE_SQR:
+        TSeries<U>::mul(v, a, a, l);
+        return true;
+      default:
+        return false;
+    }
+  }
+  void step(State& s, const unsigned int j) const
+  {
+    const Instr& i = m_code[ j ];
+    unsigned int l = std::min(s.m_len[ i.m_a ], s.m_len[ i.m_b ]);
+    if (i.m_op == TAPE_DIFF)
+      l = l > i.m_c ? l - i.m_c : 0;
+    if (s.m_len[ i.m_v ] <= 1 && tBulk(l) && bulk(s, i, l))
+      s.m_len[ i.m_v ] = l;
+    else if (l > s.m_len[ i.m_v ])
+    {
+      TKernel<U>::run(i.m_op, m_const[ i.m_op == TAPE_DIFF ? 0 : i.m_c ], i.m_c,
+                      &s.m_coef[ i.m_a * m_width ], &s.m_coef[ i.m_b * m_width ],
+                      &s.m_coef[ i.m_v * m_width ], &s.m_coef[ i.m_w * m_width ],
+                      s.m_len[ i.m_v ], l);
+      s.m_len[ i.m_v ] = l;
+    }
+    s.m_len[ i.m_w ] = s.m_len[ i.m_v ];
+  }
+  // Evaluates all instructions in order:
+  unsigned int run(State& s, const unsigned int k) const
+  {
+    expand(s, k);
+    for (unsigned int j = 0; j < m_code.size(); ++j)
+      step(s, j);
+    return outputLength(s);
+  }
+  unsigned int outputLength(const State& s) const
+  {
+    unsigned int l = m_width;
+    for (unsigned int j = 0; j < m_y.size(); ++j)
+      l = std::min(l, s.m_len[ m_y[ j ] ]);
+    return l;
+  }
+
+ public:
+  // The outputs y[0..m) over the inputs x[0..n), with the coefficients of
+  // order up to order < tLength<N>():
+  template <typename V>
+  TProgram(const TTypeName<V, N>* x, const unsigned int n, const TTypeName<V, N>* y,
+           const unsigned int m, const unsigned int order = tLength<N>() - 1)
+      : m_const(1, Op<U>::myZero()), m_x(n), m_y(m), m_rows(0), m_width(order + 1)
+  {
+    USER_ASSERT(order < tLength<N>(),
+                "Order " << order << " out of bounds [0," << tLength<N>() - 1 << "]")
+    // Number the nodes below the roots in postorder, operands first:
+    typedef TTypeNameHV<V, N>                       HV;
+    std::map<const HV*, unsigned int>               index;
+    std::vector<std::pair<const HV*, unsigned int>> leaves;
+    std::vector<std::pair<const HV*, unsigned int>> stack;
+    std::map<std::pair<unsigned int, unsigned int>, unsigned int> trig;
+    V                                               c;
+    for (unsigned int j = 0; j < m; ++j)
+    {
+      if (index.count(y[ j ].getTTypeNameHV()) == 0)
+        stack.push_back(std::make_pair(y[ j ].getTTypeNameHV(), 0u));
+      while (!stack.empty())
+      {
+        const HV* p = stack.back().first;
+        if (stack.back().second < p->arity())
+        {
+          const HV* q = p->operand(stack.back().second++);
+          if (index.count(q) == 0)
+            stack.push_back(std::make_pair(q, 0u));
+          continue;
+        }
+        stack.pop_back();
+        if (index.count(p) != 0)
+          continue;
+        const unsigned int op = p->opcode(&c);
+        switch (op)
+        {
+          case TAPE_LEAF:
+            index[ p ] = row();
+            leaves.push_back(std::make_pair(p, index[ p ]));
+            break;
+          case TAPE_POS:  // copies of the operand share its row
+          case TAPE_POW:
+          case TAPE_POW_C:
+          case TAPE_C_POW:
+            index[ p ] = index[ p->operand(0) ];
+            break;
+          case TAPE_SIN:  // sin and cos of the same operand share one instruction
+          case TAPE_COS:
+          {
+            const unsigned int a     = index[ p->operand(0) ];
+            const unsigned int other = op == TAPE_SIN ? TAPE_COS : TAPE_SIN;
+            std::map<std::pair<unsigned int, unsigned int>, unsigned int>::const_iterator t;
+            if ((t = trig.find(std::make_pair(a, op))) != trig.end())
+            {
+              index[ p ] = m_code[ t->second ].m_v;
+              break;
+            }
+            if ((t = trig.find(std::make_pair(a, other))) != trig.end())
+            {
+              index[ p ] = m_code[ t->second ].m_w;
+              break;
+            }
+            trig[ std::make_pair(a, op) ] = (unsigned int)m_code.size();
+          }
+          // fall through
+          default:
+          {
+            Instr i;
+            i.m_op     = op;
+            i.m_a      = index[ p->operand(0) ];
+            i.m_b      = p->arity() > 1 ? index[ p->operand(1) ] : i.m_a;
+            i.m_v      = row();
+            i.m_w      = op == TAPE_SIN || op == TAPE_COS ? row() : i.m_v;
+            i.m_c      = 0;
+            index[ p ] = i.m_v;
+            if (op == TAPE_DIFF)
+              i.m_c = static_cast<int>(c);
+            else if (op >= TAPE_ADD_C && op <= TAPE_C_DIV)
+            {
+              i.m_c = (unsigned int)m_const.size();
+              m_const.push_back(c);
+            }
+            m_code.push_back(i);
+          }
+        }
+      }
+    }
+    for (unsigned int j = 0; j < n; ++j)
+    {
+      typename std::map<const HV*, unsigned int>::const_iterator k;
+      k = index.find(x[ j ].getTTypeNameHV());
+      m_x[ j ] = k == index.end() ? row() : k->second;  // unused inputs get a row of their own
+    }
+    for (unsigned int j = 0; j < m; ++j)
+      m_y[ j ] = index[ y[ j ].getTTypeNameHV() ];
+    m_state.m_coef.resize(m_rows * m_width);
+    m_state.m_len.assign(m_rows, 0);
+    for (unsigned int k = 0; k < leaves.size(); ++k)
+    {
+      m_leaves.push_back(leaves[ k ].second);
+      for (unsigned int i = 0; i < m_width; ++i)
+        m_state.m_coef[ leaves[ k ].second * m_width + i ] = leaves[ k ].first->val(i);
+    }
+    // A diff of order d needs d more coefficients of its operand:
+    m_shift.assign(m_rows, 0);
+    for (unsigned int k = (unsigned int)m_code.size(); k-- > 0;)
+    {
+      const Instr&       i = m_code[ k ];
+      const unsigned int s =
+          std::max(m_shift[ i.m_v ], m_shift[ i.m_w ]) + (i.m_op == TAPE_DIFF ? i.m_c : 0);
+      m_shift[ i.m_a ]     = std::max(m_shift[ i.m_a ], s);
+      m_shift[ i.m_b ]     = std::max(m_shift[ i.m_b ], s);
+    }
+    // Dependencies between the instructions, for eval(k, pool):
+    std::vector<unsigned int> producer(m_rows, ~0u);
+    for (unsigned int j = 0; j < m_code.size(); ++j)
+      producer[ m_code[ j ].m_v ] = producer[ m_code[ j ].m_w ] = j;
+    m_pending.assign(m_code.size(), 0);
+    m_first.assign(m_code.size() + 1, 0);
+    for (unsigned int j = 0; j < m_code.size(); ++j)
+    {
+      const unsigned int a = producer[ m_code[ j ].m_a ], b = producer[ m_code[ j ].m_b ];
+      if (a != ~0u)
+      {
+        ++m_pending[ j ];
+        ++m_first[ a + 1 ];
+      }
+      if (b != ~0u && b != a)
+      {
+        ++m_pending[ j ];
+        ++m_first[ b + 1 ];
+      }
+    }
+    for (unsigned int j = 0; j < m_code.size(); ++j)
+      m_first[ j + 1 ] += m_first[ j ];
+    m_next.resize(m_first.back() + 1);  // never empty, so &m_next[ 0 ] is valid
+    std::vector<unsigned int> fill(m_first.begin(), m_first.end() - 1);
+    for (unsigned int j = 0; j < m_code.size(); ++j)
+    {
+      const unsigned int a = producer[ m_code[ j ].m_a ], b = producer[ m_code[ j ].m_b ];
+      if (a != ~0u)
+        m_next[ fill[ a ]++ ] = j;
+      if (b != ~0u && b != a)
+        m_next[ fill[ b ]++ ] = j;
+    }
+  }
+  // Coefficient i of input j, and of output j:
+  U& x(const unsigned int j, const unsigned int i)
+  {
+    return m_state.m_coef[ m_x[ j ] * m_width + i ];
+  }
+  const U& x(const unsigned int j, const unsigned int i) const
+  {
+    return m_state.m_coef[ m_x[ j ] * m_width + i ];
+  }
+  const U& y(const unsigned int j, const unsigned int i) const
+  {
+    return m_state.m_coef[ m_y[ j ] * m_width + i ];
+  }
+  unsigned int length(const unsigned int j) const { return m_state.m_len[ m_y[ j ] ]; }
+  unsigned int size() const { return (unsigned int)m_code.size(); }
+  // Computes the coefficients of order up to k of the outputs, continuing
+  // from the ones computed by the previous calls since reset():
+  unsigned int eval(const unsigned int k) { return run(m_state, k); }
+  unsigned int eval(const unsigned int k, TPool& pool)
+  {
+    if (!TKernel<U>::reentrant || pool.size() < 2 || m_code.empty())
+      return eval(k);
+    expand(m_state, k);
+    const mpfr_prec_t prec = mpfr_get_default_prec();
+    const mpfr_rnd_t  rnd  = mpfr_get_default_rounding_mode();
+    pool.run((unsigned int)m_code.size(), &m_pending[ 0 ], &m_first[ 0 ], &m_next[ 0 ],
+             [&](const unsigned int j) {
+               if (mpfr_get_default_prec() != prec)
+                 mpfr_set_default_prec(prec);
+               if (mpfr_get_default_rounding_mode() != rnd)
+                 mpfr_set_default_rounding_mode(rnd);
+               step(m_state, j);
+             });
+    return outputLength(m_state);
+  }
+  // Forgets the computed coefficients, before new values of the inputs:
+  void reset() { std::fill(m_state.m_len.begin(), m_state.m_len.end(), 0u); }
+};
+
+// Evaluations of one TProgram at many points. Each instance has its own
+// coefficient rows, of the width of those of the program, and runs the
+// instructions of the program, which must outlive the batch. The rows of an
+// instance are made when it is first written to or evaluated, with the
+// leaves and inputs of the program as they are then; until then, reading
+// it reads the program:
+//
+//   TProgram<double> p(&x, 1, &y, 1, k);
+//   TBatch<double> b(p, 1000);
+//   for (unsigned int q = 0; q < b.size(); ++q)
+//   {
+//     b.x(q, 0, 0) = x0[ q ];
+//     b.x(q, 0, 1) = 1;
+//   }
+//   b.eval(k, pool);
+//   ... b.y(q, 0, i) ...
+//
+// eval(k, pool) gives each thread of a TPool whole instances, which for
+// many points beats splitting single evaluations, as eval(k, pool) of the
+// program does; it has the same requirements. With double, a program of
+// Lanes<double, M> (lanes.h) built from the same scalar graph evaluates M
+// points per instance, one in each lane of the coefficients:
+//
+//   TProgram<Lanes<double, 4> > p4(&x, 1, &y, 1);  // x, y are T<double>
+template <typename U, int N>
+class TBatch
+{
+  typedef typename TProgram<U, N>::State State;
+
+  const TProgram<U, N>& m_p;
+  std::vector<State>    m_states;  // empty until used
+
+  TBatch(const TBatch&) { /*illegal*/}
+  void operator=(const TBatch&) { /*illegal*/}
+
+  // The rows of instance q, made on first use:
+  State& state(const unsigned int q)
+  {
+    State& s = m_states[ q ];
+    if (s.m_len.empty())
+    {
+      const unsigned int w = m_p.m_width;
+      s.m_coef.resize(m_p.m_rows * w);
+      s.m_len.assign(m_p.m_rows, 0u);
+      for (unsigned int k = 0; k < m_p.m_leaves.size(); ++k)
+        copyRow(s, m_p.m_leaves[ k ]);
+      for (unsigned int j = 0; j < m_p.m_x.size(); ++j)
+        copyRow(s, m_p.m_x[ j ]);
+    }
+    return s;
+  }
+  const State& state(const unsigned int q) const
+  {
+    return m_states[ q ].m_len.empty() ? m_p.m_state : m_states[ q ];
+  }
+  void copyRow(State& s, const unsigned int r) const
+  {
+    const unsigned int w = m_p.m_width;
+    std::copy(m_p.m_state.m_coef.begin() + r * w, m_p.m_state.m_coef.begin() + (r + 1) * w,
+              s.m_coef.begin() + r * w);
+  }
+  unsigned int outputLength() const
+  {
+    unsigned int l = m_p.m_width;
+    for (unsigned int q = 0; q < m_states.size(); ++q)
+      l = std::min(l, m_p.outputLength(m_states[ q ]));
+    return l;
+  }
+
+ public:
+  TBatch(const TProgram<U, N>& p, const unsigned int m) : m_p(p), m_states(m) {}
+  unsigned int size() const { return (unsigned int)m_states.size(); }
+  // Coefficient i of input j, and of output j, of instance q:
+  U& x(const unsigned int q, const unsigned int j, const unsigned int i)
+  {
+    return state(q).m_coef[ m_p.m_x[ j ] * m_p.m_width + i ];
+  }
+  const U& x(const unsigned int q, const unsigned int j, const unsigned int i) const
+  {
+    return state(q).m_coef[ m_p.m_x[ j ] * m_p.m_width + i ];
+  }
+  const U& y(const unsigned int q, const unsigned int j, const unsigned int i) const
+  {
+    return state(q).m_coef[ m_p.m_y[ j ] * m_p.m_width + i ];
+  }
+  unsigned int length(const unsigned int q, const unsigned int j) const
+  {
+    return m_states[ q ].m_len.empty() ? 0 : m_states[ q ].m_len[ m_p.m_y[ j ] ];
+  }
+  // Computes the coefficients of order up to k of the outputs of all
+  // instances and returns the smallest number computed:
+  unsigned int eval(const unsigned int k)
+  {
+    for (unsigned int q = 0; q < m_states.size(); ++q)
+      m_p.run(state(q), k);
+    return outputLength();
+  }
+  unsigned int eval(const unsigned int k, TPool& pool)
+  {
+    if (!TKernel<U>::reentrant || pool.size() < 2 || m_states.size() < 2)
+      return eval(k);
+    const mpfr_prec_t               prec = mpfr_get_default_prec();
+    const mpfr_rnd_t                rnd  = mpfr_get_default_rounding_mode();
+    const std::vector<unsigned int> none(m_states.size() + 1, 0u);  // no dependencies
+    pool.run((unsigned int)m_states.size(), &none[ 0 ], &none[ 0 ], &none[ 0 ],
+             [&](const unsigned int q) {
+               if (mpfr_get_default_prec() != prec)
+                 mpfr_set_default_prec(prec);
+               if (mpfr_get_default_rounding_mode() != rnd)
+                 mpfr_set_default_rounding_mode(rnd);
+               m_p.run(state(q), k);
+             });
+    return outputLength();
+  }
+  // Forgets the computed coefficients of all instances:
+  void reset()
+  {
+    for (unsigned int q = 0; q < m_states.size(); ++q)
+      std::fill(m_states[ q ].m_len.begin(), m_states[ q ].m_len.end(), 0u);
+  }
+};
+
+}  // namespace fadbad
+
+#endif
@@ -0,0 +1,306 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _TSERIES_H
+#define _TSERIES_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "fadbad.h"
+
+namespace fadbad
+{
+
+// Truncated power series products on blocks of coefficients, for
+// computing the first l coefficients of a MUL or SQR node at once when
+// tBulkLength() is nonzero and l is at least tBulkLength(). Otherwise, and
+// when a node is extended coefficient by coefficient, the recurrences of the
+// nodes are used, which cost O(l^2). The default is off. On an x86-64 host
+// the bulk products pay off from about l = 128 in mpreal of 128 bits or
+// more, for series that decay at the same rate (ExampleTAD4 takes 40% less
+// time at l = 512 and 1024 bits); in double the recurrences are as fast up
+// to l = 512 at least, so enable it only after measuring.
+//
+// Products use Karatsuba's method, O(l^1.58); the truncated product only
+// forms the lower half of the full one. Its error is relative to the larger
+// coefficients, so the operands are first scaled to coefficients of about
+// the same size, a(t) -> a(2^k t) with k fitted to their decay. Rounding
+// the scale factors costs each coefficient a few units in the last place
+// of its own size. This only works for series that decay geometrically.
+// If the scaled coefficients still spread over more than 4 binary orders,
+// as the factorially decaying series of exp, sin and most entire functions
+// do, and as the product of two series that decay at different rates does,
+// the product is formed by the convolution instead, so each coefficient
+// keeps its own relative accuracy.
+//
+// Newton iterations for reciprocal, exp and sqrt, and log and the inverse
+// functions by integrating a quotient, are not used: measured against a
+// 300 bit reference they lose many digits in the high order coefficients,
+// in double and in mpreal, because of the cancellation in their correction
+// steps. FFT based products are not used for the same reason.
+//
+// The shortest products that are formed at once, for all T types; 0 (the
+// default) turns it off. Set it at run time with tBulkLength() = l.
+inline unsigned int& tBulkLength()
+{
+  static unsigned int l = 0;
+  return l;
+}
+// Whether the first l coefficients of a product are formed at once:
+inline bool tBulk(const unsigned int l)
+{
+  return tBulkLength() > 0 && l >= tBulkLength();
+}
+
+// Arrays must not overlap.
+template <typename U>
+struct TSeriesOp  // scalar kernels of the series arithmetic
+{
+  static void zero(U& r) { r = Op<U>::myZero(); }
+  static void addMul(U& r, const U& a, const U& b) { Op<U>::myCadd(r, a * b); }
+  static void add(U& r, const U& a, const U& b) { r = a + b; }
+  static void sub(U& r, const U& a, const U& b) { r = a - b; }
+  static void pow2(U& r, const int j) { r = std::exp2(j / 64.0); }  // r = 2^(j/64)
+  static void scale(U& r, const U& f, const int e) { r *= f * std::exp2(double(e)); }  // f 2^e
+  static void range(double& lo, double& hi, const U& a)  // of log2|a|, -HUGE_VAL for 0
+  {
+    lo = hi = a == 0 ? -HUGE_VAL : std::log2(std::fabs(static_cast<double>(a)));
+  }
+};
+// SPECIALIZED TEMPLATE FOR mpreal class:
+template <>
+struct TSeriesOp<mpreal>
+{
+  static void addMul(mpreal& r, const mpreal& a, const mpreal& b)
+  {
+    Op<mpreal>::mpreal_fma(r, a, b, r);
+  }
+  static void zero(mpreal& r) { mpfr_set_zero(r.mpfr_ptr(), 1); }
+  static void add(mpreal& r, const mpreal& a, const mpreal& b) { Op<mpreal>::mpreal_add(r, a, b); }
+  static void sub(mpreal& r, const mpreal& a, const mpreal& b) { Op<mpreal>::mpreal_sub(r, a, b); }
+  static void pow2(mpreal& r, const int j)
+  {
+    if (r.get_prec() != DEFAULT_PREC)
+      r.set_prec(DEFAULT_PREC, DEFAULT_RNDM);
+    mpfr_set_si(r.mpfr_ptr(), j, DEFAULT_RNDM);
+    mpfr_div_2ui(r.mpfr_ptr(), r.mpfr_srcptr(), 6, DEFAULT_RNDM);
+    mpfr_exp2(r.mpfr_ptr(), r.mpfr_srcptr(), DEFAULT_RNDM);
+  }
+  static void scale(mpreal& r, const mpreal& f, const int e)
+  {
+    Op<mpreal>::mpreal_mul(r, r, f);
+    mpfr_mul_2si(r.mpfr_ptr(), r.mpfr_srcptr(), e, DEFAULT_RNDM);
+  }
+  static void range(double& lo, double& hi, const mpreal& a)
+  {
+    if (mpfr_zero_p(a.mpfr_srcptr()))
+    {
+      lo = hi = -HUGE_VAL;
+      return;
+    }
+    long         e;
+    const double d = mpfr_get_d_2exp(&e, a.mpfr_srcptr(), MPFR_RNDN);
+    lo = hi = std::log2(std::fabs(d)) + e;
+  }
+};
+
+template <typename U>
+class TSeries
+{
+  typedef TSeriesOp<U> S;
+  static const unsigned int KARATSUBA = 16;  // smaller products are done directly
+  static const int          SPREAD    = 4;  // binary orders
+
+  // r[0..2n-1) = a[0..n) * b[0..n), with 8n scratch values in w
+  static void full(U* r, const U* a, const U* b, const unsigned int n, U* w)
+  {
+    if (n < KARATSUBA)
+    {
+      for (unsigned int i = 0; i + 1 < 2 * n; ++i)
+        S::zero(r[ i ]);
+      for (unsigned int i = 0; i < n; ++i)
+        for (unsigned int j = 0; j < n; ++j)
+          S::addMul(r[ i + j ], a[ i ], b[ j ]);
+      return;
+    }
+    // a = a0 + t^m a1 and b = b0 + t^m b1, with h >= m coefficients in a1,
+    // b1; a0*b0 and a1*b1 go straight to their places in r:
+    const unsigned int m = n / 2, h = n - m;
+    U *                s = w, *t = w + h, *z = w + 2 * h;
+    full(r, a, b, m, w);
+    S::zero(r[ 2 * m - 1 ]);
+    full(r + 2 * m, a + m, b + m, h, w);
+    for (unsigned int i = 0; i < h; ++i)
+    {
+      if (i < m)
+      {
+        S::add(s[ i ], a[ i ], a[ m + i ]);
+        S::add(t[ i ], b[ i ], b[ m + i ]);
+      }
+      else
+      {
+        s[ i ] = a[ m + i ];
+        t[ i ] = b[ m + i ];
+      }
+    }
+    full(z, s, t, h, w + 4 * h);
+    for (unsigned int i = 0; i < 2 * m - 1; ++i)
+      S::sub(z[ i ], z[ i ], r[ i ]);
+    for (unsigned int i = 0; i < 2 * h - 1; ++i)
+      S::sub(z[ i ], z[ i ], r[ 2 * m + i ]);
+    for (unsigned int i = 0; i < 2 * h - 1; ++i)
+      S::add(r[ m + i ], r[ m + i ], z[ i ]);
+  }
+
+  // The range of log2|a[i]|, over the lanes of a Lanes, with -HUGE_VAL for 0:
+  struct Logs
+  {
+    std::vector<double> lo, hi;
+    Logs(const U* a, const unsigned int n) : lo(n), hi(n)
+    {
+      for (unsigned int i = 0; i < n; ++i)
+        S::range(lo[ i ], hi[ i ], a[ i ]);
+    }
+  };
+  // Slope of the largest log2|a[i]| over i, by least squares over the
+  // nonzero a[i]:
+  static double decay(const Logs& l)
+  {
+    double s = 0, si = 0, sl = 0, sii = 0, sil = 0;
+    for (unsigned int i = 0; i < l.hi.size(); ++i)
+    {
+      if (l.hi[ i ] == -HUGE_VAL)
+        continue;
+      s += 1;
+      si += i;
+      sl += l.hi[ i ];
+      sii += double(i) * i;
+      sil += i * l.hi[ i ];
+    }
+    const double d = s * sii - si * si;
+    return s < 2 || d == 0 ? 0 : (s * sil - si * sl) / d;
+  }
+  // Spread of log2|a[i] 2^(k i)| over the nonzero a[i]:
+  static double spread(const Logs& l, const double k)
+  {
+    double lo = HUGE_VAL, hi = -HUGE_VAL;
+    for (unsigned int i = 0; i < l.hi.size(); ++i)
+    {
+      if (l.hi[ i ] == -HUGE_VAL)
+        continue;
+      lo = std::min(lo, l.lo[ i ] + k * i);
+      hi = std::max(hi, l.hi[ i ] + k * i);
+    }
+    return hi < lo ? 0 : hi - lo;
+  }
+  // j = t mod 64, with f[j] = 2^(j/64) formed on first use:
+  static int factor(std::vector<U>& f, std::vector<bool>& have, const int t)
+  {
+    const int j = ((t % 64) + 64) % 64;
+    if (!have[ j ])
+    {
+      S::pow2(f[ j ], j);
+      have[ j ] = true;
+    }
+    return j;
+  }
+  // r[0..n) = a*b mod t^n, by the convolution
+  static void school(U* r, const U* a, const U* b, const unsigned int n)
+  {
+    for (unsigned int i = 0; i < n; ++i)
+    {
+      S::zero(r[ i ]);
+      for (unsigned int j = 0; j <= i; ++j)
+        S::addMul(r[ i ], a[ j ], b[ i - j ]);
+    }
+  }
+  // r[0..n) = a*b mod t^n, unscaled, with 8n scratch values in w
+  static void shortMul(U* r, const U* a, const U* b, const unsigned int n, U* w)
+  {
+    if (n < KARATSUBA)
+    {
+      school(r, a, b, n);
+      return;
+    }
+    // the full product of the lower halves, which fits in r, and the cross
+    // terms truncated:
+    const unsigned int m = (n + 1) / 2, h = n - m;
+    full(r, a, b, m, w);
+    if (2 * m - 1 < n)
+      S::zero(r[ n - 1 ]);
+    shortMul(w, a, b + m, h, w + h);
+    for (unsigned int i = 0; i < h; ++i)
+      S::add(r[ m + i ], r[ m + i ], w[ i ]);
+    shortMul(w, a + m, b, h, w + h);
+    for (unsigned int i = 0; i < h; ++i)
+      S::add(r[ m + i ], r[ m + i ], w[ i ]);
+  }
+
+ public:
+  // r[0..n) = a*b mod t^n
+  static void mul(U* r, const U* a, const U* b, const unsigned int n)
+  {
+    if (n < KARATSUBA)
+    {
+      school(r, a, b, n);
+      return;
+    }
+    // a(t) -> a(2^(K/64) t): coefficient i is scaled by 2^(j/64) 2^e with
+    // K i = 64 e + j, so the 64 factors 2^(j/64) are the only rounded ones.
+    // The spread is checked on the logarithms first, so that falling back
+    // to the convolution costs O(n):
+    const Logs la(a, n), lb(b, n);
+    const int K = (int)std::floor(-(decay(la) + decay(lb)) / 2 * 64 + 0.5);
+    if (spread(la, K / 64.0) > SPREAD || spread(lb, K / 64.0) > SPREAD)
+    {
+      school(r, a, b, n);
+      return;
+    }
+    std::vector<U>    f(64), sa(a, a + n), sb(b, b + n), w(8 * n);
+    std::vector<bool> have(64, false);
+    for (unsigned int i = 1; i < n; ++i)
+    {
+      const int j = factor(f, have, K * (int)i);
+      S::scale(sa[ i ], f[ j ], (K * (int)i - j) / 64);
+      S::scale(sb[ i ], f[ j ], (K * (int)i - j) / 64);
+    }
+    shortMul(r, &sa[ 0 ], &sb[ 0 ], n, &w[ 0 ]);
+    for (unsigned int i = 1; i < n; ++i)
+    {
+      const int j = factor(f, have, -K * (int)i);
+      S::scale(r[ i ], f[ j ], (-K * (int)i - j) / 64);
+    }
+  }
+};
+
+}  // namespace fadbad
+
+#endif
@@ -0,0 +1,224 @@
+// Copyright (C) 1996-2007 Ole Stauning & Claus Bendtsen (fadbad@uning.dk)
+// All rights reserved.
+
+// This code is provided "as is", without any warranty of any kind,
+// either expressed or implied, including but not limited to, any implied
+// warranty of merchantibility or fitness for any purpose. In no event
+// will any party who distributed the code be liable for damages or for
+// any claim(s) by any other party, including but not limited to, any
+// lost profits, lost monies, lost data or data rendered inaccurate,
+// losses sustained by third parties, or any other special, incidental or
+// consequential damages arising out of the use or inability to use the
+// program, even if the possibility of such damages has been advised
+// against. The entire risk as to the quality, the performance, and the
+// fitness of the program for any particular purpose lies with the party
+// using the code.
+
+// This code, and any derivative of this code, may not be used in a
+// commercial package without the prior explicit written permission of
+// the authors. Verbatim copies of this code may be made and distributed
+// in any medium, provided that this copyright notice is not removed or
+// altered in any way. No fees may be charged for distribution of the
+// codes, other than a fee to cover the cost of the media and a
+// reasonable handling fee.
+
+// ***************************************************************
+// ANY USE OF THIS CODE CONSTITUTES ACCEPTANCE OF THE TERMS OF THE
+//                         COPYRIGHT NOTICE
+// ***************************************************************
+
+#ifndef _TTENSOR_H
+#define _TTENSOR_H
+
+#include <map>
+#include <vector>
+
+#include "lanes.h"
+#include "tadiff.h"
+
+namespace fadbad
+{
+
+// Mixed partial derivatives of f : R^n -> R of order up to d from
+// univariate Taylor expansions, by the interpolation of Griewank, Utke and
+// Walther (Math. Comp. 69, 2000). f is expanded along the directions
+// x0 + t*j for all multi-indices j with |j| = d, C(n+d-1, d) of them, and
+// every derivative of order |i| <= d is a fixed linear combination of the
+// coefficients f_|i|(j) of order |i| of these expansions:
+//
+//   d^i f = sum over |j| = d of gamma(i,j) f_|i|(j),
+//   gamma(i,j) = sum over 0 < k <= i of (-1)^|i-k| C(i,k) C(d*k/|k|, j) (|k|/d)^|i|
+//
+// The sum over k is the polarization identity, which needs f at the
+// points k, and C(d*k/|k|, j) interpolates f at the direction of k from
+// the lattice of directions. The weights are computed once, in U.
+//
+// The function is recorded once with T<Lanes<U, M> > and expanded M
+// directions at a time:
+//
+//   T<Lanes<double, 4> > x[2];
+//   T<Lanes<double, 4> > f(func(x));
+//   TTensor<double> t(2, 3);          // 2 inputs, orders up to 3
+//   double x0[2] = {1, 2};
+//   t.expand(x, f, x0);
+//   unsigned int i[2] = {1, 2};
+//   double fxyy = t.derivative(i);     // d^3 f / dx dy^2 at x0
+//
+// The coefficients may also be filled in by coef(r, k) from expansions
+// along direction(r, .) computed elsewhere.
+template <typename U>
+class TTensor
+{
+  unsigned int                                  m_n;
+  unsigned int                                  m_d;
+  std::vector<unsigned int>                     m_dir;    // m_dir[ r * n + m ], |j| = d
+  std::map<std::vector<unsigned int>, unsigned> m_index;  // i -> row of m_gamma, |i| <= d
+  std::vector<U>                                m_gamma;  // m_gamma[ q * size() + r ]
+  std::vector<U>                                m_coef;   // m_coef[ r * (d + 1) + k ]
+
+  TTensor(const TTensor&) { /*illegal*/}
+  void operator=(const TTensor&) { /*illegal*/}
+
+  // All multi-indices of n components with |j| = s, in lexicographic order:
+  static void indices(const unsigned int n, const unsigned int s, std::vector<unsigned int>& out)
+  {
+    std::vector<unsigned int> j(n, 0);
+    if (n == 0)
+      return;
+    j[ 0 ] = s;
+    for (;;)
+    {
+      out.insert(out.end(), j.begin(), j.end());
+      // next: move one unit from the last nonzero component before n-1 to the right
+      unsigned int m = n - 1;
+      const unsigned int tail = j[ m ];
+      j[ m ] = 0;
+      while (m > 0 && j[ m - 1 ] == 0)
+        --m;
+      if (m == 0)
+        return;
+      --j[ m - 1 ];
+      j[ m ] = tail + 1;
+    }
+  }
+  static U binomial(const unsigned int a, const unsigned int b)
+  {
+    U c(Op<U>::myOne());
+    for (unsigned int t = 0; t < b; ++t)
+      c = c * U(a - t) / U(t + 1);
+    return c;
+  }
+
+ public:
+  TTensor(const unsigned int n, const unsigned int d) : m_n(n), m_d(d)
+  {
+    USER_ASSERT(n > 0 && d > 0, "TTensor needs n > 0 and d > 0")
+    indices(n, d, m_dir);
+    std::vector<unsigned int> js;
+    for (unsigned int s = 0; s <= d; ++s)
+      indices(n, s, js);
+    const unsigned int nj = (unsigned int)js.size() / n, nr = size();
+    for (unsigned int q = 0; q < nj; ++q)
+      m_index[ std::vector<unsigned int>(&js[ q * n ], &js[ q * n ] + n) ] = q;
+    m_gamma.assign(nj * nr, Op<U>::myZero());
+    m_coef.assign(nr * (d + 1), Op<U>::myZero());
+    // gamma(i,j) of each derivative i, summing over the points 0 < k <= i:
+    std::vector<unsigned int> k(n);
+    std::vector<U>            z(n);
+    for (unsigned int q = 1; q < nj; ++q)  // the value (q = 0) is any coefficient of order 0
+    {
+      const unsigned int* i = &js[ q * n ];
+      unsigned int        si = 0;
+      for (unsigned int m = 0; m < n; ++m)
+        si += i[ m ];
+      std::fill(k.begin(), k.end(), 0u);
+      for (;;)
+      {
+        unsigned int m = 0;  // next k <= i
+        while (m < n && k[ m ] == i[ m ])
+          k[ m++ ] = 0;
+        if (m == n)
+          break;
+        ++k[ m ];
+        unsigned int sk = 0;
+        U            c(Op<U>::myOne());
+        for (m = 0; m < n; ++m)
+        {
+          sk += k[ m ];
+          c = c * binomial(i[ m ], k[ m ]);
+        }
+        if ((si - sk) % 2 == 1)
+          c = -c;
+        for (m = 0; m < si; ++m)
+          c = c * U(sk) / U(d);
+        // f along d*k/|k| by Lagrange interpolation in the directions j:
+        for (m = 0; m < n; ++m)
+          z[ m ] = U(d * k[ m ]) / U(sk);
+        for (unsigned int r = 0; r < nr; ++r)
+        {
+          const unsigned int* j = &m_dir[ r * n ];
+          U                   g(c);
+          for (m = 0; m < n; ++m)
+            for (unsigned int t = 0; t < j[ m ]; ++t)
+              g = g * (z[ m ] - U(t)) / U(t + 1);
+          m_gamma[ q * nr + r ] += g;
+        }
+      }
+    }
+  }
+  // Number of directions, and component m of direction r:
+  unsigned int size() const { return (unsigned int)m_dir.size() / m_n; }
+  unsigned int direction(const unsigned int r, const unsigned int m) const
+  {
+    return m_dir[ r * m_n + m ];
+  }
+  // Taylor coefficient of order k <= d of f(x0 + t*direction(r)):
+  U&       coef(const unsigned int r, const unsigned int k) { return m_coef[ r * (m_d + 1) + k ]; }
+  const U& coef(const unsigned int r, const unsigned int k) const
+  {
+    return m_coef[ r * (m_d + 1) + k ];
+  }
+  // Expands the recorded f with inputs x[0..n-1] at x0 along all
+  // directions, M at a time. The graph is reset before each pass.
+  template <unsigned int M, int N>
+  void expand(TTypeName<Lanes<U, M>, N>* x, TTypeName<Lanes<U, M>, N>& f, const U* x0)
+  {
+    USER_ASSERT(m_d < tLength<N>(), "Order " << m_d << " out of bounds [0," << tLength<N>() << ")")
+    const TTypeName<Lanes<U, M>, N>& cf(f);
+    for (unsigned int r0 = 0; r0 < size(); r0 += M)
+    {
+      f.reset();
+      for (unsigned int m = 0; m < m_n; ++m)
+      {
+        x[ m ][ 0 ] = x0[ m ];
+        for (unsigned int l = 0; l < M; ++l)
+          x[ m ][ 1 ][ l ] = r0 + l < size() ? U(direction(r0 + l, m)) : Op<U>::myZero();
+      }
+      f.eval(m_d);
+      for (unsigned int l = 0; l < M && r0 + l < size(); ++l)
+        for (unsigned int k = 0; k <= m_d; ++k)
+          coef(r0 + l, k) = cf[ k ][ l ];
+    }
+  }
+  // d^|i| f / dx^i at x0 for |i| <= d:
+  U derivative(const unsigned int* i) const
+  {
+    const std::map<std::vector<unsigned int>, unsigned>::const_iterator it =
+        m_index.find(std::vector<unsigned int>(i, i + m_n));
+    USER_ASSERT(it != m_index.end(), "Derivative of order above " << m_d)
+    if (it->second == 0)
+      return coef(0, 0);
+    unsigned int s = 0;
+    for (unsigned int m = 0; m < m_n; ++m)
+      s += i[ m ];
+    U                  sum(Op<U>::myZero());
+    const unsigned int nr = size();
+    for (unsigned int r = 0; r < nr; ++r)
+      sum += m_gamma[ it->second * nr + r ] * coef(r, s);
+    return sum;
+  }
+};
+
+}  // namespace fadbad
+
+#endif
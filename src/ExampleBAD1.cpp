@@ -0,0 +1,179 @@
+#include <iostream>
+#include "badiff.h"
+#include "fadiff.h"
+
+#define TERMS 2
+
+using namespace std;
+using namespace fadbad;
+
+template <typename T> B<T> func(const B<T> *x_in, int n);
+template <typename T> void show_result(B<T> &f_result, B<T> *x_in, int n);
+template <typename T, typename U>
+void show_norms(B<T> &f_result1, B<T> *x_in1, B<U> &f_result2, B<U> *x_in2, int n);
+void show_nodes(int prec);
+int main()
+{
+  // double type
+  // variables initiation
+  B<double> f_double;                // Declare variables f
+  B<double> x_double[ TERMS ];       //  Declare 2 variables
+  x_double[ 0 ] = 0.512;             // Initialize variable x
+  x_double[ 1 ] = 2.141;             // Initialize variable y
+  f_double = func(x_double, TERMS);  // Evaluate function and record the graph
+  f_double.diff(0, 1);               // Differentiate f (index 0 of 1)
+
+  // output
+  int output_prec = 15;
+  cout.precision(output_prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision, \noutput in " << output_prec << " digits" << endl;
+  show_result(f_double, x_double, TERMS);
+
+  // Settings for mpreal
+  int prec = 128;
+  /*Set the default working precision for the mpreal data type, the default working precision is 53
+   * bit which is the same as double*/
+  mpfr_set_default_prec(prec);
+
+  // variables initiation
+  B<mpreal> f_mpreal;                // Declare variables x,y,f
+  B<mpreal> x_mpreal[ TERMS ];       // Declare two variables
+  x_mpreal[ 0 ] = 0.512;             // Initialize variable x
+  x_mpreal[ 1 ] = 2.141;             // Initialize variable y
+  f_mpreal = func(x_mpreal, TERMS);  // Evaluate function and record the graph
+  f_mpreal.diff(0, 1);               // Differentiate f (index 0 of 1)
+
+  // output
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  cout << "output in " << output_prec << " digits" << endl;
+  show_result(f_mpreal, x_mpreal, TERMS);
+
+  // show_norms
+  int norm_output_prec = 5;
+  cout.precision(norm_output_prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Errors between double and MPFR precision " << prec << "\n";
+  show_norms(f_double, x_double, f_mpreal, x_mpreal, TERMS);
+
+  // every node type of B<mpreal> against F<mpreal>
+  for (prec = 128; prec <= 256; prec *= 2)
+  {
+    mpfr_set_default_prec(prec);
+    cout << "-----------------------------------------------\n";
+    cout << "Errors between B and F, MPFR precision " << prec << "\n";
+    show_nodes(prec);
+  }
+  return 0;
+}
+
+template <typename T>
+B<T> func(const B<T> *x_in, int n)
+{
+  B<T> x_out;
+  x_out = atan(x_in[ 0 ]) * x_in[ 1 ] + sin(x_in[ 0 ]) / sqrt(x_in[ 1 ]) - pow(x_in[ 1 ], 2.5);
+  return x_out;
+}
+template <typename T>
+void show_result(B<T> &f_result, B<T> *x_in, int n)
+{
+  T  fval  = f_result.x();  // Value of function
+  T *f_der = new T[ n ];
+  for (int i = 0; i < n; i++)
+    f_der[ i ] = x_in[ i ].d(0);  // get Value for each derivative
+
+  // output
+  cout << "f       = " << fval << endl;
+  for (int i = 0; i < n; i++)
+    cout << "df/d" << i << "th = " << f_der[ i ] << endl;  // output each derivative
+  delete[] f_der;
+}
+template <typename T, typename U>
+void show_norms(B<T> &f_result1, B<T> *x_in1, B<U> &f_result2, B<U> *x_in2, int n)
+{
+  // max-norm;
+  cout << "fval   : " << fabs(f_result1.x() - f_result2.x()) << endl;
+  for (int i = 0; i < n; i++)
+    cout << "df/d" << i << "th: " << fabs(x_in1[ i ].d(0) - x_in2[ i ].d(0)) << endl;
+}
+
+// The operations of B, one node type each (k = 0..NODES-1), with constant
+// operands of type mpreal, double and int:
+#define NODES 33
+const char *node_name[ NODES ] = {
+    "x+y",    "x-y",    "x*y",    "x/y",       "x+c",       "c+x",       "x-c",
+    "c-x",    "x*c",    "c*x",    "x/c",       "c/x",       "x+d",       "d-x",
+    "x*d",    "d/x",    "x*i",    "-x",        "+x",        "sqr(x)",    "sqrt(x)",
+    "exp(x)", "log(x)", "sin(x)", "cos(x)",    "tan(x)",    "asin(x)",   "acos(x)",
+    "atan(x)", "pow(x,y)", "pow(x,c)", "pow(c,x)", "x*=y"};
+template <typename X>
+X node(const int k, const X &x, const X &y)
+{
+  const mpreal c(0.75);
+  const double d = 0.75;
+  X            r(x);
+  switch (k)
+  {
+    case 0: return x + y;
+    case 1: return x - y;
+    case 2: return x * y;
+    case 3: return x / y;
+    case 4: return x + c;
+    case 5: return c + x;
+    case 6: return x - c;
+    case 7: return c - x;
+    case 8: return x * c;
+    case 9: return c * x;
+    case 10: return x / c;
+    case 11: return c / x;
+    case 12: return x + d;
+    case 13: return d - x;
+    case 14: return x * d;
+    case 15: return d / x;
+    case 16: return x * 3;
+    case 17: return -x;
+    case 18: return +x;
+    case 19: return sqr(x);
+    case 20: return sqrt(x);
+    case 21: return exp(x);
+    case 22: return log(x);
+    case 23: return sin(x);
+    case 24: return cos(x);
+    case 25: return tan(x);
+    case 26: return asin(x);
+    case 27: return acos(x);
+    case 28: return atan(x);
+    case 29: return pow(x, y);
+    case 30: return pow(x, c);
+    case 31: return pow(c, x);
+    default: return r *= y;
+  }
+}
+// Largest relative error of the value and the gradient of each node type,
+// B against F, in units of 2^-prec:
+void show_nodes(int prec)
+{
+  const mpreal ulp = pow(mpreal(2), -prec);
+  for (int k = 0; k < NODES; k++)
+  {
+    B<mpreal>    xb[ TERMS ], fb;
+    F<mpreal, 2> xf[ TERMS ], ff;
+    xb[ 0 ] = 0.512;
+    xb[ 1 ] = 2.141;
+    xf[ 0 ] = 0.512;
+    xf[ 1 ] = 2.141;
+    xf[ 0 ].diff(0);
+    xf[ 1 ].diff(1);
+    fb = node(k, xb[ 0 ], xb[ 1 ]);
+    ff = node(k, xf[ 0 ], xf[ 1 ]);
+    fb.diff(0, 1);
+    mpreal e = abs((fb.x() - ff.x()) / ff.x());
+    for (int i = 0; i < TERMS; i++)
+      if (ff.d(i) != 0)
+        e = max(e, mpreal(abs((xb[ i ].d(0) - ff.d(i)) / ff.d(i))));
+      else
+        e = max(e, mpreal(abs(xb[ i ].d(0))));
+    cout << node_name[ k ] << ": " << e / ulp << endl;
+  }
+}
@@ -0,0 +1,104 @@
+#include <cstdio>
+#include <iostream>
+#include "fadiff.h"
+#include "badiff.h"
+#include "tadiff.h"
+#include "btape.h"
+#include "graphio.h"
+
+#define TERMS 3
+#define ORDER 10
+
+using namespace std;
+using namespace fadbad;
+
+template <typename X>
+X func(const X *x)
+{
+  X a = sin(x[ 0 ] * x[ 1 ]) + exp(x[ 2 ]) / (1 + sqr(x[ 1 ]));
+  return a * sqrt(x[ 0 ] + x[ 2 ]) - pow(x[ 1 ], 3) + atan(x[ 2 ] / x[ 0 ]);
+}
+// The gradient at q from a compact tape recorded at p, saved and loaded
+// again, against F at q:
+template <typename U>
+void show_tape(const char *path)
+{
+  const U p[ TERMS ] = {U(0.3), U(1.7), U(0.4)}, q[ TERMS ] = {U(0.5), U(1.1), U(0.9)};
+  bool    saved;
+  {
+    Tape<U> tape;
+    BC<U>   x[ TERMS ];
+    for (int i = 0; i < TERMS; i++)
+      x[ i ].x() = p[ i ];
+    func(x);
+    saved = saveGraph(path, tape);
+  }
+  typedef typename BC<U>::Index Index;
+  Tape<U>                       tape;
+  const bool                    loaded = loadGraph(path, tape);
+  for (int i = 0; i < TERMS; i++)
+    tape[ i ].m_val = q[ i ];  // the leaves are the first records
+  tape.replay();
+  BC<U> f = BC<U>(Index(tape.size() - 1));
+  f.diff(0, 1);
+
+  F<U, TERMS> xf[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+  {
+    xf[ i ] = q[ i ];
+    xf[ i ].diff(i);
+  }
+  F<U, TERMS> ff = func(xf);
+  U           e  = fabs((f.val() - ff.val()) / ff.val());
+  for (int i = 0; i < TERMS; i++)
+    e = max(e, U(fabs((BC<U>(Index(i)).d(0) - ff.d(i)) / ff.d(i))));
+  cout << "tape saved " << saved << ", loaded " << loaded << ", gradient against F: " << e << endl;
+}
+// Taylor coefficients of a T graph loaded from a file, against the graph
+// that was saved:
+template <typename U>
+void show_taylor(const char *path)
+{
+  T<U> x[ TERMS ], y[ 2 ];
+  y[ 0 ] = func(x);
+  y[ 1 ] = y[ 0 ] * cos(x[ 1 ]);
+  const bool saved = saveGraph(path, x, TERMS, y, 2);
+  T<U>       xl[ TERMS ], yl[ 2 ];
+  const bool loaded = loadGraph(path, xl, TERMS, yl, 2);
+  for (int i = 0; i < TERMS; i++)
+  {
+    x[ i ][ 0 ] = xl[ i ][ 0 ] = U(i + 1) / 4;
+    x[ i ][ 1 ] = xl[ i ][ 1 ] = U(1) / (i + 1);
+  }
+  U e = 0;
+  for (int j = 0; j < 2; j++)
+  {
+    y[ j ].eval(ORDER);
+    yl[ j ].eval(ORDER);
+    for (int k = 0; k <= ORDER; k++)
+      e = max(e, U(fabs(yl[ j ][ k ] - y[ j ][ k ]) / fabs(y[ j ][ k ])));
+  }
+  // A T graph is not a tape:
+  Tape<U> tape;
+  cout << "T graph saved " << saved << ", loaded " << loaded << ", as a tape "
+       << loadGraph(path, tape) << ", coefficients against T: " << e << endl;
+}
+int main()
+{
+  const char *path = "ExampleBAD10.graph";
+  cout.precision(2);
+  cout << "-----------------------------------------------\n";
+  cout << "Largest relative error after saving and loading\n";
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_tape<double>(path);
+  show_taylor<double>(path);
+  int prec = 128;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_tape<mpreal>(path);
+  show_taylor<mpreal>(path);
+  remove(path);
+  return 0;
+}
@@ -0,0 +1,90 @@
+#define FADBAD_THREADSAFE  // B graphs may then be shared between threads
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
+#include "badiff.h"
+
+#define TERMS 4
+#define THREADS 4
+#define STEPS 2000
+
+using namespace std;
+using namespace fadbad;
+
+// The common subexpression, recorded once:
+template <typename X>
+X common(const X *x)
+{
+  X s = x[ 0 ];
+  for (int k = 0; k < STEPS; k++)
+    s = s + sin(x[ k % TERMS ] * s) / (1 + sqr(x[ (k + 1) % TERMS ]));
+  return s;
+}
+// The part that thread j records on top of it:
+template <typename X>
+X part(const X &s, const X *x, const int j)
+{
+  X r = s;
+  for (int k = 0; k < STEPS; k++)
+    r = exp(-sqr(r)) * x[ (j + k) % TERMS ] + cos(s * (j + 1));
+  return r;
+}
+// Thread j records its part and sweeps it; the adjoints reach the shared
+// nodes of s, which hold them until s is released.
+template <typename U>
+void record(const B<U> *s, const B<U> *x, const int j, const mpfr_prec_t prec)
+{
+  mpfr_set_default_prec(prec);
+  B<U> r = part(*s, x, j);
+  r.diff(0, 1);
+}
+// Unit roundoff:
+double roundoff(const double &) { return numeric_limits<double>::epsilon(); }
+mpreal roundoff(const mpreal &) { return machine_epsilon(); }
+// The gradient of the sum of all parts, with the parts recorded on
+// THREADS threads on top of a shared s, and one after another. The threads
+// add their adjoints to s in any order, so the two may differ by rounding.
+template <typename U>
+void show_shared()
+{
+  B<U> xt[ TERMS ], xs[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+  {
+    xt[ i ] = U(1) / (i + 2);
+    xs[ i ] = U(1) / (i + 2);
+  }
+  {
+    B<U> s = common(xt);
+    s.share();
+    vector<thread> threads;
+    for (int j = 0; j < THREADS; j++)
+      threads.push_back(thread(record<U>, &s, xt, j, mpfr_get_default_prec()));
+    for (int j = 0; j < THREADS; j++)
+      threads[ j ].join();
+  }
+  {
+    B<U> s = common(xs);
+    for (int j = 0; j < THREADS; j++)
+      record<U>(&s, xs, j, mpfr_get_default_prec());
+  }
+  U e = 0;
+  for (int i = 0; i < TERMS; i++)
+    e = max(e, U(fabs((xt[ i ].d(0) - xs[ i ].d(0)) / xs[ i ].d(0))));
+  cout << "gradient on " << THREADS << " threads against serial: "
+       << (e <= 64 * roundoff(e) ? "agrees" : "differs") << " within 64 units of roundoff" << endl;
+}
+int main()
+{
+  cout << "-----------------------------------------------\n";
+  cout << "Threads recording on a shared subexpression\n";
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_shared<double>();
+  int prec = 128;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_shared<mpreal>();
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include <iostream>
+#include "fadiff.h"
+#include "badiff.h"
+
+#define TERMS 4
+#define STEPS 1000000  // a graph a million nodes deep
+
+using namespace std;
+using namespace fadbad;
+
+// A long accumulation, each step on top of the previous one:
+template <typename X>
+X func(const X *x)
+{
+  X s = x[ 0 ];
+  for (int k = 0; k < STEPS; k++)
+    s += x[ k % TERMS ] * x[ (k + 1) % TERMS ];
+  return s;
+}
+// The gradient by B against F. The sweep and the release of the graph
+// take constant stack depth however deep the graph is; the second graph is
+// released without a sweep.
+template <typename U>
+void show_deep()
+{
+  F<U, TERMS> xf[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+  {
+    xf[ i ] = U(1) / (i + 2);
+    xf[ i ].diff(i);
+  }
+  F<U, TERMS> f = func(xf);
+  B<U>        x[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+    x[ i ] = U(1) / (i + 2);
+  {
+    B<U> g = func(x);
+    g.diff(0, 1);
+  }
+  U e = 0;
+  for (int i = 0; i < TERMS; i++)
+    e = max(e, U(fabs((x[ i ].d(0) - f.d(i)) / f.d(i))));
+  cout << "depth " << STEPS << ", gradient against F: " << e << endl;
+  {
+    B<U> g = func(x);
+  }
+  cout << "released without a sweep" << endl;
+}
+int main()
+{
+  cout.precision(2);
+  cout << "-----------------------------------------------\n";
+  cout << "Largest relative error of the gradient of a deep graph\n";
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_deep<double>();
+  int prec = 128;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_deep<mpreal>();
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include "badiff.h"
+#include "tapespill.h"
+
+#define TERMS 4
+#define STEPS 6000  // about 40000 records, 10 segments of the tape
+
+using namespace std;
+using namespace fadbad;
+
+// A long chain of operations, so that the tape spills to the file:
+template <typename T>
+T func(const T *x, int n)
+{
+  T s = x[ 0 ];
+  for (int k = 0; k < STEPS; k++)
+    s = s + sin(x[ k % n ] * s + 0.001 * k) / (1 + sqr(x[ (k + 1) % n ]));
+  return s;
+}
+// Gradients of f*x[j], j = 0..n-1, with B, and with the compact tape
+// spilled to path while keeping 'resident' segments in memory. Each sweep
+// writes the segments again, in place, so the file does not grow.
+template <typename U>
+void show_spill(const char *path, const unsigned int resident)
+{
+  B<U> x[ TERMS ], g[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+    x[ i ] = U(1) / (i + 2);
+  {
+    B<U> f = func(x, TERMS);
+    for (int j = 0; j < TERMS; j++)
+      g[ j ] = f * x[ j ];
+  }
+  for (int j = 0; j < TERMS; j++)
+    g[ j ].diff(j, TERMS);
+
+  Tape<U>      tape;
+  TapeSpill<U> spill(tape, path, resident);
+  BC<U>        y[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+    y[ i ] = U(1) / (i + 2);
+  BC<U> h = func(y, TERMS), k[ TERMS ];
+  for (int j = 0; j < TERMS; j++)
+    k[ j ] = h * y[ j ];
+  // The file never holds more than one extent per complete segment:
+  const unsigned int segments = tape.size() / Tape<U>::SEGMENT;
+  const long extent = Tape<U>::SEGMENT * (3 * sizeof(unsigned int) + 2 * TapeIO<U>::bound(U(0)));
+  cout << "records " << tape.size() << ", file " << (spill.ok() ? "open" : "not opened") << endl;
+  for (int j = 0; j < TERMS; j++)
+  {
+    k[ j ].diff(0, 1);
+    U e = 0;
+    for (int i = 0; i < TERMS; i++)
+      e = max(e, U(fabs(y[ i ].d(0) - x[ i ].d(j)) / fabs(x[ i ].d(j))));
+    cout << "sweep " << j << ": error against B " << e << ", file within " << segments
+         << " segments: " << (spill.fileSize() <= segments * extent ? "yes" : "no") << endl;
+  }
+  cout << "I/O " << (spill.ok() ? "ok" : "failed") << endl;
+}
+int main()
+{
+  cout.precision(2);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_spill<double>(0, 4);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision, file that cannot be opened" << endl;
+  show_spill<double>("/nonexistent/tape.bin", 4);
+  int prec = 128;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_spill<mpreal>(0, 4);
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include "fadiff.h"
+#include "badiff.h"
+#include "hessian.h"
+
+#define TERMS 3
+
+using namespace std;
+using namespace fadbad;
+
+// Uses every function whose partial derivative RecordPartials stores:
+template <typename X>
+X func(const X *x)
+{
+  X a = sin(x[ 0 ]) * cos(x[ 1 ]) + tan(x[ 2 ]) / sqrt(x[ 0 ] + x[ 1 ]);
+  X b = asin(x[ 0 ]) - acos(x[ 2 ]) + atan(x[ 1 ] * x[ 2 ]);
+  return a * log(x[ 1 ]) + pow(b + 2, x[ 2 ]) + pow(x[ 0 ], 2.5);
+}
+// Gradient by B with and without recorded partials, against F:
+template <typename U>
+void show_errors()
+{
+  const U     p[ TERMS ] = {U(0.3), U(1.7), U(0.4)};
+  F<U, TERMS> xf[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+  {
+    xf[ i ] = p[ i ];
+    xf[ i ].diff(i);
+  }
+  F<U, TERMS> ff = func(xf);
+
+  B<U> x[ TERMS ], xr[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+  {
+    x[ i ]  = p[ i ];
+    xr[ i ] = p[ i ];
+  }
+  B<U> f = func(x), fr;
+  {
+    RecordPartials record;
+    fr = func(xr);
+  }
+  vector<unsigned int> row, col;
+  vector<U>            val;
+  // Recorded partials have no second order information:
+  const bool h = hessian(f, x, TERMS, row, col, val);
+  const bool hr = hessian(fr, xr, TERMS, row, col, val);
+  cout << "hessian() of B:                 " << (h ? "done" : "refused") << endl;
+  cout << "hessian() of B, RecordPartials: " << (hr ? "done" : "refused") << endl;
+  f.diff(0, 1);
+  fr.diff(0, 1);
+  U e = 0, er = 0;
+  for (int i = 0; i < TERMS; i++)
+  {
+    e  = max(e, U(fabs((x[ i ].d(0) - ff.d(i)) / ff.d(i))));
+    er = max(er, U(fabs((xr[ i ].d(0) - ff.d(i)) / ff.d(i))));
+  }
+  cout << "B                 against F: " << e << endl;
+  cout << "B, RecordPartials against F: " << er << endl;
+}
+int main()
+{
+  cout.precision(2);
+  cout << "-----------------------------------------------\n";
+  cout << "Largest relative error of the gradient\n";
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_errors<double>();
+  int prec = 128;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_errors<mpreal>();
+  return 0;
+}
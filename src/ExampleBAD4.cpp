@@ -0,0 +1,142 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include "badiff.h"
+#include "btape.h"
+
+#define TERMS 8
+#define STEPS 20000  // 140000 operations
+#define RUNS 5
+
+using namespace std;
+using namespace fadbad;
+
+// Bytes of MPFR significands held, counted by the memory functions of GMP,
+// which MPFR allocates through:
+static size_t significands = 0;
+void*         countAlloc(size_t n)
+{
+  significands += n;
+  return malloc(n);
+}
+void* countRealloc(void* p, size_t m, size_t n)
+{
+  significands += n - m;
+  return realloc(p, n);
+}
+void countFree(void* p, size_t n)
+{
+  significands -= n;
+  free(p);
+}
+
+template <typename X>
+X func(const X* x)
+{
+  X s = x[ 0 ];
+  for (int k = 0; k < STEPS; k++)
+    s = s + sin(x[ k % TERMS ] * s + 0.001 * k) / (1 + sqr(x[ (k + 3) % TERMS ]));
+  return s;
+}
+// The nodes of B that one step of func creates, 7 operations:
+template <typename U>
+size_t stepNodes()
+{
+  return sizeof(BTypeNameMUL<U>) + sizeof(BTypeNameADD2<U, double>) + sizeof(BTypeNameSIN<U>) +
+         sizeof(BTypeNameSQR<U>) + sizeof(BTypeNameADD1<U, int>) + sizeof(BTypeNameDIV<U>) +
+         sizeof(BTypeNameADD<U>);
+}
+// Records and sweeps the gradient with B and with BC, checks BC against B
+// and reports the bytes per operation of each after recording: the nodes
+// and the significands they hold for B, Tape::memory() for BC. The
+// timings go to cerr.
+template <typename U>
+void show_compare()
+{
+  typedef chrono::steady_clock    Clock;
+  chrono::duration<double, milli> rb(0), sb(0), rc(0), sc(0);
+  size_t                          mb = 0, mc = 0;
+  unsigned int                    ops = 0;
+  U                               e = 0;
+  for (int r = 0; r < RUNS; r++)
+  {
+    B<U> x[ TERMS ];
+    for (int i = 0; i < TERMS; i++)
+      x[ i ] = U(1) / (i + 2);
+    size_t a = significands;
+    {
+      Clock::time_point t0 = Clock::now();
+      B<U>              f  = func(x);
+      Clock::time_point t1 = Clock::now();
+      mb                   = stepNodes<U>() * STEPS + significands - a;
+      f.diff(0, 1);
+      rb += t1 - t0;
+      sb += Clock::now() - t1;
+    }
+    Tape<U> tape;
+    BC<U>   y[ TERMS ];
+    for (int i = 0; i < TERMS; i++)
+      y[ i ] = U(1) / (i + 2);
+    Clock::time_point t0 = Clock::now();
+    BC<U>             g  = func(y);
+    Clock::time_point t1 = Clock::now();
+    mc                   = tape.memory();
+    ops                  = tape.size() - TERMS;
+    g.diff(0, 1);
+    rc += t1 - t0;
+    sc += Clock::now() - t1;
+    for (int i = 0; i < TERMS; i++)
+      e = max(e, U(fabs(y[ i ].d(0) - x[ i ].d(0)) / fabs(x[ i ].d(0))));
+  }
+  cout << "operations " << ops << ", error of BC against B " << e << endl;
+  cout << "bytes per operation: B " << double(mb) / ops << ", BC " << double(mc) / ops << endl;
+  cerr << "record and sweep: B " << rb.count() / RUNS << " + " << sb.count() / RUNS << " ms, BC "
+       << rc.count() / RUNS << " + " << sc.count() / RUNS << " ms" << endl;
+}
+// Bits of an adjoint:
+int bits(const double&) { return numeric_limits<double>::digits; }
+int bits(const mpreal& a) { return (int)a.get_prec(); }
+// The gradient from a tape of mpreal values with adjoints of type A, made
+// from zero, against B at the default precision:
+template <typename A>
+void show_adjoints(const A& zero)
+{
+  B<mpreal> x[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+    x[ i ] = mpreal(1) / (i + 2);
+  B<mpreal> f = func(x);
+  f.diff(0, 1);
+  Tape<mpreal, A> tape(zero);
+  BC<mpreal, A>   y[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+    y[ i ] = mpreal(1) / (i + 2);
+  BC<mpreal, A> g = func(y);
+  g.diff(0, 1);
+  mpreal e = 0;
+  for (int i = 0; i < TERMS; i++)
+    e = max(e, mpreal(abs((mpreal(y[ i ].d(0)) - x[ i ].d(0)) / x[ i ].d(0))));
+  cout << "adjoints of " << bits(y[ 0 ].d(0)) << " bits, error against B " << e << endl;
+}
+int main()
+{
+  mp_set_memory_functions(countAlloc, countRealloc, countFree);
+  cout.precision(3);
+  cout << "-----------------------------------------------\n";
+  cout << "Gradient by B and by BC (compact tape)\n";
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_compare<double>();
+  int prec = 128;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_compare<mpreal>();
+  prec = 1024;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Values in MPFR precision " << prec << " digs, cheaper adjoints" << endl;
+  show_adjoints(0.0);
+  show_adjoints(mpreal(0, 128));
+  return 0;
+}
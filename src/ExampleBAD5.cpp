@@ -0,0 +1,98 @@
+#include <iostream>
+#include <stdexcept>
+#include "fadiff.h"
+#include "badiff.h"
+#include "preacc.h"
+
+#define TERMS 4
+#define STEPS 50
+
+using namespace std;
+using namespace fadbad;
+
+// The statement evaluated in every step:
+template <typename X, typename Y>
+X step(const X &s, const X &a, const X &b, const Y &k)
+{
+  return s + sin(a * s + k) / (1 + sqr(b)) - sqrt(exp(a) + b * b);
+}
+// Gradient by F, and by B with and without preaccumulation of the
+// statements:
+template <typename U>
+void show_errors()
+{
+  const unsigned int K = 3;
+  F<U, TERMS>        xf[ TERMS ], sf;
+  for (int i = 0; i < TERMS; i++)
+  {
+    xf[ i ] = U(1) / (i + 2);
+    xf[ i ].diff(i);
+  }
+  sf = xf[ 0 ];
+  for (int k = 0; k < STEPS; k++)
+    sf = step(sf, xf[ k % TERMS ], xf[ (k + 1) % TERMS ], U(k) / 100);
+
+  B<U> x[ TERMS ], xp[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+  {
+    x[ i ]  = U(1) / (i + 2);
+    xp[ i ] = U(1) / (i + 2);
+  }
+  B<U> s = x[ 0 ], sp = xp[ 0 ];
+  for (int k = 0; k < STEPS; k++)
+  {
+    s = step(s, x[ k % TERMS ], x[ (k + 1) % TERMS ], U(k) / 100);
+    // One node per statement instead of one per operation:
+    Preaccumulator<U, K> pre;
+    F<U, K>              a(pre.input(sp)), b(pre.input(xp[ k % TERMS ]));
+    F<U, K>              c(pre.input(xp[ (k + 1) % TERMS ]));
+    sp = pre.output(step(a, b, c, U(k) / 100));
+  }
+  s.diff(0, 1);
+  sp.diff(0, 1);
+  U e = 0, ep = 0;
+  for (int i = 0; i < TERMS; i++)
+  {
+    e  = max(e, U(fabs((x[ i ].d(0) - sf.d(i)) / sf.d(i))));
+    ep = max(ep, U(fabs((xp[ i ].d(0) - sf.d(i)) / sf.d(i))));
+  }
+  cout << "B                  against F: " << e << endl;
+  cout << "B, preaccumulated  against F: " << ep << endl;
+}
+// An input more than the capacity is refused:
+template <typename U>
+void show_capacity()
+{
+  B<U>                 x[ 3 ];
+  Preaccumulator<U, 2> pre;
+  F<U, 2>              a(pre.input(x[ 0 ])), b(pre.input(x[ 1 ]));
+  try
+  {
+    pre.input(x[ 2 ]);
+    cout << "third input accepted" << endl;
+  }
+  catch (const length_error &e)
+  {
+    cout << e.what() << endl;
+  }
+  cout << "inputs recorded: " << pre.size() << endl;
+}
+int main()
+{
+  cout.precision(2);
+  cout << "-----------------------------------------------\n";
+  cout << "Largest relative error of the gradient\n";
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_errors<double>();
+  int prec = 128;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_errors<mpreal>();
+  cout << "-----------------------------------------------\n";
+  cout << "Three inputs of a Preaccumulator of capacity 2" << endl;
+  cout << "-----------------------------------------------\n";
+  show_capacity<double>();
+  return 0;
+}
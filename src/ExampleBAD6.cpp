@@ -0,0 +1,70 @@
+#include <iostream>
+#include "fadiff.h"
+#include "badiff.h"
+#include "hvp.h"
+
+#define TERMS 4
+
+using namespace std;
+using namespace fadbad;
+
+template <typename X>
+X func(const X *x, unsigned int n)
+{
+  X s = 0;
+  for (unsigned int i = 0; i + 1 < n; i++)
+    s = s + sin(x[ i ] * x[ i + 1 ]) + exp(x[ i ]) / (2 + sqr(x[ i + 1 ]));
+  return s * sqrt(x[ 0 ] + x[ n - 1 ]);
+}
+template <typename U>
+B<F<U, 1> > bfunc(const B<F<U, 1> > *x, unsigned int n)
+{
+  return func(x, n);
+}
+// H*v and the gradient by hvp(), against the Hessian by F<F<U> >:
+template <typename U>
+void show_errors()
+{
+  U x[ TERMS ], v[ TERMS ], hv[ TERMS ], grad[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+  {
+    x[ i ] = U(1) / (i + 2);
+    v[ i ] = U(i + 1) / 3;
+  }
+  hvp(bfunc<U>, x, v, TERMS, hv, grad);
+
+  F<F<U> > xf[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+  {
+    xf[ i ] = x[ i ];
+    xf[ i ].x().diff(i, TERMS);
+    xf[ i ].diff(i, TERMS);
+  }
+  F<F<U> > f = func(xf, TERMS);
+  U        eh = 0, eg = 0;
+  for (int i = 0; i < TERMS; i++)
+  {
+    U h = 0;
+    for (int j = 0; j < TERMS; j++)
+      h += f.d(i).d(j) * v[ j ];
+    eh = max(eh, U(fabs((hv[ i ] - h) / h)));
+    eg = max(eg, U(fabs((grad[ i ] - f.d(i).x()) / f.d(i).x())));
+  }
+  cout << "H*v      against F<F>: " << eh << endl;
+  cout << "gradient against F<F>: " << eg << endl;
+}
+int main()
+{
+  cout.precision(2);
+  cout << "-----------------------------------------------\n";
+  cout << "Largest relative error of hvp()\n";
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_errors<double>();
+  int prec = 128;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_errors<mpreal>();
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <vector>
+#include "fadiff.h"
+#include "badiff.h"
+#include "hessian.h"
+
+#define TERMS 6
+
+using namespace std;
+using namespace fadbad;
+
+// A chain, so that the Hessian is banded:
+template <typename X>
+X func(const X *x)
+{
+  X s = 0;
+  for (int i = 0; i + 1 < TERMS; i++)
+    s = s + x[ i ] * sin(x[ i + 1 ]) + exp(x[ i ] - x[ i + 1 ]) / (1 + sqr(x[ i ]));
+  return s + pow(x[ 0 ], 3) + log(x[ TERMS - 1 ]);
+}
+// The sparse Hessian and the gradient by hessian(), against F<F<U> >:
+template <typename U>
+void show_errors()
+{
+  B<U> x[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+    x[ i ] = U(i + 1) / 4;
+  B<U>                 f = func(x);
+  vector<unsigned int> row, col;
+  vector<U>            val;
+  U                    grad[ TERMS ];
+  if (!hessian(f, x, TERMS, row, col, val, grad))
+  {
+    cout << "hessian() refused the graph" << endl;
+    return;
+  }
+  F<F<U> > xf[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+  {
+    xf[ i ] = U(i + 1) / 4;
+    xf[ i ].x().diff(i, TERMS);
+    xf[ i ].diff(i, TERMS);
+  }
+  F<F<U> > ff = func(xf);
+  // Entries of the lower triangle that are not returned must be zero:
+  U H[ TERMS ][ TERMS ] = {};
+  for (unsigned int k = 0; k < val.size(); k++)
+    H[ row[ k ] ][ col[ k ] ] = val[ k ];
+  U eh = 0, eg = 0;
+  for (int i = 0; i < TERMS; i++)
+  {
+    eg = max(eg, U(fabs((grad[ i ] - ff.d(i).x()) / ff.d(i).x())));
+    for (int j = 0; j <= i; j++)
+    {
+      const U h(ff.d(i).d(j));
+      eh = max(eh, U(h == 0 ? fabs(H[ i ][ j ]) : fabs((H[ i ][ j ] - h) / h)));
+    }
+  }
+  cout << "nonzeros " << val.size() << " of " << TERMS * (TERMS + 1) / 2 << endl;
+  cout << "Hessian  against F<F>: " << eh << endl;
+  cout << "gradient against F<F>: " << eg << endl;
+}
+int main()
+{
+  cout.precision(2);
+  cout << "-----------------------------------------------\n";
+  cout << "Largest relative error of hessian()\n";
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_errors<double>();
+  int prec = 128;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_errors<mpreal>();
+  return 0;
+}
@@ -0,0 +1,61 @@
+#include <iostream>
+#include "fadiff.h"
+#include "badiff.h"
+#include "crosscountry.h"
+
+#define TERMS 4
+#define OUTS 3
+
+using namespace std;
+using namespace fadbad;
+
+// Outputs sharing intermediate values:
+template <typename X>
+void func(const X *x, X *f)
+{
+  X a = sin(x[ 0 ] * x[ 1 ]), b = exp(x[ 2 ] - x[ 3 ]), c = a * b + sqrt(x[ 1 ] + x[ 3 ]);
+  f[ 0 ] = a + c / (1 + sqr(x[ 0 ]));
+  f[ 1 ] = b * c - log(x[ 2 ]);
+  f[ 2 ] = pow(c, 3) + a * b;
+}
+// The Jacobian by vertex elimination, against F:
+template <typename U>
+void show_errors()
+{
+  B<U> x[ TERMS ], f[ OUTS ];
+  for (int i = 0; i < TERMS; i++)
+    x[ i ] = U(i + 1) / 3;
+  func(x, f);
+  U            J[ OUTS * TERMS ];
+  JacobianCost cost(jacobian(f, OUTS, x, TERMS, J));
+
+  F<U, TERMS> xf[ TERMS ], ff[ OUTS ];
+  for (int i = 0; i < TERMS; i++)
+  {
+    xf[ i ] = U(i + 1) / 3;
+    xf[ i ].diff(i);
+  }
+  func(xf, ff);
+  U e = 0;
+  for (int j = 0; j < OUTS; j++)
+    for (int i = 0; i < TERMS; i++)
+      e = max(e, U(fabs((J[ j * TERMS + i ] - ff[ j ].d(i)) / ff[ j ].d(i))));
+  cout << "Jacobian against F: " << e << endl;
+  cout << "multiply-adds: forward " << cost.forward << ", reverse " << cost.reverse
+       << ", elimination " << cost.elimination << endl;
+}
+int main()
+{
+  cout.precision(2);
+  cout << "-----------------------------------------------\n";
+  cout << "Largest relative error of jacobian()\n";
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_errors<double>();
+  int prec = 128;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_errors<mpreal>();
+  return 0;
+}
@@ -0,0 +1,67 @@
+#include <iostream>
+#include "fadiff.h"
+#include "badiff.h"
+#include "lanes.h"
+
+#define TERMS 3
+#define LANES 4
+
+using namespace std;
+using namespace fadbad;
+
+// Branches on x[0], so the lanes must agree on the comparison:
+template <typename X>
+X func(const X *x, const X &c)
+{
+  X s = sin(x[ 0 ] * x[ 1 ]) + exp(x[ 2 ]) / (1 + sqr(x[ 1 ]));
+  if (x[ 0 ] > c)
+    return s * sqrt(x[ 0 ] + x[ 2 ]);
+  return s - pow(x[ 1 ], 3) * atan(x[ 2 ]);
+}
+// Gradients at LANES points by one sweep of B<Lanes<U, LANES> >, against
+// F at every point. With spread points the lanes disagree on the branch.
+template <typename U>
+void show_errors(const U &spread)
+{
+  typedef Lanes<U, LANES> L;
+  B<L>                    x[ TERMS ];
+  for (int i = 0; i < TERMS; i++)
+    for (int l = 0; l < LANES; l++)
+      x[ i ].x()[ l ] = U(i + 1) / 4 + spread * l;
+  lanesMixed() = false;
+  B<L> f = func(x, B<L>(L(U(1) / 2)));
+  f.diff(0, 1);
+  const bool mixed = lanesMixed();
+  U          e     = 0;
+  for (int l = 0; l < LANES; l++)
+  {
+    F<U, TERMS> xf[ TERMS ];
+    for (int i = 0; i < TERMS; i++)
+    {
+      xf[ i ] = U(i + 1) / 4 + spread * l;
+      xf[ i ].diff(i);
+    }
+    F<U, TERMS> ff = func(xf, F<U, TERMS>(U(1) / 2));
+    for (int i = 0; i < TERMS; i++)
+      e = max(e, U(fabs((x[ i ].d(0)[ l ] - ff.d(i)) / ff.d(i))));
+  }
+  cout << "spread " << spread << ": lanes " << (mixed ? "disagree" : "agree")
+       << ", gradients against F: " << e << endl;
+}
+int main()
+{
+  cout.precision(2);
+  cout << "-----------------------------------------------\n";
+  cout << "Largest relative error of the gradients\n";
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_errors<double>(0.01);
+  show_errors<double>(0.1);
+  int prec = 128;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_errors<mpreal>(mpreal(1) / 100);
+  show_errors<mpreal>(mpreal(1) / 10);
+  return 0;
+}
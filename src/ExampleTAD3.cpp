@@ -0,0 +1,148 @@
+#include <chrono>
+#include <iostream>
+#include "tintegrator.h"
+
+#define ORDER 20  // order of the manual loop
+#define STEPS 100
+#define TEND 10
+
+using namespace std;
+using namespace fadbad;
+
+template <typename U, int N>
+class TODE
+{
+ public:
+  T<U, N> x;                // Independent variables
+  T<U, N> xp;               // Dependent variables
+  TODE() { xp = cos(x); }  // record DAG at construction
+};
+// The manual pattern of ExampleTAD2, repeated over STEPS fixed steps:
+template <typename U, int N>
+U manual_loop()
+{
+  TODE<U, N> ode;
+  U          x = 1, h = U(TEND) / STEPS;
+  for (int s = 0; s < STEPS; s++)
+  {
+    ode.xp.reset();  // Re-center at the new point
+    ode.x[ 0 ] = x;
+    for (int i = 0; i < ORDER; i++)
+    {
+      ode.xp.eval(i);
+      ode.x[ i + 1 ] = ode.xp[ i ] / double(i + 1);
+    }
+    x = ode.x[ ORDER ];  // Sum the series by Horner's method
+    for (int i = ORDER - 1; i >= 0; i--)
+      x = x * h + ode.x[ i ];
+  }
+  return x;
+}
+// The same with TIntegrator, adaptive order and step:
+template <typename U, int N>
+U integrator(const double tol, unsigned int &order, unsigned int &steps)
+{
+  TODE<U, N>        ode;
+  TIntegrator<U, N> solver(&ode.x, &ode.xp, 1, tol);
+  U                 t = 0, x = 1;
+  solver.integrate(t, &x, U(TEND));
+  order = solver.order();
+  steps = solver.steps();
+  return x;
+}
+// TIntegrator at the order and step of the manual loop:
+template <typename U, int N>
+U fixed_steps()
+{
+  TODE<U, N>        ode;
+  TIntegrator<U, N> solver(&ode.x, &ode.xp, 1, 1e-16);
+  U                 x = 1, h = U(TEND) / STEPS;
+  solver.setOrder(ORDER);
+  for (int s = 0; s < STEPS; s++)
+  {
+    solver.expand(&x, ORDER);
+    solver.sum(h, &x);
+  }
+  return x;
+}
+// x'=x^2, x(0)=1 has the solution 1/(1-t), which is singular at t=1; the
+// steps shrink towards t=1 and integrate must fail there instead of
+// stepping past it:
+template <typename U, int N>
+void show_singular(const double tol)
+{
+  T<U, N>           x, xp;
+  xp = sqr(x);
+  TIntegrator<U, N> solver(&x, &xp, 1, tol);
+  U                 t = 0, y = 1;
+  const bool        ok = solver.integrate(t, &y, U(2));
+  cout << "x'=x^2, x(0)=1 integrated to t=2: " << (ok ? "done" : "failed") << " after "
+       << solver.steps() << " steps at 1-t=" << 1 - t << endl;
+}
+template <typename U, int N>
+void show_result(const double tol, const U &exact)
+{
+  const int    runs = 20;
+  unsigned int order, steps;
+  U            x1, x2, x3;
+
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  for (int r = 0; r < runs; r++)
+    x1 = manual_loop<U, N>();
+  chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+  for (int r = 0; r < runs; r++)
+    x2 = integrator<U, N>(tol, order, steps);
+  chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+  for (int r = 0; r < runs; r++)
+    x3 = fixed_steps<U, N>();
+  chrono::steady_clock::time_point t3 = chrono::steady_clock::now();
+
+  cout << "manual loop, order " << ORDER << ", " << STEPS << " steps" << endl;
+  cout << "x(" << TEND << ")=" << x1 << endl;
+  cout << "TIntegrator, tolerance " << tol << ", order " << order << ", " << steps << " steps"
+       << endl;
+  cout << "x(" << TEND << ")=" << x2 << endl;
+  cout << "TIntegrator, order " << ORDER << ", " << STEPS << " steps" << endl;
+  cout << "x(" << TEND << ")=" << x3 << endl;
+  cout.precision(5);
+  cout << "error manual loop:\t\t" << fabs(x1 - exact) << endl;
+  cout << "error TIntegrator:\t\t" << fabs(x2 - exact) << endl;
+  cout << "error TIntegrator fixed:\t" << fabs(x3 - exact) << endl;
+  // timings vary from run to run, so they are not part of the output
+  cerr << "manual loop " << chrono::duration<double, milli>(t1 - t0).count() / runs
+       << " ms, TIntegrator " << chrono::duration<double, milli>(t2 - t1).count() / runs
+       << " ms, TIntegrator fixed " << chrono::duration<double, milli>(t3 - t2).count() / runs
+       << " ms" << endl;
+}
+int main()
+{
+  // x'=cos(x), x(0)=1 has the solution x(t)=gd(t+asinh(tan(1))) with the
+  // Gudermannian function gd(u)=2*atan(tanh(u/2)).
+  int prec = 256;
+  mpfr_set_default_prec(prec);
+  mpfr_set_default_rounding_mode(MPFR_RNDN);
+  mpreal exact = 2 * atan(tanh((TEND + asinh(tan(mpreal(1)))) / 2));
+
+  int output_prec = 15;
+  cout.precision(output_prec);
+  cout << "-----------------------------------------------\n";
+  cout << "x'=cos(x), x(0)=1, integrated to t=" << TEND << endl;
+  cout << "exact x(" << TEND << ")=" << exact << endl;
+
+  // ODE_double
+  cout.precision(output_prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision, \noutput in " << output_prec << " digits" << endl;
+  show_result<double, 40>(1e-16, exact.toDouble());
+  show_singular<double, 40>(1e-16);
+
+  // ODE_mpreal
+  cout.precision(output_prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  cout << "output in " << output_prec << " digits" << endl;
+  show_result<mpreal, 100>(1e-70, exact);
+  show_singular<mpreal, 100>(1e-70);
+
+  return 0;
+}
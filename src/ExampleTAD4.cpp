@@ -0,0 +1,118 @@
+#include <chrono>
+#include <iostream>
+#include "tadiff.h"
+#include "tfadiff.h"
+
+#define ORDER 60
+#define N (ORDER + 1)
+#define LONG_ORDER 511
+#define PREC 1024
+
+using namespace std;
+using namespace fadbad;
+
+// Products of factorially decaying series, and of series that decay at
+// different rates, which TSeries forms by the convolution:
+template <typename X, typename U>
+X func(const X &x)
+{
+  X e = exp(2 - x), g = 1 / (U(1.5) - x);
+  return sqr(e) * sin(x) + g * (1 / (x + U(0.2))) + pow(x, U(2.5));
+}
+// Largest relative error of the coefficients 0..ORDER at precision prec,
+// against T at 300 bits, for T and for TF, which always uses the
+// recurrences:
+template <typename U>
+void show_errors(const int prec)
+{
+  tBulkLength() = 32;  // T forms products of 32 or more coefficients at once
+  mpfr_set_default_prec(300);
+  T<mpreal, N> xr, fr = func<T<mpreal, N>, mpreal>(xr);
+  xr[ 0 ] = mpreal(3) / 10;
+  xr[ 1 ] = 1;
+  fr.eval(ORDER);
+  mpfr_set_default_prec(prec);
+  T<U, N> x, f = func<T<U, N>, U>(x);
+  x[ 0 ] = U(3) / 10;
+  x[ 1 ] = 1;
+  f.eval(ORDER);
+  TF<U, N> y(U(3) / 10), g;
+  y[ 1 ] = 1;
+  g = func<TF<U, N>, U>(y);
+  mpfr_set_default_prec(300);
+  mpreal e1 = 0, e2 = 0;
+  for (int i = 0; i <= ORDER; i++)
+  {
+    e1 = max(e1, mpreal(abs((mpreal(f[ i ]) - fr[ i ]) / fr[ i ])));
+    e2 = max(e2, mpreal(abs((mpreal(g[ i ]) - fr[ i ]) / fr[ i ])));
+  }
+  cout << "T  (bulk products): " << e1 << endl;
+  cout << "TF (recurrences):   " << e2 << endl;
+  tBulkLength() = 0;
+}
+// Products of series that decay at the same rate, which TSeries forms by
+// Karatsuba's method:
+template <typename X>
+X rational(const X &x)
+{
+  X g = 1 / (1.5 - x), u = (1 + x) * g;
+  return g * u + sqr(u);
+}
+// The coefficients 0..LONG_ORDER of rational at x = 0.3, with products of
+// bulk or more coefficients formed at once (0 for never), in ms per run:
+double taylor(T<mpreal, LONG_ORDER + 1> &f, const unsigned int bulk)
+{
+  typedef std::chrono::steady_clock Clock;
+  const int runs = 5;
+  tBulkLength() = bulk;
+  const Clock::time_point t0 = Clock::now();
+  for (int k = 0; k < runs; k++)
+  {
+    T<mpreal, LONG_ORDER + 1> x;
+    f = rational(x);
+    x[ 0 ] = mpreal(3) / 10;
+    x[ 1 ] = 1;
+    f.eval(LONG_ORDER);
+  }
+  const double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+  tBulkLength() = 0;
+  return ms / runs;
+}
+void show_rational()
+{
+  mpfr_set_default_prec(2 * PREC);
+  T<mpreal, LONG_ORDER + 1> fr, f, g;
+  taylor(fr, 0);
+  mpfr_set_default_prec(PREC);
+  const double on = taylor(f, 32), off = taylor(g, 0);
+  mpfr_set_default_prec(2 * PREC);
+  mpreal e1 = 0, e2 = 0;
+  for (int i = 0; i <= LONG_ORDER; i++)
+  {
+    e1 = max(e1, mpreal(abs((mpreal(f[ i ]) - fr[ i ]) / fr[ i ])));
+    e2 = max(e2, mpreal(abs((mpreal(g[ i ]) - fr[ i ]) / fr[ i ])));
+  }
+  cout << "T (bulk products): " << e1 << endl;
+  cout << "T (recurrences):   " << e2 << endl;
+  cerr << "rational to order " << LONG_ORDER << ": bulk products " << on
+       << " ms, recurrences " << off << " ms" << endl;
+}
+int main()
+{
+  cout.precision(2);
+  cout << "-----------------------------------------------\n";
+  cout << "Largest relative error of the Taylor coefficients 0.." << ORDER << endl;
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_errors<double>(53);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision 128 digs" << endl;
+  show_errors<mpreal>(128);
+  cout << "-----------------------------------------------\n";
+  cout << "Largest relative error of the Taylor coefficients 0.." << LONG_ORDER << endl;
+  cout << "of (1+x)/(1.5-x)^2 + ((1+x)/(1.5-x))^2" << endl;
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << PREC << " digs" << endl;
+  show_rational();
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include <iostream>
+#include "tadiff.h"
+#include "tprogram.h"
+#include "lanes.h"
+
+#define ORDER 20
+#define POINTS 5
+#define LONG_LENGTH (2 * MaxLength)  // coefficients beyond N, by tMaxLength()
+
+using namespace std;
+using namespace fadbad;
+
+// Right-hand side of the Lorenz equations with a few more functions:
+template <typename X>
+void func(const X *x, X *y)
+{
+  y[ 0 ] = 10 * (x[ 1 ] - x[ 0 ]) + sin(x[ 2 ]) / 100;
+  y[ 1 ] = x[ 0 ] * (28 - x[ 2 ]) - x[ 1 ];
+  y[ 2 ] = x[ 0 ] * x[ 1 ] - 8 * x[ 2 ] / 3 + sqrt(exp(x[ 0 ] / 10) + sqr(x[ 1 ]));
+}
+// Input j at point q:
+template <typename U>
+U point(const int q, const int j)
+{
+  return U(j + 1) / 4 + U(q) / 10;
+}
+// The coefficients from the frozen program, reset for every point, and
+// from a batch holding all points, against T recorded at each point:
+template <typename U>
+void show_errors()
+{
+  T<U> x[ 3 ], y[ 3 ];
+  func(x, y);
+  TProgram<U> p(x, 3, y, 3, ORDER);
+  TBatch<U>   b(p, POINTS);
+  for (int q = 0; q < POINTS; q++)
+    for (int j = 0; j < 3; j++)
+    {
+      b.x(q, j, 0) = point<U>(q, j);
+      b.x(q, j, 1) = 1;
+    }
+  b.eval(ORDER);
+  U ep = 0, eb = 0;
+  for (int q = 0; q < POINTS; q++)
+  {
+    T<U> xt[ 3 ], yt[ 3 ];
+    func(xt, yt);
+    p.reset();
+    for (int j = 0; j < 3; j++)
+    {
+      p.x(j, 0) = xt[ j ][ 0 ] = point<U>(q, j);
+      p.x(j, 1) = xt[ j ][ 1 ] = 1;
+    }
+    p.eval(ORDER);
+    for (int j = 0; j < 3; j++)
+    {
+      yt[ j ].eval(ORDER);
+      for (int i = 0; i <= ORDER; i++)
+      {
+        const U s = fabs(yt[ j ][ i ]);
+        ep        = max(ep, U(fabs(p.y(j, i) - yt[ j ][ i ]) / s));
+        eb        = max(eb, U(fabs(b.y(q, j, i) - yt[ j ][ i ]) / s));
+      }
+    }
+  }
+  cout << "instructions " << p.size() << endl;
+  cout << "TProgram against T: " << ep << endl;
+  cout << "TBatch   against T: " << eb << endl;
+}
+// The program of Lanes<double, POINTS> built from the T<double> graph, with
+// point q in lane q:
+void show_lanes()
+{
+  typedef Lanes<double, POINTS> L;
+  T<double>                     x[ 3 ], y[ 3 ];
+  func(x, y);
+  TProgram<L> p(x, 3, y, 3, ORDER);
+  for (int q = 0; q < POINTS; q++)
+    for (int j = 0; j < 3; j++)
+    {
+      p.x(j, 0)[ q ] = point<double>(q, j);
+      p.x(j, 1)[ q ] = 1;
+    }
+  p.eval(ORDER);
+  double e = 0;
+  for (int q = 0; q < POINTS; q++)
+  {
+    T<double> xt[ 3 ], yt[ 3 ];
+    func(xt, yt);
+    for (int j = 0; j < 3; j++)
+    {
+      xt[ j ][ 0 ] = point<double>(q, j);
+      xt[ j ][ 1 ] = 1;
+    }
+    for (int j = 0; j < 3; j++)
+    {
+      yt[ j ].eval(ORDER);
+      for (int i = 0; i <= ORDER; i++)
+        e = max(e, fabs(p.y(j, i)[ q ] - yt[ j ][ i ]) / fabs(yt[ j ][ i ]));
+    }
+  }
+  cout << "TProgram of Lanes against T: " << e << endl;
+}
+// A program of T<double> with more coefficients than N, with the bound
+// raised at run time:
+void show_long()
+{
+  tMaxLength() = LONG_LENGTH;
+  T<double> x[ 3 ], y[ 3 ];
+  func(x, y);
+  TProgram<double> p(x, 3, y, 3);
+  for (int j = 0; j < 3; j++)
+  {
+    p.x(j, 0) = x[ j ][ 0 ] = point<double>(0, j);
+    p.x(j, 1) = x[ j ][ 1 ] = 1;
+  }
+  const unsigned int l = p.eval(LONG_LENGTH - 1);
+  double             e = 0;
+  for (int j = 0; j < 3; j++)
+  {
+    y[ j ].eval(LONG_LENGTH - 1);
+    for (int i = 0; i < LONG_LENGTH; i++)
+      e = max(e, fabs(p.y(j, i) - y[ j ][ i ]) / fabs(y[ j ][ i ]));
+  }
+  cout << "TProgram of " << l << " > N coefficients against T: " << e << endl;
+  tMaxLength() = 0;
+}
+int main()
+{
+  cout.precision(2);
+  cout << "-----------------------------------------------\n";
+  cout << "Largest relative error of the Taylor coefficients 0.." << ORDER << endl;
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_errors<double>();
+  show_lanes();
+  show_long();
+  int prec = 128;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_errors<mpreal>();
+  return 0;
+}
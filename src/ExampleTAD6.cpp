@@ -0,0 +1,92 @@
+#define FADBAD_THREADSAFE  // T<mpreal> may then be evaluated on the pool
+#include <chrono>
+#include <iostream>
+#include "tadiff.h"
+#include "tprogram.h"
+#include "tpool.h"
+
+#define DIM 16
+#define ORDER 30
+#define POINTS 8
+
+using namespace std;
+using namespace fadbad;
+
+// A wide right-hand side, a ring of coupled oscillators:
+template <typename X>
+void func(const X *x, X *y)
+{
+  for (int j = 0; j < DIM; j++)
+    y[ j ] = sin(x[ (j + 1) % DIM ]) - x[ j ] * cos(x[ (j + DIM - 1) % DIM ]) / 2 +
+             sqrt(1 + sqr(x[ j ]));
+}
+// The coefficients from eval(k, pool) of a program and of a batch,
+// against T. The timings go to cerr.
+template <typename U>
+void show_errors(TPool &pool)
+{
+  T<U> x[ DIM ], y[ DIM ];
+  func(x, y);
+  TProgram<U> p(x, DIM, y, DIM, ORDER);
+  TBatch<U>   b(p, POINTS);
+  for (int j = 0; j < DIM; j++)
+  {
+    p.x(j, 0) = x[ j ][ 0 ] = U(j + 1) / DIM;
+    p.x(j, 1) = x[ j ][ 1 ] = 1;
+    for (int q = 0; q < POINTS; q++)
+    {
+      b.x(q, j, 0) = U(j + 1) / DIM + U(q) / 10;
+      b.x(q, j, 1) = 1;
+    }
+  }
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  p.eval(ORDER, pool);
+  chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+  b.eval(ORDER, pool);
+  chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+  U ep = 0, eb = 0;
+  for (int j = 0; j < DIM; j++)
+  {
+    y[ j ].eval(ORDER);
+    for (int i = 0; i <= ORDER; i++)
+      ep = max(ep, U(fabs(p.y(j, i) - y[ j ][ i ]) / fabs(y[ j ][ i ])));
+  }
+  for (int q = 0; q < POINTS; q++)
+  {
+    T<U> xt[ DIM ], yt[ DIM ];
+    func(xt, yt);
+    for (int j = 0; j < DIM; j++)
+    {
+      xt[ j ][ 0 ] = U(j + 1) / DIM + U(q) / 10;
+      xt[ j ][ 1 ] = 1;
+    }
+    for (int j = 0; j < DIM; j++)
+    {
+      yt[ j ].eval(ORDER);
+      for (int i = 0; i <= ORDER; i++)
+        eb = max(eb, U(fabs(b.y(q, j, i) - yt[ j ][ i ]) / fabs(yt[ j ][ i ])));
+    }
+  }
+  cout << "on the pool " << (TKernel<U>::reentrant ? "yes" : "no") << endl;
+  cout << "TProgram against T: " << ep << endl;
+  cout << "TBatch   against T: " << eb << endl;
+  cerr << "TProgram " << chrono::duration<double, milli>(t1 - t0).count() << " ms, TBatch "
+       << chrono::duration<double, milli>(t2 - t1).count() << " ms" << endl;
+}
+int main()
+{
+  TPool pool(4);
+  cout.precision(2);
+  cout << "-----------------------------------------------\n";
+  cout << "Largest relative error of the Taylor coefficients 0.." << ORDER << endl;
+  cout << "evaluated by " << pool.size() << " threads" << endl;
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_errors<double>(pool);
+  int prec = 256;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_errors<mpreal>(pool);
+  return 0;
+}
@@ -0,0 +1,80 @@
+#include <iostream>
+#include "fadiff.h"
+#include "tadiff.h"
+#include "ttensor.h"
+
+#define TERMS 3
+#define ORDER 3
+#define LANES 4
+
+using namespace std;
+using namespace fadbad;
+
+template <typename X>
+X func(const X *x)
+{
+  return sin(x[ 0 ] * x[ 1 ]) + exp(x[ 2 ]) / (1 + sqr(x[ 1 ])) + x[ 0 ] * sqrt(x[ 1 ] + x[ 2 ]);
+}
+// All derivatives of order up to 3 by TTensor, from expansions along 10
+// directions, 4 at a time, against F<F<F<U> > >. The error is absolute
+// where the derivative is zero:
+template <typename U>
+void show_errors()
+{
+  const U             x0[ TERMS ] = {U(0.3), U(1.7), U(0.4)};
+  T<Lanes<U, LANES> > x[ TERMS ];
+  T<Lanes<U, LANES> > f = func(x);
+  TTensor<U>          t(TERMS, ORDER);
+  t.expand(x, f, x0);
+
+  F<F<F<U> > > xf[ TERMS ];
+  for (int m = 0; m < TERMS; m++)
+  {
+    xf[ m ] = x0[ m ];
+    xf[ m ].x().x().diff(m, TERMS);
+    xf[ m ].x().diff(m, TERMS);
+    xf[ m ].diff(m, TERMS);
+  }
+  F<F<F<U> > > ff = func(xf);
+  U            e[ ORDER + 1 ] = {};
+  unsigned int count = 0;
+  for (int a = 0; a < TERMS; a++)
+    for (int b = a; b < TERMS; b++)
+      for (int c = b; c < TERMS; c++)
+      {
+        // d/dx_a, d^2/dx_a dx_b and d^3/dx_a dx_b dx_c:
+        unsigned int i[ TERMS ] = {};
+        U            r[ ORDER + 1 ];
+        r[ 0 ] = ff.x().x().x();
+        r[ 1 ] = ff.d(a).x().x();
+        r[ 2 ] = ff.d(a).d(b).x();
+        r[ 3 ] = ff.d(a).d(b).d(c);
+        const int m[ ORDER + 1 ] = {-1, a, b, c};
+        for (int k = 0; k <= ORDER; k++)
+        {
+          if (k > 0)
+            ++i[ m[ k ] ];
+          const U d(t.derivative(i) - r[ k ]);
+          e[ k ] = max(e[ k ], U(r[ k ] == 0 ? fabs(d) : fabs(d / r[ k ])));
+        }
+        ++count;
+      }
+  cout << "directions " << t.size() << ", third derivatives " << count << endl;
+  for (int k = 0; k <= ORDER; k++)
+    cout << "order " << k << " against F<F<F>>: " << e[ k ] << endl;
+}
+int main()
+{
+  cout.precision(2);
+  cout << "-----------------------------------------------\n";
+  cout << "Largest relative error of the derivatives\n";
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in double precision" << endl;
+  show_errors<double>();
+  int prec = 128;
+  mpfr_set_default_prec(prec);
+  cout << "-----------------------------------------------\n";
+  cout << "Computed in MPFR precision " << prec << " digs" << endl;
+  show_errors<mpreal>();
+  return 0;
+}